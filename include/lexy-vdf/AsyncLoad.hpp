@@ -0,0 +1,71 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/ParseError.hpp>
+#include <lexy-vdf/ParseWarning.hpp>
+
+namespace lexy_vdf {
+	/// Runs a task, for example by posting it to the queue of a game or UI thread. Tasks must not be dropped.
+	using Executor = std::function<void(std::function<void()>)>;
+
+	struct LoadResult {
+		std::string path;
+		std::unique_ptr<KeyValues> key_values;
+		std::vector<ParseError> errors;
+		std::vector<ParseWarning> warnings;
+
+		explicit operator bool() const { return key_values != nullptr; }
+	};
+
+	/// Reads files on one thread and parses them on others, so reading the next file overlaps parsing the current one.
+	class AsyncLoader {
+	public:
+		struct Request;
+
+		class Awaitable {
+		public:
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(std::coroutine_handle<> p_handle);
+			LoadResult await_resume();
+
+		private:
+			friend class AsyncLoader;
+			Awaitable(AsyncLoader& p_loader, std::shared_ptr<Request> p_request);
+
+			AsyncLoader* _loader;
+			std::shared_ptr<Request> _request;
+		};
+
+		explicit AsyncLoader(std::size_t p_parse_threads = 1);
+		AsyncLoader(const AsyncLoader&) = delete;
+		AsyncLoader& operator=(const AsyncLoader&) = delete;
+		/// Finishes the loads already started.
+		~AsyncLoader();
+
+		static AsyncLoader& shared();
+
+		/// The awaiting coroutine is resumed through p_executor, or on a parse thread if p_executor is empty.
+		Awaitable load(std::filesystem::path p_path, Executor p_executor);
+
+	private:
+		struct Queue;
+		std::unique_ptr<Queue> _read_queue;
+		std::unique_ptr<Queue> _parse_queue;
+
+		void _read(std::shared_ptr<Request> request);
+		static void _parse(Request& request);
+	};
+
+	/// Loads and parses path, including its include files, without blocking the awaiting coroutine.
+	inline AsyncLoader::Awaitable load_async(std::filesystem::path path, Executor executor) {
+		return AsyncLoader::shared().load(std::move(path), std::move(executor));
+	}
+}
@@ -0,0 +1,404 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <lexy-vdf/ParseError.hpp>
+#include <lexy-vdf/ParseWarning.hpp>
+
+namespace lexy_vdf {
+	/// Specialize with a `static constexpr auto fields = make_fields(field<"key">(&T::member), ...);` member.
+	template<typename T>
+	struct Binding;
+
+	template<typename T>
+	concept Bindable = requires { Binding<T>::fields; };
+
+	struct BindOptions {
+		enum class UnknownKeys : unsigned char {
+			Skip,
+			Report
+		} unknown_keys = UnknownKeys::Skip;
+		bool use_default_conditions = true;
+		std::vector<std::string> conditions;
+	};
+
+	struct BindResult {
+		std::vector<ParseError> errors;
+		std::vector<ParseWarning> warnings;
+
+		bool has_error() const { return !errors.empty(); }
+		explicit operator bool() const { return errors.empty(); }
+	};
+
+	namespace detail {
+		template<std::size_t N>
+		struct FixedString {
+			char data[N];
+
+			consteval FixedString(const char (&string)[N]) {
+				std::copy_n(string, N, data);
+			}
+
+			constexpr std::string_view view() const {
+				return std::string_view(data, N - 1);
+			}
+		};
+
+		struct BindValue {
+			enum class Kind : unsigned char {
+				Int,
+				Float,
+				String
+			} kind;
+			std::int32_t int_value;
+			std::float_t float_value;
+			/// Decoded string, or the source text of a number.
+			std::string_view text;
+		};
+
+		struct BindTable;
+
+		struct BindField {
+			std::string_view key;
+			bool (*assign)(void* object, const BindValue& value);
+			void* (*enter)(void* object);
+			const BindTable* nested;
+			/// A std::vector member, every occurrence of the key appends instead of only the first binding.
+			bool repeated;
+		};
+
+		constexpr std::uint64_t bind_hash(std::string_view key, std::uint64_t seed) {
+			std::uint64_t hash = 0xcbf29ce484222325ULL ^ (seed * 0x9e3779b97f4a7c15ULL);
+			for (char c : key) {
+				hash ^= static_cast<unsigned char>(c);
+				hash *= 0x100000001b3ULL;
+			}
+			return hash ^ (hash >> 29);
+		}
+
+		constexpr std::uint64_t bind_mix(std::uint64_t hash, std::uint64_t displacement) {
+			hash ^= displacement * 0x9e3779b97f4a7c15ULL;
+			hash ^= hash >> 31;
+			hash *= 0xbf58476d1ce4e5b9ULL;
+			hash ^= hash >> 27;
+			hash *= 0x94d049bb133111ebULL;
+			return hash ^ (hash >> 31);
+		}
+
+		/// Field lookup through a two level perfect hash generated from the declared keys.
+		///
+		/// A key hashes once, the hash picks a bucket and the bucket's displacement remixes it into
+		/// a slot. Should no displacement fit, displacements is empty and slots lists the field
+		/// indices ordered by key for a binary search.
+		struct BindTable {
+			std::span<const std::uint16_t> displacements;
+			std::span<const std::int16_t> slots;
+			std::span<const BindField> fields;
+
+			constexpr const BindField* find(std::string_view key) const {
+				if (fields.empty()) return nullptr;
+				if (displacements.empty()) return _find_sorted(key);
+
+				const std::uint64_t hash = bind_hash(key, 0);
+				const std::uint16_t displacement = displacements[bind_mix(hash, 0) & (displacements.size() - 1)];
+				const std::int16_t index = slots[bind_mix(hash, displacement + 1ULL) & (slots.size() - 1)];
+				if (index < 0 || fields[static_cast<std::size_t>(index)].key != key) return nullptr;
+				return &fields[static_cast<std::size_t>(index)];
+			}
+
+		private:
+			constexpr const BindField* _find_sorted(std::string_view key) const {
+				auto found = std::lower_bound(slots.begin(), slots.end(), key, [this](std::int16_t index, std::string_view key) {
+					return fields[static_cast<std::size_t>(index)].key < key;
+				});
+				if (found == slots.end() || fields[static_cast<std::size_t>(*found)].key != key) return nullptr;
+				return &fields[static_cast<std::size_t>(*found)];
+			}
+		};
+
+		template<std::size_t N>
+		constexpr bool bind_keys_unique(std::array<std::string_view, N> keys) {
+			std::sort(keys.begin(), keys.end());
+			return std::adjacent_find(keys.begin(), keys.end()) == keys.end();
+		}
+
+		inline constexpr std::uint16_t bind_max_displacement = 0xffff;
+
+		template<std::size_t N>
+		struct BindLayout {
+			static constexpr std::size_t slot_count = N == 0 ? 0 : std::bit_ceil(N * 2);
+			static constexpr std::size_t bucket_count = N == 0 ? 0 : std::bit_ceil((N + 1) / 2);
+
+			bool hashed = false;
+			std::array<std::uint16_t, bucket_count> displacements {};
+			/// Field index per slot when hashed, otherwise the field indices ordered by key in the first N.
+			std::array<std::int16_t, slot_count> slots {};
+		};
+
+		///
+		/// @brief Places unique keys with hash and displace, or orders them when that fails
+		///
+		/// Buckets average two keys and are placed largest first into a table at most half full,
+		/// each trying displacements until all of its keys land on free slots.
+		///
+		template<std::size_t N>
+		constexpr BindLayout<N> bind_layout(const std::array<std::string_view, N>& keys) {
+			using Layout = BindLayout<N>;
+			Layout layout;
+			if constexpr (N != 0) {
+				// Key indices grouped by bucket, members[starts[bucket]] up to members[starts[bucket + 1]]
+				std::array<std::uint64_t, N> hashes {};
+				std::array<std::size_t, N> buckets {};
+				std::array<std::size_t, Layout::bucket_count + 1> starts {};
+				for (std::size_t index = 0; index < N; index++) {
+					hashes[index] = bind_hash(keys[index], 0);
+					buckets[index] = bind_mix(hashes[index], 0) & (Layout::bucket_count - 1);
+					starts[buckets[index] + 1]++;
+				}
+				for (std::size_t bucket = 0; bucket < Layout::bucket_count; bucket++) {
+					starts[bucket + 1] += starts[bucket];
+				}
+				std::array<std::size_t, N> members {};
+				std::array<std::size_t, Layout::bucket_count> filled {};
+				for (std::size_t index = 0; index < N; index++) {
+					members[starts[buckets[index]] + filled[buckets[index]]++] = index;
+				}
+
+				std::array<std::size_t, Layout::bucket_count> order {};
+				for (std::size_t bucket = 0; bucket < order.size(); bucket++) {
+					order[bucket] = bucket;
+				}
+				std::sort(order.begin(), order.end(), [&starts](std::size_t lhs, std::size_t rhs) {
+					return starts[lhs + 1] - starts[lhs] > starts[rhs + 1] - starts[rhs];
+				});
+
+				layout.slots.fill(-1);
+				layout.hashed = true;
+				for (std::size_t bucket : order) {
+					const std::size_t begin = starts[bucket];
+					const std::size_t end = starts[bucket + 1];
+					if (begin == end) break;
+
+					bool placed = false;
+					for (std::uint32_t displacement = 0; displacement < bind_max_displacement; displacement++) {
+						std::size_t claimed = begin;
+						for (; claimed != end; claimed++) {
+							std::int16_t& slot = layout.slots[bind_mix(hashes[members[claimed]], displacement + 1ULL) & (Layout::slot_count - 1)];
+							if (slot >= 0) break;
+							slot = static_cast<std::int16_t>(members[claimed]);
+						}
+						if (claimed == end) {
+							layout.displacements[bucket] = static_cast<std::uint16_t>(displacement);
+							placed = true;
+							break;
+						}
+						// Take back the slots this displacement already claimed
+						for (std::size_t index = begin; index != claimed; index++) {
+							layout.slots[bind_mix(hashes[members[index]], displacement + 1ULL) & (Layout::slot_count - 1)] = -1;
+						}
+					}
+					if (!placed) {
+						layout.hashed = false;
+						break;
+					}
+				}
+			}
+
+			if (!layout.hashed) {
+				layout.slots.fill(-1);
+				for (std::size_t index = 0; index < N; index++) {
+					layout.slots[index] = static_cast<std::int16_t>(index);
+				}
+				std::sort(layout.slots.begin(), layout.slots.begin() + N, [&keys](std::int16_t lhs, std::int16_t rhs) {
+					return keys[static_cast<std::size_t>(lhs)] < keys[static_cast<std::size_t>(rhs)];
+				});
+			}
+			return layout;
+		}
+
+		template<typename T>
+		struct IsVector : std::false_type {};
+
+		template<typename T, typename Allocator>
+		struct IsVector<std::vector<T, Allocator>> : std::true_type {};
+
+		template<typename T>
+		constexpr bool bind_scalar(T& target, const BindValue& value) {
+			if constexpr (std::is_same_v<T, bool>) {
+				switch (value.kind) {
+					case BindValue::Kind::Int: target = value.int_value != 0; return true;
+					case BindValue::Kind::Float: target = value.float_value != 0; return true;
+					case BindValue::Kind::String:
+						target = value.text.size() == 4 &&
+							std::equal(value.text.begin(), value.text.end(), "true", [](char lhs, char rhs) {
+								return (lhs | 0x20) == rhs;
+							});
+						return true;
+				}
+				return false;
+			} else if constexpr (std::is_integral_v<T>) {
+				if (value.kind != BindValue::Kind::Int) return false;
+				target = static_cast<T>(value.int_value);
+				return true;
+			} else if constexpr (std::is_floating_point_v<T>) {
+				if (value.kind == BindValue::Kind::Float) {
+					target = static_cast<T>(value.float_value);
+				} else if (value.kind == BindValue::Kind::Int) {
+					target = static_cast<T>(value.int_value);
+				} else {
+					return false;
+				}
+				return true;
+			} else if constexpr (std::is_same_v<T, std::string>) {
+				target.assign(value.text);
+				return true;
+			} else {
+				static_assert(!sizeof(T), "unsupported bound member type");
+			}
+		}
+
+		template<typename T>
+		struct BindTableFor;
+
+		template<typename Member>
+		struct BindElement {
+			using type = Member;
+		};
+
+		template<typename Element, typename Allocator>
+		struct BindElement<std::vector<Element, Allocator>> {
+			using type = Element;
+		};
+
+		template<typename Class, std::size_t Index>
+		constexpr auto& bind_member(void* object) {
+			return static_cast<Class*>(object)->*(std::get<Index>(Binding<Class>::fields.fields).member);
+		}
+
+		template<typename Class, std::size_t Index>
+		bool bind_assign(void* object, const BindValue& value) {
+			auto& member = bind_member<Class, Index>(object);
+			using Member = std::remove_reference_t<decltype(member)>;
+			if constexpr (IsVector<Member>::value) {
+				typename Member::value_type element {};
+				if (!bind_scalar(element, value)) return false;
+				member.push_back(std::move(element));
+				return true;
+			} else {
+				return bind_scalar(member, value);
+			}
+		}
+
+		template<typename Class, std::size_t Index>
+		void* bind_enter(void* object) {
+			auto& member = bind_member<Class, Index>(object);
+			using Member = std::remove_reference_t<decltype(member)>;
+			if constexpr (IsVector<Member>::value) {
+				return &member.emplace_back();
+			} else {
+				return &member;
+			}
+		}
+
+		template<typename Class, std::size_t Index>
+		constexpr BindField make_bind_field() {
+			using FieldType = std::tuple_element_t<Index, typename std::remove_cvref_t<decltype(Binding<Class>::fields)>::tuple_type>;
+			using Member = typename FieldType::member_type;
+			using Element = typename BindElement<Member>::type;
+			if constexpr (Bindable<Element>) {
+				return BindField { FieldType::key.view(), nullptr, &bind_enter<Class, Index>, &BindTableFor<Element>::value, IsVector<Member>::value };
+			} else {
+				return BindField { FieldType::key.view(), &bind_assign<Class, Index>, nullptr, nullptr, IsVector<Member>::value };
+			}
+		}
+
+		template<typename T>
+		struct BindTableFor {
+			using fields_type = std::remove_cvref_t<decltype(Binding<T>::fields)>;
+			static constexpr std::size_t count = fields_type::size;
+
+			static constexpr std::array<std::string_view, count> keys = []<std::size_t... Indices>(std::index_sequence<Indices...>) {
+				return std::array<std::string_view, count> { std::tuple_element_t<Indices, typename fields_type::tuple_type>::key.view()... };
+			}(std::make_index_sequence<count> {});
+
+			static_assert(bind_keys_unique(keys), "Binding keys must be unique");
+			static_assert(count <= 0x7fff, "Binding has too many keys");
+			static constexpr BindLayout<count> layout = bind_layout(keys);
+
+			static constexpr std::array<BindField, count> fields = []<std::size_t... Indices>(std::index_sequence<Indices...>) {
+				return std::array<BindField, count> { make_bind_field<T, Indices>()... };
+			}(std::make_index_sequence<count> {});
+
+			static constexpr BindTable value {
+				layout.hashed ? std::span<const std::uint16_t>(layout.displacements) : std::span<const std::uint16_t>(),
+				layout.hashed ? std::span<const std::int16_t>(layout.slots) : std::span<const std::int16_t>(layout.slots.data(), count),
+				fields,
+			};
+		};
+
+		BindResult bind_buffer(std::string_view source, const BindTable& table, void* object, const BindOptions& options);
+		BindResult bind_file(const std::filesystem::path& path, const BindTable& table, void* object, const BindOptions& options);
+	}
+
+	template<detail::FixedString Key, typename Class, typename Member>
+	struct Field {
+		using class_type = Class;
+		using member_type = Member;
+		static constexpr detail::FixedString key = Key;
+
+		Member Class::*member;
+	};
+
+	template<detail::FixedString Key, typename Class, typename Member>
+	constexpr Field<Key, Class, Member> field(Member Class::*member) {
+		return { member };
+	}
+
+	template<typename... Fields>
+	struct FieldMap {
+		using tuple_type = std::tuple<Fields...>;
+		static constexpr std::size_t size = sizeof...(Fields);
+
+		tuple_type fields;
+	};
+
+	template<typename... Fields>
+	constexpr FieldMap<Fields...> make_fields(Fields... fields) {
+		return { std::tuple<Fields...> { fields... } };
+	}
+
+	///
+	/// @brief Fills object straight from VDF source without building KeyValues
+	///
+	/// Keys dispatch through a perfect hash over the keys declared in Binding<T>. A key repeated
+	/// for a std::vector member appends an element each time, any other member keeps the first
+	/// value like KeyValues does.
+	///
+	template<Bindable T>
+	BindResult bind_from_string(std::string_view string, T& object, const BindOptions& options = {}) {
+		return detail::bind_buffer(string, detail::BindTableFor<T>::value, &object, options);
+	}
+
+	template<Bindable T>
+	BindResult bind_from_buffer(const char* data, std::size_t size, T& object, const BindOptions& options = {}) {
+		return detail::bind_buffer(std::string_view(data, size), detail::BindTableFor<T>::value, &object, options);
+	}
+
+	template<Bindable T>
+	BindResult bind_from_file(const std::filesystem::path& path, T& object, const BindOptions& options = {}) {
+		return detail::bind_file(path, detail::BindTableFor<T>::value, &object, options);
+	}
+}
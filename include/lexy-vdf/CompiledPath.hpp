@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <lexy-vdf/KeyValues.hpp>
+
+namespace lexy_vdf {
+	/// Path selector compiled once for repeated lookups.
+	///
+	/// Segments are separated by '/', '*' matches every child and "[N]" matches the numbered
+	/// key N of VDF lists. Segments may be followed by predicates, "[key]" keeps blocks
+	/// containing key and "[key=value]" keeps blocks whose key holds value.
+	/// A backslash escapes the next character of a key.
+	class CompiledPath {
+	public:
+		struct Predicate {
+			KeyType key;
+			std::size_t hash;
+			std::optional<std::string> value;
+			std::optional<std::int32_t> int_value;
+			std::optional<std::float_t> float_value;
+
+			bool matches(const ValueType& p_value) const;
+			bool operator==(const Predicate&) const = default;
+		};
+
+		struct Segment {
+			enum class Type : unsigned char {
+				Key,
+				Wildcard
+			} type;
+			KeyType key;
+			std::size_t hash;
+			std::vector<Predicate> predicates;
+
+			bool matches_key(KeyObserverType p_key) const;
+			bool matches_value(const ValueType& p_value) const;
+			PrehashedKey lookup_key() const;
+			bool operator==(const Segment&) const = default;
+		};
+
+		static std::optional<CompiledPath> compile(std::string_view p_path);
+
+		const std::vector<Segment>& segments() const;
+		std::string_view source() const;
+
+		std::vector<const ValueType*> evaluate(const KeyValues& p_key_values) const;
+
+	private:
+		std::string _source;
+		std::vector<Segment> _segments;
+	};
+
+	/// Evaluates many compiled paths in one traversal, sharing the work for common prefixes.
+	class QueryBatch {
+	public:
+		using result_type = std::vector<std::vector<const ValueType*>>;
+
+		QueryBatch();
+		explicit QueryBatch(const std::vector<CompiledPath>& p_paths);
+
+		QueryBatch(QueryBatch&&);
+		QueryBatch& operator=(QueryBatch&&);
+		~QueryBatch();
+
+		std::size_t add(const CompiledPath& p_path);
+		std::size_t size() const;
+
+		result_type evaluate(const KeyValues& p_key_values) const;
+
+	private:
+		struct Node;
+		std::unique_ptr<Node> _root;
+		std::size_t _path_count = 0;
+	};
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <lexy-vdf/StringHash.hpp>
+
+namespace lexy_vdf {
+	/// Condition names interned to bit indices, with the enabled conditions kept as a bitmask.
+	class ConditionSet {
+	public:
+		using Index = std::uint8_t;
+		using Mask = std::bitset<256>;
+
+		/// Index of names that are not interned, tests as disabled.
+		static constexpr Index unknown = 255;
+		static constexpr std::size_t capacity = unknown;
+
+		ConditionSet() = default;
+		ConditionSet(std::initializer_list<std::string_view> p_names);
+
+		bool add(std::string_view p_name);
+		bool remove(std::string_view p_name);
+		bool contains(std::string_view p_name) const;
+		void clear();
+
+		std::size_t size() const { return _enabled.count(); }
+		bool empty() const { return _enabled.none(); }
+
+		Index intern(std::string_view p_name);
+		Index find(std::string_view p_name) const;
+
+		bool test(Index p_index) const {
+			return p_index != unknown && _enabled.test(p_index);
+		}
+
+		std::string_view name(Index p_index) const { return _names[p_index]; }
+		std::size_t interned_count() const { return _names.size(); }
+		const Mask& mask() const { return _enabled; }
+		std::vector<std::string_view> enabled() const;
+
+	private:
+		std::unordered_map<std::string, Index, string_hash, std::equal_to<>> _indices;
+		std::vector<std::string> _names;
+		Mask _enabled;
+	};
+
+	/// Conditional attribute compiled to a postfix program over its operand names.
+	class ConditionPredicate {
+	public:
+		enum class Op : std::uint8_t {
+			Test,
+			Not,
+			And,
+			Or
+		};
+
+		struct Instruction {
+			Op op;
+			/// Index into names() for Test.
+			std::uint8_t operand;
+
+			bool operator==(const Instruction&) const = default;
+		};
+
+		/// An empty predicate always holds.
+		ConditionPredicate() = default;
+		ConditionPredicate(std::vector<Instruction> p_program, std::vector<std::string> p_names);
+
+		bool evaluate(const ConditionSet& p_conditions) const;
+		std::string to_string() const;
+
+		const std::vector<Instruction>& program() const { return _program; }
+		const std::vector<std::string>& names() const { return _names; }
+
+		bool operator==(const ConditionPredicate&) const = default;
+
+	private:
+		std::vector<Instruction> _program;
+		std::vector<std::string> _names;
+	};
+}
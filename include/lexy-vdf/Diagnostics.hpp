@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace lexy_vdf {
+	struct Diagnostic {
+		enum class Severity : unsigned char {
+			Warning,
+			Error,
+			Fatal
+		};
+
+		Severity severity;
+		/// Empty for buffers and strings.
+		std::string file;
+		/// From 1, 0 when the diagnostic has no position in the source.
+		unsigned int line;
+		unsigned int column;
+		std::string message;
+		int code;
+	};
+
+	/// Appends "file:line:column: severity: message" and a newline to p_out.
+	void write_diagnostic(std::string& p_out, const Diagnostic& p_diagnostic);
+
+	/// Receives the errors and warnings of parsers it is set on, see BasicParser::set_diagnostic_sink.
+	///
+	/// report may be called from several threads at once. While a parser with a sink parses, the
+	/// sink is current on that thread and include files merged by the parse report to it as well.
+	class DiagnosticSink {
+	public:
+		virtual ~DiagnosticSink() = default;
+
+		virtual void report(Diagnostic&& p_diagnostic) = 0;
+		virtual void flush() {}
+		/// Parsers neither build diagnostics for a discarding sink nor format lexy's source visualization.
+		virtual bool discards() const { return false; }
+
+		/// Sink of the parse running on this thread, nullptr outside of one.
+		static DiagnosticSink* current() { return _current; }
+
+		/// Makes p_sink current on the constructing thread until destroyed.
+		class Scope {
+		public:
+			explicit Scope(DiagnosticSink* p_sink) : _previous(_current) { _current = p_sink; }
+			~Scope() { _current = _previous; }
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+		private:
+			DiagnosticSink* _previous;
+		};
+
+	private:
+		static inline thread_local DiagnosticSink* _current = nullptr;
+	};
+
+	class NullDiagnosticSink final : public DiagnosticSink {
+	public:
+		void report(Diagnostic&&) override {}
+		bool discards() const override { return true; }
+
+		static NullDiagnosticSink& instance();
+	};
+
+	/// Collects diagnostics in a buffer per reporting thread and hands them on in batches.
+	///
+	/// Reporting only takes the lock when a thread's buffer is full, or the first time a thread
+	/// reports. Batches go to p_flush, or are formatted with write_diagnostic and written to the
+	/// stream in one call, under the lock so batches of different threads never interleave.
+	class BufferedDiagnosticSink final : public DiagnosticSink {
+	public:
+		using Flush = std::function<void(std::vector<Diagnostic>& p_batch)>;
+
+		explicit BufferedDiagnosticSink(std::ostream& p_stream, std::size_t p_batch_size = 64);
+		explicit BufferedDiagnosticSink(Flush p_flush, std::size_t p_batch_size = 64);
+		~BufferedDiagnosticSink() override;
+
+		BufferedDiagnosticSink(const BufferedDiagnosticSink&) = delete;
+		BufferedDiagnosticSink& operator=(const BufferedDiagnosticSink&) = delete;
+
+		void report(Diagnostic&& p_diagnostic) override;
+		/// Flushes the buffer of every thread, only call it once no other thread reports.
+		void flush() override;
+		/// Flushes the calling thread's buffer, safe while other threads report.
+		void flush_thread();
+
+	private:
+		struct Buffer {
+			std::vector<Diagnostic> pending;
+		};
+
+		Flush _flush;
+		std::size_t _batch_size;
+		std::uint64_t _id;
+
+		/// Guards _buffers and calls to _flush.
+		std::mutex _mutex;
+		std::unordered_map<std::thread::id, std::unique_ptr<Buffer>> _buffers;
+
+		Buffer& _local();
+		void _drain(Buffer& buffer);
+	};
+}
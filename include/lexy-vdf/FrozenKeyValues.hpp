@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+#include <lexy-vdf/KeyValues.hpp>
+
+namespace lexy_vdf {
+	class FrozenKeyValues;
+
+	using FrozenString = std::shared_ptr<const std::string>;
+	using FrozenBlock = std::shared_ptr<const FrozenKeyValues>;
+	using FrozenValueType = std::variant<std::monostate, FrozenString, std::int32_t, std::float_t, FrozenBlock>;
+
+	/// Immutable, structurally shared counterpart of KeyValues.
+	///
+	/// Blocks and strings are reference counted so that every version produced by
+	/// freeze or with shares the subtrees it did not change, entries are kept sorted by key.
+	/// Conditional entries kept for KeyValues::resolve are copied as they are and not shared.
+	class FrozenKeyValues {
+	public:
+		struct Entry {
+			KeyType key;
+			FrozenValueType value;
+		};
+		using const_iterator = std::vector<Entry>::const_iterator;
+
+		explicit FrozenKeyValues(std::vector<Entry> entries, std::vector<ConditionalEntry> conditionals = {});
+
+		static FrozenBlock freeze(const KeyValues& p_key_values);
+		static FrozenBlock freeze(const KeyValues& p_key_values, const FrozenBlock& p_previous);
+
+		FrozenBlock with(std::span<const KeyObserverType> p_path, const ValueType& p_value) const;
+		FrozenBlock without(std::span<const KeyObserverType> p_path) const;
+
+		KeyValues thaw() const;
+		bool equals(const KeyValues& p_key_values) const;
+		bool equals(const FrozenKeyValues& p_other) const;
+
+		const FrozenValueType* find(KeyObserverType p_key) const;
+		bool contains(KeyObserverType p_key) const;
+
+		std::int32_t GetInt(KeyObserverType p_key, std::int32_t p_default_value = 0) const;
+		std::float_t GetFloat(KeyObserverType p_key, std::float_t p_default_value = 0) const;
+		std::string_view GetString(KeyObserverType p_key, std::string_view p_default_value = "") const;
+		FrozenBlock GetBlock(KeyObserverType p_key) const;
+
+		const_iterator begin() const { return _entries.begin(); }
+		const_iterator end() const { return _entries.end(); }
+		std::size_t size() const { return _entries.size(); }
+		bool empty() const { return _entries.empty(); }
+		const std::vector<ConditionalEntry>& conditionals() const { return _conditionals; }
+
+		/// Matches KeyValues::hash for equal content.
+		std::size_t hash() const { return _hash; }
+
+	private:
+		std::vector<Entry> _entries;
+		std::vector<ConditionalEntry> _conditionals;
+		std::size_t _hash;
+
+		const_iterator _lower_bound(KeyObserverType key) const;
+	};
+
+	/// Hash-conses frozen trees, equal strings and blocks frozen through the same interner are a single shared object.
+	class FrozenInterner {
+	public:
+		struct Stats {
+			std::size_t strings = 0;
+			std::size_t shared_strings = 0;
+			std::size_t blocks = 0;
+			std::size_t shared_blocks = 0;
+			/// Bytes the shared duplicates would have taken as independent copies.
+			std::size_t bytes_saved = 0;
+		};
+
+		FrozenBlock freeze(const KeyValues& p_key_values);
+		FrozenBlock intern(const FrozenBlock& p_block);
+		FrozenString intern(std::string_view p_string);
+
+		const Stats& get_stats() const { return _stats; }
+		std::size_t unique_strings() const { return _strings.size(); }
+		std::size_t unique_blocks() const { return _blocks.size(); }
+
+		void clear();
+
+	private:
+		struct StringHash {
+			using is_transparent = void;
+			std::size_t operator()(std::string_view string) const;
+			std::size_t operator()(const FrozenString& string) const { return (*this)(std::string_view(*string)); }
+		};
+		struct StringEqual {
+			using is_transparent = void;
+			bool operator()(std::string_view lhs, std::string_view rhs) const { return lhs == rhs; }
+			bool operator()(const FrozenString& lhs, std::string_view rhs) const { return *lhs == rhs; }
+			bool operator()(std::string_view lhs, const FrozenString& rhs) const { return lhs == *rhs; }
+			bool operator()(const FrozenString& lhs, const FrozenString& rhs) const { return *lhs == *rhs; }
+		};
+		struct BlockHash {
+			std::size_t operator()(const FrozenBlock& block) const { return block->hash(); }
+		};
+		struct BlockEqual {
+			bool operator()(const FrozenBlock& lhs, const FrozenBlock& rhs) const;
+		};
+
+		std::unordered_set<FrozenString, StringHash, StringEqual> _strings;
+		std::unordered_set<FrozenBlock, BlockHash, BlockEqual> _blocks;
+		Stats _stats;
+
+		FrozenValueType _freeze_value(const ValueType& value);
+		FrozenValueType _intern_value(const FrozenValueType& value);
+		FrozenBlock _intern_block(FrozenBlock block);
+	};
+
+	/// Publication point for FrozenKeyValues versions, readers never block on a publish.
+	class AtomicFrozenKeyValues {
+	public:
+		AtomicFrozenKeyValues() = default;
+		explicit AtomicFrozenKeyValues(FrozenBlock p_initial) : _current(std::move(p_initial)) {}
+
+		AtomicFrozenKeyValues(const AtomicFrozenKeyValues&) = delete;
+		AtomicFrozenKeyValues& operator=(const AtomicFrozenKeyValues&) = delete;
+
+		FrozenBlock load() const {
+#if __cpp_lib_atomic_shared_ptr >= 201711L
+			return _current.load(std::memory_order_acquire);
+#else
+			return std::atomic_load_explicit(&_current, std::memory_order_acquire);
+#endif
+		}
+
+		void publish(FrozenBlock p_next) {
+#if __cpp_lib_atomic_shared_ptr >= 201711L
+			_current.store(std::move(p_next), std::memory_order_release);
+#else
+			std::atomic_store_explicit(&_current, std::move(p_next), std::memory_order_release);
+#endif
+		}
+
+		/// Freezes p_key_values against the current version and publishes the result, expects a single writer.
+		FrozenBlock publish(const KeyValues& p_key_values) {
+			FrozenBlock next = FrozenKeyValues::freeze(p_key_values, load());
+			publish(next);
+			return next;
+		}
+
+	private:
+#if __cpp_lib_atomic_shared_ptr >= 201711L
+		std::atomic<FrozenBlock> _current;
+#else
+		FrozenBlock _current;
+#endif
+	};
+}
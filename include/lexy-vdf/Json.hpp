@@ -0,0 +1,50 @@
+#pragma once
+
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <lexy-vdf/ParseError.hpp>
+#include <lexy-vdf/ParseWarning.hpp>
+#include <lexy-vdf/Writer.hpp>
+
+namespace lexy_vdf {
+	struct JsonOptions {
+		bool pretty = true;
+		bool use_default_conditions = true;
+		std::vector<std::string> conditions;
+	};
+
+	struct TranscodeResult {
+		std::vector<ParseError> errors;
+		std::vector<ParseWarning> warnings;
+
+		bool has_error() const { return !errors.empty(); }
+		explicit operator bool() const { return errors.empty(); }
+	};
+
+	///
+	/// @brief Streams VDF source to JSON without building KeyValues
+	///
+	/// Keys repeated within a block become an array of their values in source order, integers
+	/// stay integers and floats are always written with a fraction or exponent. Unquoted words are
+	/// checked with the grammar's own rules and statements dropped by their condition are still
+	/// checked, so the transcode fails where Parser::parse would. A word the grammar would split
+	/// into two tokens, like 1.5abc, fails it as well.
+	///
+	TranscodeResult vdf_to_json(std::string_view p_vdf, std::string& p_out, const JsonOptions& p_options = {});
+	TranscodeResult vdf_to_json(std::string_view p_vdf, std::ostream& p_out, const JsonOptions& p_options = {});
+	TranscodeResult vdf_file_to_json(const std::filesystem::path& p_path, std::ostream& p_out, const JsonOptions& p_options = {});
+
+	///
+	/// @brief Streams a JSON object to VDF, the reverse of vdf_to_json
+	///
+	/// Arrays repeat their key once per element, booleans become 1 and 0 and null members are dropped.
+	/// A string the Writer would refuse, with a control character VDF has no escape for, fails the transcode.
+	///
+	TranscodeResult json_to_vdf(std::string_view p_json, std::string& p_out, Writer::Style p_style = Writer::Style::Pretty);
+	TranscodeResult json_to_vdf(std::string_view p_json, std::ostream& p_out, Writer::Style p_style = Writer::Style::Pretty);
+	TranscodeResult json_file_to_vdf(const std::filesystem::path& p_path, std::ostream& p_out, Writer::Style p_style = Writer::Style::Pretty);
+}
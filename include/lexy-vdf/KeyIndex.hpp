@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/StringHash.hpp>
+
+namespace lexy_vdf {
+	/// Inverted index from keys, and optionally string values, to every entry of a tree holding them.
+	///
+	/// Entries are referenced by address, which unordered_map keeps stable, so the tree must
+	/// outlive the index. The index records the tree's KeyValues::modification_count and rebuilds
+	/// on the next use once it changed, apply_patch keeps it current without a full rebuild. Hits
+	/// are only valid until the index is rebuilt, block_of and path_of reject older ones.
+	/// Lookups may rebuild, so concurrent lookups need the tree left unchanged meanwhile.
+	/// Conditional entries kept for KeyValues::resolve are not indexed.
+	class KeyIndex {
+	public:
+		using NodeId = std::uint32_t;
+		static constexpr NodeId no_node = static_cast<NodeId>(-1);
+
+		struct Hit {
+			const KeyValues::value_type* entry;
+			NodeId node;
+			/// Rebuild of the index the hit was found in.
+			std::uint64_t generation;
+		};
+
+		KeyIndex() = default;
+		explicit KeyIndex(const KeyValues& p_root, bool p_index_string_values = false);
+
+		void rebuild(const KeyValues& p_root);
+
+		std::vector<Hit> find_key(KeyObserverType p_key) const;
+		/// Empty unless string values are indexed.
+		std::vector<Hit> find_value(std::string_view p_value) const;
+		std::vector<Hit> find(KeyObserverType p_key, std::string_view p_value) const;
+
+		/// Block holding the entry of p_hit, nullptr if the hit is stale.
+		const KeyValues* block_of(const Hit& p_hit) const;
+		/// Empty if the hit is stale.
+		std::vector<KeyType> path_of(const Hit& p_hit) const;
+
+		/// Applies p_patch to p_root and reindexes only the entries it touched.
+		KeyValues::PatchError apply_patch(KeyValues& p_root, const Patch& p_patch);
+
+		/// Number of indexed entries.
+		std::size_t size() const;
+		bool indexes_string_values() const { return _index_string_values; }
+
+	private:
+		using PostingMap = std::unordered_map<std::string, std::vector<NodeId>, string_hash, std::equal_to<>>;
+
+		struct Node {
+			/// nullptr once the entry was removed, its id stays in the posting lists until the next rebuild.
+			const KeyValues::value_type* entry;
+			NodeId parent;
+		};
+
+		const KeyValues* _root = nullptr;
+		bool _index_string_values = false;
+		/// Kept current by lookups, which rebuild them once the tree changed.
+		mutable std::uint64_t _modifications = 0;
+		mutable std::uint64_t _generation = 0;
+		mutable std::vector<Node> _nodes;
+		mutable std::unordered_map<const KeyValues::value_type*, NodeId> _entry_nodes;
+		mutable PostingMap _keys;
+		mutable PostingMap _values;
+
+		void _refresh() const;
+		void _reindex() const;
+		void _index_block(const KeyValues& block, NodeId parent) const;
+		void _index_entry(const KeyValues::value_type& entry, NodeId parent) const;
+		void _remove_entry(const KeyValues::value_type& entry);
+		bool _is_live(const Hit& hit) const;
+		const KeyValues::value_type* _locate(const std::vector<KeyType>& path, NodeId& parent) const;
+		std::vector<Hit> _live(const PostingMap& postings, std::string_view key) const;
+	};
+}
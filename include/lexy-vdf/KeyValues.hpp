@@ -8,26 +8,20 @@
 #include <string_view>
 #include <unordered_map>
 #include <variant>
+#include <vector>
+
+#include <lexy-vdf/ConditionSet.hpp>
+#include <lexy-vdf/MemoryUsage.hpp>
+#include <lexy-vdf/StringHash.hpp>
 
 namespace lexy_vdf {
 	class KeyValues;
+	class CompiledPath;
+	struct PatchEntry;
+	struct ConditionalEntry;
 
-	using KeyType = std::string;
-	using KeyObserverType = std::string_view;
 	using ValueType = std::variant<std::monostate, std::string, std::int32_t, std::float_t, KeyValues>;
-
-	struct string_hash {
-		using is_transparent = void;
-		[[nodiscard]] size_t operator()(const char* txt) const {
-			return std::hash<std::string_view> {}(txt);
-		}
-		[[nodiscard]] size_t operator()(std::string_view txt) const {
-			return std::hash<std::string_view> {}(txt);
-		}
-		[[nodiscard]] size_t operator()(std::string& txt) const {
-			return std::hash<std::string> {}(txt);
-		}
-	};
+	using Patch = std::vector<PatchEntry>;
 
 	class KeyValues : public std::unordered_map<KeyType, ValueType, string_hash, std::equal_to<>> {
 	public:
@@ -40,9 +34,10 @@ namespace lexy_vdf {
 		KeyValues(KeyValues&&) = default;
 		KeyValues(KeyValues&) = default;
 		KeyValues(const KeyValues&) = default;
-		KeyValues& operator=(KeyValues&) = default;
-		KeyValues& operator=(const KeyValues&) = default;
-		KeyValues& operator=(KeyValues&&) = default;
+		/// Assignments count as a modification of this tree, the count itself isn't copied.
+		KeyValues& operator=(KeyValues& p_other);
+		KeyValues& operator=(const KeyValues& p_other);
+		KeyValues& operator=(KeyValues&& p_other);
 
 		static std::unique_ptr<KeyValues> from_buffer(const char* data, std::size_t size);
 		static std::unique_ptr<KeyValues> from_buffer(const char* start, const char* end);
@@ -50,18 +45,83 @@ namespace lexy_vdf {
 		static std::unique_ptr<KeyValues> from_file(std::string_view path);
 		static std::unique_ptr<KeyValues> from_file(const std::filesystem::path& path);
 
+		/// Resolves a key present in both trees of deep_merge, blocks under it are always merged recursively.
+		enum class MergePolicy {
+			OverlayWins,
+			BaseWins
+		};
+
 		enum class MergeError {
 			Success,
 			FileMissing,
 			ParseFail
 		};
+		/// Appends the file's entries like AppendKeyValues, the way #include merges a file.
 		MergeError MergeWith(const std::filesystem::path& p_path);
+		/// Deep merges the file under this tree like deep_merge, the way #base merges a file.
+		MergeError merge_base(const std::filesystem::path& p_path, MergePolicy p_policy = MergePolicy::OverlayWins);
 
+		/// Shallow, top level entries already present are kept whole, as are their conditional entries.
 		KeyValues& AppendKeyValues(const KeyValues& p_key_values);
+		/// Merges p_base into this tree, the overlay, the way #base fills in what a file lacks.
+		KeyValues& deep_merge(const KeyValues& p_base, MergePolicy p_policy = MergePolicy::OverlayWins);
+		/// Moves the entries of p_base instead of copying them, p_base is left in a valid but unspecified state.
+		KeyValues& deep_merge(KeyValues&& p_base, MergePolicy p_policy = MergePolicy::OverlayWins);
+
+		enum class PatchError {
+			Success,
+			PathMissing,
+			ValueMismatch
+		};
+		Patch diff(const KeyValues& p_other) const;
+		PatchError apply_patch(const Patch& p_patch);
+		std::size_t hash() const;
+		MemoryUsage memory_usage() const;
+
+		std::vector<const ValueType*> query(std::string_view p_path) const;
+		std::vector<const ValueType*> query(const CompiledPath& p_path) const;
+
+		const std::vector<ConditionalEntry>& conditionals() const;
+		void add_conditional(KeyType p_key, ValueType p_value, ConditionPredicate p_predicate);
+		KeyValues resolve(const ConditionSet& p_conditions) const;
+
+		/// Drops the entries and the conditional entries, keeping the bucket array.
+		void clear();
+
+		/// Counts the changes made through the members of KeyValues, so views like KeyIndex can tell
+		/// their tree changed. Changes made through the map interface, here or in nested blocks, are
+		/// only counted once mark_modified is called on this tree.
+		std::uint64_t modification_count() const { return _modifications; }
+		void mark_modified() { _modifications++; }
+
+		/// Equal trees hold the same entries and the same conditional entries in the same order.
+		friend bool operator==(const KeyValues& p_lhs, const KeyValues& p_rhs);
 
 		std::int32_t GetInt(KeyObserverType p_key, std::int32_t p_default_value = 0) const;
 		std::float_t GetFloat(KeyObserverType p_key, std::float_t p_default_value = 0) const;
 		std::string_view GetString(KeyObserverType p_key, std::string_view p_default_value = "") const;
 		bool GetBool(KeyObserverType p_key, bool p_default_value = false) const;
+
+	private:
+		std::vector<ConditionalEntry> _conditionals;
+		std::uint64_t _modifications = 0;
+	};
+
+	bool operator==(const KeyValues& p_lhs, const KeyValues& p_rhs);
+
+	/// A single change between two trees, std::monostate marks an absent value.
+	struct PatchEntry {
+		std::vector<KeyType> path;
+		ValueType old_value;
+		ValueType new_value;
+	};
+
+	/// Entry whose conditional attribute is kept for KeyValues::resolve instead of being evaluated.
+	struct ConditionalEntry {
+		KeyType key;
+		ValueType value;
+		ConditionPredicate predicate;
+
+		bool operator==(const ConditionalEntry&) const = default;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include <lexy-vdf/KeyValues.hpp>
+
+namespace lexy_vdf {
+	/// Zero-copy view over a stack of KeyValues layers, ordered from highest to lowest priority.
+	///
+	/// Scalars resolve to the first layer containing the key, blocks merge lazily with the
+	/// blocks under the same key in lower layers until a layer holds a non-block value there.
+	/// The viewed layers must outlive the view.
+	class LayeredKeyValues {
+	public:
+		using layer_list_type = std::vector<const KeyValues*>;
+		using visitor_type = std::function<void(const KeyType&, const ValueType&)>;
+
+		LayeredKeyValues() = default;
+		explicit LayeredKeyValues(layer_list_type p_layers);
+
+		LayeredKeyValues& push_top(const KeyValues& p_layer);
+		LayeredKeyValues& push_bottom(const KeyValues& p_layer);
+
+		const layer_list_type& layers() const;
+
+		const ValueType* find(KeyObserverType p_key) const;
+		bool contains(KeyObserverType p_key) const;
+		LayeredKeyValues get_block(KeyObserverType p_key) const;
+
+		void for_each(const visitor_type& p_visitor) const;
+		std::size_t size() const;
+		bool empty() const;
+
+		KeyValues flatten() const;
+
+		std::int32_t GetInt(KeyObserverType p_key, std::int32_t p_default_value = 0) const;
+		std::float_t GetFloat(KeyObserverType p_key, std::float_t p_default_value = 0) const;
+		std::string_view GetString(KeyObserverType p_key, std::string_view p_default_value = "") const;
+		bool GetBool(KeyObserverType p_key, bool p_default_value = false) const;
+
+	private:
+		layer_list_type _layers;
+
+		bool _shadowed(KeyObserverType key, std::size_t layer_index) const;
+	};
+}
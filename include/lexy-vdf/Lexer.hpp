@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace lexy_vdf {
+	struct Token {
+		enum class Kind : unsigned char {
+			Eof,
+			/// Quoted or unquoted key of a statement.
+			Key,
+			/// Quoted value, or the path of an include.
+			String,
+			/// Unquoted value that is an identifier rather than a number.
+			Word,
+			Integer,
+			Float,
+			OpenBrace,
+			CloseBrace,
+			/// Conditional attribute including its brackets.
+			Conditional,
+			/// The #include or #base keyword.
+			Include,
+			/// Line comment without its newline.
+			Comment,
+			/// Unterminated string or conditional, a stray character, or a word the grammar can't read
+			/// like a signed or overflowing integer, or an unquoted key that isn't an identifier.
+			Invalid
+		};
+
+		Kind kind;
+		/// Points into the source passed to the lexer.
+		std::string_view text;
+
+		bool is_quoted() const {
+			return text.size() >= 2 && text.front() == '"';
+		}
+
+		/// Text of a quoted token without its quotes, still escaped.
+		std::string_view unquoted() const {
+			return is_quoted() ? text.substr(1, text.size() - 2) : text;
+		}
+	};
+
+	/// Splits VDF source into tokens without building a tree or copying any text.
+	///
+	/// Keys and values are told apart by their position in a statement, unquoted words are read by
+	/// the grammar's own productions, so a word like 1.5abc is split into the Float 1.5 and the
+	/// Key abc just like the parser splits it. Whitespace is not returned, it is the gaps between tokens.
+	class Lexer {
+	public:
+		struct Location {
+			std::size_t line;
+			/// In bytes, from 1.
+			std::size_t column;
+		};
+
+		explicit Lexer(std::string_view p_source);
+
+		/// Returns the next token, Eof once the source is exhausted.
+		Token next();
+
+		std::size_t offset(const Token& p_token) const {
+			return static_cast<std::size_t>(p_token.text.data() - _source.data());
+		}
+
+		/// Resolved on demand, cheap while queried in source order.
+		Location location(std::size_t p_offset) const;
+		Location location(const Token& p_token) const {
+			return location(offset(p_token));
+		}
+
+		std::string_view get_source() const { return _source; }
+
+	private:
+		enum class Expect : unsigned char {
+			Key,
+			Value,
+			IncludePath
+		};
+
+		std::string_view _source;
+		const char* _cursor;
+		Expect _expect = Expect::Key;
+
+		mutable std::size_t _line_offset = 0;
+		mutable std::size_t _line_start = 0;
+		mutable std::size_t _line = 1;
+	};
+}
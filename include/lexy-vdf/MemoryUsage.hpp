@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+namespace lexy_vdf {
+	/// Estimated heap footprint of a KeyValues tree, see KeyValues::memory_usage.
+	struct MemoryUsage {
+		/// Heap storage of keys too long for the small string buffer.
+		std::size_t key_bytes = 0;
+		/// Heap storage of string values too long for the small string buffer.
+		std::size_t string_value_bytes = 0;
+		/// Hash table nodes, each holding a key, a value and the chain link.
+		std::size_t node_bytes = 0;
+		/// Hash table bucket arrays.
+		std::size_t bucket_bytes = 0;
+		/// Kept conditional entries and their predicates.
+		std::size_t conditional_bytes = 0;
+		std::size_t nodes = 0;
+		/// Blocks in the tree, the root included.
+		std::size_t maps = 0;
+		std::size_t allocations = 0;
+
+		constexpr std::size_t total() const {
+			return key_bytes + string_value_bytes + node_bytes + bucket_bytes + conditional_bytes;
+		}
+
+		constexpr MemoryUsage& operator+=(const MemoryUsage& p_other) {
+			key_bytes += p_other.key_bytes;
+			string_value_bytes += p_other.string_value_bytes;
+			node_bytes += p_other.node_bytes;
+			bucket_bytes += p_other.bucket_bytes;
+			conditional_bytes += p_other.conditional_bytes;
+			nodes += p_other.nodes;
+			maps += p_other.maps;
+			allocations += p_other.allocations;
+			return *this;
+		}
+	};
+
+	/// Process wide allocation counters, fed by CountingAllocator or by a replaced global operator new.
+	class AllocationCounter {
+	public:
+		struct Stats {
+			std::size_t allocations;
+			std::size_t deallocations;
+			std::size_t bytes_allocated;
+			std::size_t bytes_in_use;
+			std::size_t peak_bytes_in_use;
+		};
+
+		static void record_allocation(std::size_t p_bytes);
+		static void record_deallocation(std::size_t p_bytes);
+
+		static Stats get_stats();
+		static void reset();
+	};
+
+	/// Standard allocator that reports every allocation to AllocationCounter.
+	template<typename T>
+	struct CountingAllocator {
+		using value_type = T;
+
+		CountingAllocator() = default;
+		template<typename U>
+		constexpr CountingAllocator(const CountingAllocator<U>&) noexcept {}
+
+		T* allocate(std::size_t p_count) {
+			AllocationCounter::record_allocation(p_count * sizeof(T));
+			return static_cast<T*>(::operator new(p_count * sizeof(T), std::align_val_t { alignof(T) }));
+		}
+
+		void deallocate(T* p_pointer, std::size_t p_count) noexcept {
+			AllocationCounter::record_deallocation(p_count * sizeof(T));
+			::operator delete(p_pointer, std::align_val_t { alignof(T) });
+		}
+
+		template<typename U>
+		friend constexpr bool operator==(const CountingAllocator&, const CountingAllocator<U>&) noexcept {
+			return true;
+		}
+	};
+}
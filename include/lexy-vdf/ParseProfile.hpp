@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lexy_vdf {
+	/// Per production statistics of a parse, only collected when the library is built with LVDF_PROFILING.
+	struct ParseProfile {
+		struct Production {
+			std::string_view name;
+			std::size_t count = 0;
+			std::size_t bytes = 0;
+			/// Inclusive of nested productions, recursive productions count their nesting repeatedly.
+			std::chrono::nanoseconds time {};
+		};
+
+		struct Include {
+			std::string path;
+			std::chrono::nanoseconds time {};
+		};
+
+		std::vector<Production> productions;
+		std::vector<Include> includes;
+		/// Time spent storing statements into KeyValues.
+		std::chrono::nanoseconds insert_time {};
+		std::size_t inserts = 0;
+		std::chrono::nanoseconds total_time {};
+		bool collected = false;
+
+		/// Adds the statistics of p_other, collected over the same productions, total_time is left alone.
+		void merge(const ParseProfile& p_other) {
+			for (std::size_t index = 0; index < productions.size() && index < p_other.productions.size(); index++) {
+				productions[index].count += p_other.productions[index].count;
+				productions[index].bytes += p_other.productions[index].bytes;
+				productions[index].time += p_other.productions[index].time;
+			}
+			includes.insert(includes.end(), p_other.includes.begin(), p_other.includes.end());
+			insert_time += p_other.insert_time;
+			inserts += p_other.inserts;
+		}
+
+		void clear() {
+			productions.clear();
+			includes.clear();
+			insert_time = {};
+			inserts = 0;
+			total_time = {};
+			collected = false;
+		}
+	};
+}
@@ -1,12 +1,17 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <string_view>
-#include <unordered_set>
 #include <vector>
 
+#include <lexy-vdf/CompiledPath.hpp>
+#include <lexy-vdf/ConditionSet.hpp>
 #include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/ParseProfile.hpp>
 #include <lexy-vdf/ParseWarning.hpp>
+#include <lexy-vdf/SourceSpans.hpp>
 #include <lexy-vdf/detail/BasicParser.hpp>
 
 namespace lexy_vdf {
@@ -14,11 +19,23 @@ namespace lexy_vdf {
 	class Parser final : public detail::BasicParser {
 	public:
 		struct State {
-			std::unordered_set<std::string, string_hash, std::equal_to<>> conditionals;
+			ConditionSet conditions;
+			bool keep_conditionals = false;
 			std::vector<ParseWarning>* parse_warnings;
+			/// Set for the duration of a parse when spans are tracked.
+			SourceSpans* spans = nullptr;
+			const char* source_begin = nullptr;
+			/// End of the input being parsed, lets rules scan ahead in bulk.
+			const char* source_end = nullptr;
+			/// Top level #base files, merged once the file is parsed.
+			std::vector<std::string> bases;
 
 			inline bool has_condition(std::string_view conditional) const {
-				return conditionals.find(conditional) != conditionals.end();
+				return conditions.contains(conditional);
+			}
+
+			inline std::uint32_t offset_of(const char* position) const {
+				return static_cast<std::uint32_t>(position - source_begin);
 			}
 		};
 
@@ -42,11 +59,28 @@ namespace lexy_vdf {
 		}
 
 		bool parse();
+		bool parse_parallel(std::size_t threads = 0);
+
+		Parser& reset();
+		bool reparse(std::string_view source);
+		bool reparse(const char* data, std::size_t size);
+
+		/// Only the subtrees selected by paths are built. Blocks outside of them are skipped by
+		/// matching braces and quotes without being validated, so malformed input there is not reported.
+		Parser& set_projection(std::vector<CompiledPath> paths);
+		Parser& add_projection(CompiledPath path);
+		void clear_projection();
+		const std::vector<CompiledPath>& get_projection() const;
 
 		const KeyValues* get_key_values();
+		/// The loaded document, transcoded to UTF-8, empty when nothing is loaded.
+		std::string_view get_source() const;
 		KeyValues* release_key_values();
+		/// Takes back a tree released earlier, emptied, the next parse builds its result in it and keeps the table it grew.
+		Parser& recycle_key_values(std::unique_ptr<KeyValues> p_key_values);
 
-		const State get_parse_state() const;
+		const State& get_parse_state() const;
+		const ParseProfile& get_profile() const;
 
 		void set_default_conditions();
 		void clear_conditions();
@@ -55,6 +89,17 @@ namespace lexy_vdf {
 		bool remove_condition(std::string_view conditional);
 		bool has_condition(std::string_view conditional) const;
 
+		const ConditionSet& get_conditions() const;
+		void set_conditions(ConditionSet conditions);
+
+		Parser& set_keep_conditionals(bool keep);
+		bool get_keep_conditionals() const;
+
+		Parser& set_track_spans(bool track);
+		bool get_track_spans() const;
+		const SourceSpans& get_source_spans() const;
+		SourceSpans release_source_spans();
+
 		Parser(Parser&&);
 		Parser& operator=(Parser&&);
 
@@ -64,7 +109,20 @@ namespace lexy_vdf {
 		class BufferHandler;
 		std::unique_ptr<BufferHandler> _buffer_handler;
 		std::unique_ptr<KeyValues> _key_values;
+		/// Emptied tree of an earlier parse, the next parse builds its root in it.
+		std::unique_ptr<KeyValues> _recycled;
 		State _parser_state;
+		std::vector<CompiledPath> _projection;
+		ParseProfile _profile;
+		SourceSpans _spans;
+		bool _track_spans = false;
+
+		struct Projector;
+		bool _parse_projected();
+
+		struct ParallelParse;
+
+		void _merge_bases(KeyValues& values);
 
 		template<typename... Args>
 		constexpr void _run_load_func(detail::LoadCallback<BufferHandler, Args...> auto func, Args... args);
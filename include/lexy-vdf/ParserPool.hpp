@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <lexy-vdf/Parser.hpp>
+
+namespace lexy_vdf {
+	/// Keeps reset parsers around so that parsing many small documents skips their setup.
+	class ParserPool {
+	public:
+		/// Hands a parser back to its pool when destroyed.
+		class Lease {
+		public:
+			Lease(Lease&& other) noexcept;
+			Lease& operator=(Lease&& other) noexcept;
+			Lease(const Lease&) = delete;
+			Lease& operator=(const Lease&) = delete;
+			~Lease();
+
+			Parser& get() const { return *_parser; }
+			Parser& operator*() const { return *_parser; }
+			Parser* operator->() const { return _parser.get(); }
+
+		private:
+			friend class ParserPool;
+			Lease(ParserPool& pool, std::unique_ptr<Parser> parser);
+
+			ParserPool* _pool;
+			std::unique_ptr<Parser> _parser;
+		};
+
+		explicit ParserPool(std::size_t p_max_idle = 8);
+
+		static ParserPool& local();
+
+		Lease acquire();
+
+		std::size_t idle_count() const { return _idle.size(); }
+		std::size_t get_max_idle() const { return _max_idle; }
+		void set_max_idle(std::size_t p_max_idle);
+		void clear();
+
+	private:
+		std::vector<std::unique_ptr<Parser>> _idle;
+		std::size_t _max_idle;
+
+		void _release(std::unique_ptr<Parser> parser);
+	};
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/ParseError.hpp>
+#include <lexy-vdf/ParseWarning.hpp>
+#include <lexy-vdf/Parser.hpp>
+
+namespace lexy_vdf {
+	/// Reads a stream of concatenated top level statements as independent documents.
+	///
+	/// Each statement is parsed on its own by one reused parser, so a later record with the same
+	/// key as an earlier one is still returned. Offsets are absolute byte offsets into the file
+	/// or string, get_offset() is where a later load has to resume.
+	class RecordStream {
+	public:
+		struct Record {
+			std::size_t offset;
+			std::string_view source;
+			/// Owned by the stream, emptied and reused for the next record, nullptr if the record failed to parse.
+			KeyValues* key_values;
+			/// Locations are relative to the start of the record.
+			const std::vector<ParseError>* errors;
+			const std::vector<ParseWarning>* warnings;
+		};
+
+		enum class Status {
+			Ok,
+			/// Every complete record was read.
+			End,
+			/// The data ends inside a record, load again from get_offset() once more is written.
+			Incomplete,
+			/// The data cannot be split into statements at get_offset().
+			Malformed
+		};
+
+		class iterator {
+		public:
+			using value_type = Record;
+			using difference_type = std::ptrdiff_t;
+
+			iterator() = default;
+
+			const Record& operator*() const { return _stream->_record; }
+			const Record* operator->() const { return &_stream->_record; }
+
+			iterator& operator++() {
+				_stream->next();
+				return *this;
+			}
+			void operator++(int) { ++*this; }
+
+			bool operator==(std::default_sentinel_t) const {
+				return _stream == nullptr || _stream->_status != Status::Ok;
+			}
+
+		private:
+			friend class RecordStream;
+			explicit iterator(RecordStream* p_stream) : _stream(p_stream) {}
+
+			RecordStream* _stream = nullptr;
+		};
+
+		RecordStream();
+
+		/// Reads source in place, it has to outlive the stream. A record ending exactly at the end of source is only read if p_final.
+		RecordStream& load_from_string(std::string_view p_source, std::size_t p_offset = 0, bool p_final = true);
+		/// Reads the file from p_offset to its current end, the last record is held back unless followed by a separator.
+		bool load_from_file(const std::filesystem::path& p_path, std::size_t p_offset = 0);
+
+		/// Reads the next record, valid while status is Ok.
+		Status next();
+		Status get_status() const { return _status; }
+		const Record& get_record() const { return _record; }
+		std::size_t get_offset() const { return _offset; }
+
+		iterator begin() {
+			next();
+			return iterator(this);
+		}
+		std::default_sentinel_t end() const { return {}; }
+
+		/// The parser used for every record, configure conditions or the error log through it.
+		Parser& get_parser() { return _parser; }
+
+	private:
+		Parser _parser;
+		std::string _storage;
+		std::string_view _source;
+		std::size_t _base_offset = 0;
+		std::size_t _cursor = 0;
+		std::size_t _offset = 0;
+		bool _final = true;
+		Status _status = Status::End;
+		Record _record {};
+		std::unique_ptr<KeyValues> _key_values;
+
+		void _load(std::string_view source, std::size_t offset, bool final);
+	};
+}
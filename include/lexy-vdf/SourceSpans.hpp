@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <lexy-vdf/KeyValues.hpp>
+
+namespace lexy_vdf {
+	/// Byte offsets of the keys and values of parsed entries, recorded when Parser::set_track_spans is on.
+	///
+	/// Entries are identified by address, which unordered_map keeps stable, so spans stay valid
+	/// while the parsed tree is alive and the entry is not erased. Entries merged from include
+	/// files have no span. Line and column are looked up in a table of line starts built once
+	/// per parse.
+	class SourceSpans {
+	public:
+		struct Span {
+			std::uint32_t key;
+			std::uint32_t value;
+		};
+
+		struct Location {
+			std::size_t line;
+			/// In bytes, from 1.
+			std::size_t column;
+		};
+
+		/// The first lookup after parsing sorts the table, do it before sharing the spans between threads.
+		std::optional<Span> find(const KeyValues::value_type& p_entry) const;
+		std::optional<Location> key_location(const KeyValues::value_type& p_entry) const;
+		std::optional<Location> value_location(const KeyValues::value_type& p_entry) const;
+		Location location(std::uint32_t p_offset) const;
+
+		std::size_t size() const { return _records.size(); }
+		bool empty() const { return _records.empty(); }
+		void clear();
+
+		void record(const KeyValues::value_type& p_entry, std::uint32_t p_key, std::uint32_t p_value);
+		/// Forgets the entries of a value the parser dropped, before their addresses can be reused.
+		void discard(const ValueType& p_value);
+		void index_lines(std::string_view p_source);
+
+	private:
+		struct Record {
+			const KeyValues::value_type* entry;
+			Span span;
+		};
+
+		mutable std::vector<Record> _records;
+		mutable bool _sorted = true;
+		std::vector<std::uint32_t> _line_starts;
+
+		void _sort() const;
+	};
+}
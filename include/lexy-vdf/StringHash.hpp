@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace lexy_vdf {
+	using KeyType = std::string;
+	using KeyObserverType = std::string_view;
+
+	/// Lookup key carrying its precomputed string_hash value.
+	struct PrehashedKey {
+		KeyObserverType key;
+		std::size_t hash;
+
+		friend bool operator==(const PrehashedKey& lhs, KeyObserverType rhs) {
+			return lhs.key == rhs;
+		}
+	};
+
+	struct string_hash {
+		using is_transparent = void;
+		[[nodiscard]] size_t operator()(const char* txt) const {
+			return std::hash<std::string_view> {}(txt);
+		}
+		[[nodiscard]] size_t operator()(std::string_view txt) const {
+			return std::hash<std::string_view> {}(txt);
+		}
+		[[nodiscard]] size_t operator()(std::string& txt) const {
+			return std::hash<std::string> {}(txt);
+		}
+		[[nodiscard]] size_t operator()(const PrehashedKey& key) const {
+			return key.hash;
+		}
+	};
+}
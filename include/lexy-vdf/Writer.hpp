@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include <lexy-vdf/KeyValues.hpp>
+
+namespace lexy_vdf {
+	/// Serializes KeyValues as VDF text into its own buffer, handing full chunks to a sink if one is set.
+	///
+	/// Strings the grammar can't read back, with control characters that have no escape or
+	/// malformed UTF-8, are refused: their entry, or block with everything in it, is left out
+	/// and get_error reports it.
+	class Writer {
+	public:
+		enum class Style : unsigned char {
+			Pretty,
+			Compact
+		};
+
+		enum class Error : unsigned char {
+			None,
+			UnwritableString
+		};
+
+		using Sink = std::function<void(std::string_view)>;
+
+		static constexpr std::size_t default_flush_size = 64 * 1024;
+
+		explicit Writer(Style p_style = Style::Pretty);
+		Writer(Sink p_sink, Style p_style = Style::Pretty, std::size_t p_flush_size = default_flush_size);
+		Writer(std::ostream& p_stream, Style p_style = Style::Pretty, std::size_t p_flush_size = default_flush_size);
+		~Writer();
+
+		Writer(const Writer&) = delete;
+		Writer& operator=(const Writer&) = delete;
+
+		Writer& write(const KeyValues& p_key_values);
+		Writer& write(KeyObserverType p_key, const ValueType& p_value);
+		Writer& begin_block(KeyObserverType p_key);
+		Writer& end_block();
+
+		void flush();
+		void clear();
+
+		std::string_view view() const { return _buffer; }
+		std::string take();
+
+		Style get_style() const { return _style; }
+		Error get_error() const { return _error; }
+
+		/// Whether p_string can be written quoted and read back unchanged.
+		static bool can_write(std::string_view p_string);
+		/// Refused entries are left out silently, use a Writer and get_error to detect them.
+		static std::string to_string(const KeyValues& p_key_values, Style p_style = Style::Pretty);
+
+	private:
+		std::string _buffer;
+		Sink _sink;
+		std::size_t _flush_size;
+		Style _style;
+		std::size_t _depth = 0;
+		/// Blocks opened by begin_block with a refused key, their entries are dropped until the matching end_block.
+		std::size_t _refused_depth = 0;
+		bool _separate_next = false;
+		Error _error = Error::None;
+
+		void _write_entry(KeyObserverType key, const ValueType& value, const ConditionPredicate* predicate);
+		void _write_block(const KeyValues& key_values);
+		bool _write_key(KeyObserverType key);
+		bool _open_block(KeyObserverType key);
+		void _close_block(const ConditionPredicate* predicate);
+		void _end_entry(const ConditionPredicate* predicate);
+		void _refuse(std::size_t entry_begin);
+		bool _write_string(std::string_view string);
+		void _write_int(std::int32_t value);
+		void _write_float(std::float_t value);
+		void _maybe_flush();
+	};
+}
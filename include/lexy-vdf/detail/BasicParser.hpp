@@ -1,9 +1,11 @@
 #pragma once
 
+#include <cstddef>
 #include <functional>
 #include <ostream>
 #include <vector>
 
+#include <lexy-vdf/Diagnostics.hpp>
 #include <lexy-vdf/ParseError.hpp>
 #include <lexy-vdf/ParseWarning.hpp>
 #include <lexy-vdf/detail/Concepts.hpp>
@@ -17,6 +19,9 @@ namespace lexy_vdf::detail {
 		void set_error_log_to_stderr();
 		void set_error_log_to_stdout();
 		void set_error_log_to(std::basic_ostream<char>& stream);
+		/// Reports errors and warnings to sink instead of the error log, nullptr goes back to the error log.
+		void set_diagnostic_sink(DiagnosticSink* sink);
+		DiagnosticSink* get_diagnostic_sink() const;
 
 		bool has_error() const;
 		bool has_fatal_error() const;
@@ -30,7 +35,31 @@ namespace lexy_vdf::detail {
 		std::vector<ParseWarning> _warnings;
 
 		std::reference_wrapper<std::ostream> _error_stream;
-		const char* _file_path;
+		DiagnosticSink* _diagnostic_sink = nullptr;
+		const char* _file_path = nullptr;
 		bool _has_fatal_error = false;
+
+		/// Reports the errors and warnings added while alive to the sink, which is current meanwhile.
+		class DiagnosticScope {
+		public:
+			explicit DiagnosticScope(BasicParser& parser);
+			~DiagnosticScope();
+
+			DiagnosticScope(const DiagnosticScope&) = delete;
+			DiagnosticScope& operator=(const DiagnosticScope&) = delete;
+
+		private:
+			BasicParser& _parser;
+			std::size_t _error_count;
+			std::size_t _warning_count;
+			DiagnosticSink::Scope _current;
+		};
+
+		/// Whether lexy's source visualization of parse errors goes anywhere.
+		bool _visualizes_errors() const;
+		void _report_load_error();
+		/// Writes the errors from first_error on to the error log as one line each, without visualization.
+		void _log_errors(std::size_t first_error);
+		void _report_diagnostics(std::size_t first_error, std::size_t first_warning);
 	};
 }
@@ -0,0 +1,191 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+
+#include <lexy-vdf/Diagnostics.hpp>
+#include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/Lexer.hpp>
+#include <lexy-vdf/Parser.hpp>
+#include <lexy-vdf/SourceSpans.hpp>
+
+#include <lexy/action/parse.hpp>
+#include <lexy/callback.hpp>
+#include <lexy/dsl.hpp>
+#include <lexy/encoding.hpp>
+#include <lexy/input/string_input.hpp>
+
+#include "Grammar.hpp"
+
+#include "Checks.hpp"
+#include "Random.hpp"
+
+using namespace lexy_vdf;
+using namespace lexy_vdf::benchmarks;
+
+namespace {
+	/// The string rule of the grammar before detail::lexydsl::quoted_string replaced it.
+	struct ReferenceStringValue {
+		static constexpr auto escaped_symbols = lexy::symbol_table<char> //
+													.map<'"'>('"')
+													.map<'\''>('\'')
+													.map<'\\'>('\\')
+													.map<'/'>('/')
+													.map<'b'>('\b')
+													.map<'f'>('\f')
+													.map<'n'>('\n')
+													.map<'r'>('\r')
+													.map<'t'>('\t');
+		static constexpr auto rule = lexy::dsl::quoted(-lexy::dsl::unicode::control, lexy::dsl::backslash_escape.symbol<escaped_symbols>());
+		static constexpr auto value = lexy::as_string<std::string>;
+	};
+
+	/// Pieces strings are built from, weighted towards escapes, control characters and broken UTF-8.
+	constexpr std::string_view fragments[] = {
+		"a", "Z", "0", " ", "_", "/", "'", "{", "\x7F",
+		"\\\"", "\\'", "\\\\", "\\/", "\\b", "\\f", "\\n", "\\r", "\\t", "\\u", "\\x", "\\0", "\\",
+		"\"", "\t", "\n", "\r", std::string_view("\0", 1), "\x1F",
+		"\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xC2\x85", "\xEF\xBB\xBF",
+		"\x80", "\xBF", "\xC0\xAF", "\xC3", "\xE2\x82", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xF8", "\xFF",
+	};
+	constexpr std::size_t fragment_count = sizeof(fragments) / sizeof(fragments[0]);
+
+	std::string random_string(Random& random) {
+		std::string input = "\"";
+		const std::size_t length = random.below(12);
+		for (std::size_t index = 0; index < length; index++) {
+			input += fragments[random.below(fragment_count)];
+		}
+		if (!random.chance(0.1)) input.push_back('"');
+		return input;
+	}
+
+	void print_escaped(std::string_view text) {
+		for (const char c : text) {
+			const unsigned char byte = static_cast<unsigned char>(c);
+			if (byte < 0x20 || byte >= 0x7F || c == '\\') std::fprintf(stderr, "\\x%02X", byte);
+			else std::fputc(c, stderr);
+		}
+	}
+
+	/// Statements whose unquoted words the grammar reads as several tokens or not at all.
+	constexpr std::string_view lexer_documents[] = {
+		"key 1.5abc value", "key 1e5x y", "key 12abc value", "key 0x1Fg value", "key foo-bar",
+		"key -5", "key +5", "key -1.5", "key 0x-1", "key 0x", "key 99999999999", "key 0xFFFFFFFFF",
+		"key 2147483647", "key 007", "1key value", "-key value", "key.name value", "key value.name",
+		"k\xC3\xA9y v\xC3\xA9lue", "key \xC3\xA9", "key _1", "key 1.", "key .5", "key 1.5e", "key 1.5e+3",
+		"key 1.5[$X]", "key value//comment\n", "key{sub 1}", "key\"value\"",
+	};
+
+	Token::Kind expected_kind(const ValueType& value, std::string_view source, std::size_t offset) {
+		if (std::holds_alternative<std::int32_t>(value)) return Token::Kind::Integer;
+		if (std::holds_alternative<std::float_t>(value)) return Token::Kind::Float;
+		if (std::holds_alternative<KeyValues>(value)) return Token::Kind::OpenBrace;
+		return source[offset] == '"' ? Token::Kind::String : Token::Kind::Word;
+	}
+
+	struct LexerCheck {
+		std::string_view source;
+		const SourceSpans& spans;
+		/// Tokens by their offset in source.
+		std::unordered_map<std::size_t, Token::Kind> tokens;
+		std::size_t mismatches = 0;
+
+		void expect(std::size_t offset, Token::Kind kind) {
+			auto found = tokens.find(offset);
+			if (found != tokens.end() && found->second == kind) return;
+
+			mismatches++;
+			const Lexer::Location location = Lexer(source).location(offset);
+			std::fprintf(stderr, "lexer: token at %zu:%zu is %d, the parser read %d\n", location.line, location.column,
+				found == tokens.end() ? -1 : static_cast<int>(found->second), static_cast<int>(kind));
+		}
+
+		void walk(const KeyValues& values) {
+			for (const KeyValues::value_type& entry : values) {
+				const std::optional<SourceSpans::Span> span = spans.find(entry);
+				if (!span) continue;
+				expect(span->key, Token::Kind::Key);
+				expect(span->value, expected_kind(entry.second, source, span->value));
+				if (const KeyValues* block = std::get_if<KeyValues>(&entry.second)) walk(*block);
+			}
+		}
+	};
+
+	std::size_t check_lexer_document(std::string_view document) {
+		Parser parser = Parser::from_string(document);
+		parser.set_diagnostic_sink(&NullDiagnosticSink::instance());
+		parser.set_track_spans(true);
+		const bool parsed = parser.parse();
+
+		LexerCheck check { document, parser.get_source_spans(), {} };
+		bool lexed = true;
+		Lexer lexer(document);
+		for (Token token = lexer.next(); token.kind != Token::Kind::Eof; token = lexer.next()) {
+			lexed = lexed && token.kind != Token::Kind::Invalid;
+			check.tokens.emplace(lexer.offset(token), token.kind);
+		}
+
+		if (parsed != lexed) {
+			std::fprintf(stderr, "lexer: %s ", lexed ? "accepts" : "rejects");
+			print_escaped(document.substr(0, 64));
+			std::fprintf(stderr, " but the parser %s it\n", parsed ? "accepts" : "rejects");
+			return 1;
+		}
+		if (parsed) check.walk(*parser.get_key_values());
+		return check.mismatches;
+	}
+}
+
+///
+/// @brief Counts the strings both rules don't accept alike or decode to different values
+///
+/// Only whether each rule succeeds, recovers or fails is compared for broken strings, the values
+/// and error counts after recovery are left to each rule.
+///
+std::size_t benchmarks::check_quoted_string(std::uint64_t seed, std::size_t count) {
+	Random random(seed);
+	std::size_t mismatches = 0;
+	for (std::size_t index = 0; index < count; index++) {
+		const std::string input = random_string(random);
+		const auto string_input = lexy::string_input<lexy::utf8_char_encoding>(input.data(), input.data() + input.size());
+
+		// With the end of the input known the rule scans plain runs in bulk, without it a byte at a time
+		Parser::State state {};
+		state.source_end = input.data() + input.size();
+		auto result = lexy::parse<grammar::StringValue>(string_input, state, lexy::noop);
+		auto bytewise = lexy::parse<grammar::StringValue>(string_input, lexy::noop);
+		auto reference = lexy::parse<ReferenceStringValue>(string_input, lexy::noop);
+
+		bool same = result.is_success() == reference.is_success() && result.has_value() == reference.has_value();
+		if (same && result.is_success()) same = result.value() == reference.value();
+		same = same && bytewise.is_success() == result.is_success() && bytewise.has_value() == result.has_value();
+		if (same && result.is_success()) same = bytewise.value() == result.value();
+		if (same) continue;
+
+		mismatches++;
+		std::fprintf(stderr, "quoted string: rules disagree on ");
+		print_escaped(input);
+		std::fprintf(stderr, "\n");
+	}
+	return mismatches;
+}
+
+///
+/// @brief Counts where Lexer and Parser disagree on document and on the words of lexer_documents
+///
+/// Keys and values the parser kept are found by their source spans. Later duplicates of a key,
+/// which the parser drops as the first value wins, and entries an include merged in are not compared.
+///
+std::size_t benchmarks::check_lexer(std::string_view document) {
+	std::size_t mismatches = check_lexer_document(document);
+	for (const std::string_view statement : lexer_documents) {
+		mismatches += check_lexer_document(statement);
+	}
+	return mismatches;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace lexy_vdf::benchmarks {
+	/// Parses count random strings with grammar::StringValue and with the lexy::dsl::quoted rule it
+	/// replaced, prints every string they disagree on to stderr and returns how many there were.
+	std::size_t check_quoted_string(std::uint64_t seed, std::size_t count);
+
+	/// Tokenizes document and a set of words the grammar splits or rejects with Lexer and parses them
+	/// with Parser, counts the documents they don't both accept and the parsed keys and values the
+	/// lexer gave another kind, printing each to stderr.
+	std::size_t check_lexer(std::string_view document);
+}
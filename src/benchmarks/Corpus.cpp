@@ -0,0 +1,133 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Corpus.hpp"
+#include "Random.hpp"
+
+using namespace lexy_vdf::benchmarks;
+
+namespace {
+	constexpr const char* words[] = {
+		"unit", "building", "modifier", "icon", "cost", "attack", "defence", "speed", "supply", "morale",
+		"province", "culture", "religion", "trigger", "effect", "factor", "potential", "allow", "name", "type",
+	};
+	constexpr std::size_t word_count = sizeof(words) / sizeof(words[0]);
+
+	constexpr char escapes[] = { 'n', 't', '"', '\\', 'r' };
+
+	struct Generator {
+		const CorpusOptions& options;
+		Random random;
+		std::string out;
+		std::size_t entries = 0;
+
+		void indent(std::size_t depth) {
+			out.append(depth, '\t');
+		}
+
+		std::string make_key(std::vector<std::string>& siblings) {
+			if (!siblings.empty() && random.chance(options.duplicate_ratio)) {
+				return siblings[random.below(siblings.size())];
+			}
+			std::string key = words[random.below(word_count)];
+			key.push_back('_');
+			key += std::to_string(entries++);
+			siblings.push_back(key);
+			return key;
+		}
+
+		void write_string(std::size_t length) {
+			out.push_back('"');
+			for (std::size_t index = 0; index < length; index++) {
+				if (random.chance(options.escape_density)) {
+					out.push_back('\\');
+					out.push_back(escapes[random.below(sizeof(escapes))]);
+				} else {
+					out.push_back(static_cast<char>('a' + random.below(26)));
+				}
+			}
+			out.push_back('"');
+		}
+
+		void write_value() {
+			switch (random.below(4)) {
+				case 0: out += std::to_string(random.below(100000)); break;
+				case 1:
+					out += std::to_string(random.below(1000));
+					out.push_back('.');
+					out += std::to_string(random.below(1000));
+					break;
+				case 2:
+					out += "\"gfx/interface/";
+					out += words[random.below(word_count)];
+					out += ".dds\"";
+					break;
+				default: write_string(8 + random.below(56)); break;
+			}
+		}
+
+		void write_comment(std::size_t depth) {
+			indent(depth);
+			out += "// ";
+			out += words[random.below(word_count)];
+			out += " notes\n";
+		}
+
+		void write_block(std::size_t depth, std::size_t limit, std::vector<std::string>* root_keys) {
+			std::vector<std::string> siblings;
+			for (std::size_t index = 0; index < options.fan_out && out.size() < limit; index++) {
+				if (random.chance(options.comment_density)) write_comment(depth);
+				indent(depth);
+				const std::string key = make_key(siblings);
+				out.push_back('"');
+				out += key;
+				out += "\"\t";
+				if (depth < options.depth && random.below(3) == 0) {
+					out += "{\n";
+					write_block(depth + 1, limit, nullptr);
+					indent(depth);
+					out += "}\n";
+				} else {
+					write_value();
+					out.push_back('\n');
+				}
+			}
+			if (root_keys) root_keys->insert(root_keys->end(), siblings.begin(), siblings.end());
+		}
+
+		/// Appends top level statements until limit bytes are written.
+		void write_document(std::size_t limit, std::vector<std::string>* root_keys) {
+			while (out.size() < limit) {
+				const std::size_t before = out.size();
+				write_block(0, limit, root_keys);
+				if (out.size() == before) break;
+			}
+		}
+	};
+}
+
+Corpus lexy_vdf::benchmarks::generate_corpus(const CorpusOptions& options, const std::string& include_directory) {
+	Corpus corpus;
+	Generator generator { options, Random(options.seed), {} };
+	generator.out.reserve(options.size + 256);
+
+	for (std::size_t index = 0; index < options.include_fan_in; index++) {
+		std::string path = include_directory.empty() ? std::string() : include_directory + "/";
+		path += "include_" + std::to_string(index) + ".vdf";
+
+		generator.out += "#include \"";
+		generator.out += path;
+		generator.out += "\"\n";
+
+		Generator include { options, Random(options.seed + index + 1), {} };
+		include.entries = 1000000 * (index + 1);
+		include.write_document(options.size / 10, nullptr);
+		corpus.includes.push_back({ std::move(path), std::move(include.out) });
+	}
+
+	generator.write_document(options.size, &corpus.root_keys);
+	corpus.document = std::move(generator.out);
+	return corpus;
+}
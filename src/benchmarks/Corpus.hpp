@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lexy_vdf::benchmarks {
+	struct CorpusOptions {
+		/// Approximate size of the main document in bytes.
+		std::size_t size = 1024 * 1024;
+		/// Deepest block nesting below the root.
+		std::size_t depth = 4;
+		/// Entries per block.
+		std::size_t fan_out = 8;
+		/// Chance that an entry repeats the key of an earlier sibling.
+		double duplicate_ratio = 0.05;
+		/// Chance per string character of an escape sequence.
+		double escape_density = 0.01;
+		/// Chance per entry of a comment line before it.
+		double comment_density = 0.05;
+		/// Number of include files pulled into the root, each a tenth of size.
+		std::size_t include_fan_in = 0;
+		std::uint64_t seed = 1;
+	};
+
+	struct CorpusFile {
+		std::string path;
+		std::string content;
+	};
+
+	struct Corpus {
+		std::string document;
+		std::vector<CorpusFile> includes;
+		/// Keys of the root block, for lookup benchmarks.
+		std::vector<std::string> root_keys;
+	};
+
+	/// Generates the same corpus for the same options on every platform.
+	///
+	/// Include statements refer to include_directory/include_<n>.vdf, the caller writes the files.
+	Corpus generate_corpus(const CorpusOptions& options, const std::string& include_directory = "");
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace lexy_vdf::benchmarks {
+	/// splitmix64, the standard distributions are implementation defined so they are avoided here.
+	class Random {
+	public:
+		explicit Random(std::uint64_t seed) : _state(seed) {}
+
+		std::uint64_t next() {
+			std::uint64_t x = (_state += 0x9e3779b97f4a7c15ULL);
+			x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+			return x ^ (x >> 31);
+		}
+
+		std::size_t below(std::size_t bound) {
+			return bound == 0 ? 0 : static_cast<std::size_t>(next() % bound);
+		}
+
+		bool chance(double probability) {
+			return static_cast<double>(next() >> 11) * 0x1.0p-53 < probability;
+		}
+
+	private:
+		std::uint64_t _state;
+	};
+}
@@ -0,0 +1,574 @@
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include <lexy-vdf/AsyncLoad.hpp>
+#include <lexy-vdf/Diagnostics.hpp>
+#include <lexy-vdf/Json.hpp>
+#include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/LayeredKeyValues.hpp>
+#include <lexy-vdf/Lexer.hpp>
+#include <lexy-vdf/MemoryUsage.hpp>
+#include <lexy-vdf/Parser.hpp>
+#include <lexy-vdf/ParserPool.hpp>
+
+#include "Checks.hpp"
+#include "Corpus.hpp"
+#include "CountingNew.hpp"
+
+using namespace lexy_vdf;
+using namespace lexy_vdf::benchmarks;
+
+namespace {
+	struct Options {
+		CorpusOptions corpus;
+		std::size_t iterations = 5;
+		std::size_t small_documents = 100000;
+		std::size_t small_files = 2000;
+		std::size_t layers = 8;
+		/// Random strings of the self-checks run before the benchmarks, 0 skips them.
+		std::size_t checks = 10000;
+		std::string filter;
+		bool csv = false;
+	};
+
+	struct Result {
+		std::string name;
+		std::size_t bytes;
+		std::size_t operations;
+		double seconds;
+		std::size_t allocations;
+		std::size_t bytes_allocated;
+		std::size_t peak_rss;
+	};
+
+	std::size_t peak_rss() {
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.PeakWorkingSetSize;
+		return 0;
+#elif defined(__unix__) || defined(__APPLE__)
+		rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+		return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+		return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+		return 0;
+#endif
+	}
+
+	class Runner {
+	public:
+		explicit Runner(const Options& options) : _options(options) {
+			if (options.csv) std::printf("name,bytes,operations,seconds,mb_per_s,ops_per_s,allocations,bytes_allocated,peak_rss\n");
+		}
+
+		/// Runs body once to warm up, then iterations times, bytes and operations are per iteration.
+		void run(std::string_view name, std::size_t bytes, std::size_t operations, const std::function<bool()>& body) {
+			if (!_options.filter.empty() && name.find(_options.filter) == std::string_view::npos) return;
+			if (!body()) {
+				std::fprintf(stderr, "%.*s: failed\n", static_cast<int>(name.size()), name.data());
+				_failed = true;
+				return;
+			}
+
+			const AllocationCounter::Stats before = AllocationCounter::get_stats();
+			const auto start = std::chrono::steady_clock::now();
+			for (std::size_t iteration = 0; iteration < _options.iterations; iteration++) {
+				body();
+			}
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			const AllocationCounter::Stats after = AllocationCounter::get_stats();
+
+			const std::size_t iterations = _options.iterations;
+			report({
+				std::string(name),
+				bytes * iterations,
+				operations * iterations,
+				elapsed.count(),
+				(after.allocations - before.allocations) / iterations,
+				(after.bytes_allocated - before.bytes_allocated) / iterations,
+				peak_rss(),
+			});
+		}
+
+		bool failed() const { return _failed; }
+
+	private:
+		const Options& _options;
+		bool _failed = false;
+
+		void report(const Result& result) {
+			const double seconds = result.seconds > 0 ? result.seconds : 1e-9;
+			const double mb_per_s = static_cast<double>(result.bytes) / (1024.0 * 1024.0) / seconds;
+			const double ops_per_s = static_cast<double>(result.operations) / seconds;
+			if (_options.csv) {
+				std::printf("%s,%zu,%zu,%.6f,%.3f,%.1f,%zu,%zu,%zu\n", result.name.c_str(), result.bytes, result.operations,
+					result.seconds, mb_per_s, ops_per_s, result.allocations, result.bytes_allocated, result.peak_rss);
+			} else {
+				std::printf("{\"name\":\"%s\",\"bytes\":%zu,\"operations\":%zu,\"seconds\":%.6f,\"mb_per_s\":%.3f,\"ops_per_s\":%.1f,"
+							"\"allocations\":%zu,\"bytes_allocated\":%zu,\"peak_rss\":%zu}\n",
+					result.name.c_str(), result.bytes, result.operations, result.seconds, mb_per_s, ops_per_s,
+					result.allocations, result.bytes_allocated, result.peak_rss);
+			}
+			std::fflush(stdout);
+		}
+	};
+
+	bool write_file(const std::filesystem::path& path, std::string_view content) {
+		std::ofstream stream(path, std::ios::binary);
+		stream.write(content.data(), static_cast<std::streamsize>(content.size()));
+		return static_cast<bool>(stream);
+	}
+
+	/// Localization style document, keys are ASCII and values mix in non-ASCII text.
+	std::string make_localization(std::size_t size) {
+		std::string result = "\"l_english\"\n{\n";
+		for (std::size_t index = 0; result.size() < size; index++) {
+			result += "\t\"LOC_KEY_" + std::to_string(index) + "\"\t\"Population grows in the province of \xC3\x85land, d\xC3\xA9" "cor and na\xC3\xAFve fa\xC3\xA7" "ades ";
+			result += std::to_string(index);
+			result += "\"\n";
+		}
+		result += "}\n";
+		return result;
+	}
+
+	/// UTF-16LE with a byte order mark, only valid for text without surrogate pairs.
+	std::string to_utf16le(std::string_view utf8) {
+		std::string result = "\xFF\xFE";
+		result.reserve(utf8.size() * 2 + 2);
+		for (std::size_t index = 0; index < utf8.size();) {
+			const unsigned char lead = static_cast<unsigned char>(utf8[index]);
+			std::uint32_t code_point;
+			if (lead < 0x80) {
+				code_point = lead;
+				index += 1;
+			} else if (lead < 0xE0) {
+				code_point = ((lead & 0x1F) << 6) | (utf8[index + 1] & 0x3F);
+				index += 2;
+			} else {
+				code_point = ((lead & 0x0F) << 12) | ((utf8[index + 1] & 0x3F) << 6) | (utf8[index + 2] & 0x3F);
+				index += 3;
+			}
+			result.push_back(static_cast<char>(code_point & 0xFF));
+			result.push_back(static_cast<char>(code_point >> 8));
+		}
+		return result;
+	}
+
+	/// Coroutine that nobody awaits, the benchmark counts finished loads instead.
+	struct Detached {
+		struct promise_type {
+			Detached get_return_object() { return {}; }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() { std::terminate(); }
+		};
+	};
+
+	/// Stands in for the main loop of an application, tasks run on the thread calling run_until.
+	class MainQueue {
+	public:
+		void post(std::function<void()> task) {
+			{
+				std::lock_guard lock(_mutex);
+				_tasks.push_back(std::move(task));
+			}
+			_ready.notify_one();
+		}
+
+		void run_until(const std::function<bool()>& done) {
+			while (!done()) {
+				std::function<void()> task;
+				{
+					std::unique_lock lock(_mutex);
+					_ready.wait(lock, [this] { return !_tasks.empty(); });
+					task = std::move(_tasks.front());
+					_tasks.pop_front();
+				}
+				task();
+			}
+		}
+
+	private:
+		std::mutex _mutex;
+		std::condition_variable _ready;
+		std::deque<std::function<void()>> _tasks;
+	};
+
+	Detached load_counted(const std::filesystem::path& path, const Executor& executor, std::size_t& loaded, std::size_t& finished) {
+		const LoadResult result = co_await load_async(path, executor);
+		if (result) loaded++;
+		finished++;
+	}
+
+	bool parse_options(int argc, char** argv, Options& options) {
+		for (int index = 1; index < argc; index++) {
+			const std::string_view arg = argv[index];
+			if (arg == "--csv") {
+				options.csv = true;
+				continue;
+			}
+			if (index + 1 == argc) return false;
+			const char* value = argv[++index];
+			if (arg == "--size") options.corpus.size = std::strtoull(value, nullptr, 10);
+			else if (arg == "--depth") options.corpus.depth = std::strtoull(value, nullptr, 10);
+			else if (arg == "--fan-out") options.corpus.fan_out = std::strtoull(value, nullptr, 10);
+			else if (arg == "--duplicates") options.corpus.duplicate_ratio = std::strtod(value, nullptr);
+			else if (arg == "--escapes") options.corpus.escape_density = std::strtod(value, nullptr);
+			else if (arg == "--comments") options.corpus.comment_density = std::strtod(value, nullptr);
+			else if (arg == "--includes") options.corpus.include_fan_in = std::strtoull(value, nullptr, 10);
+			else if (arg == "--seed") options.corpus.seed = std::strtoull(value, nullptr, 10);
+			else if (arg == "--iterations") options.iterations = std::strtoull(value, nullptr, 10);
+			else if (arg == "--small-documents") options.small_documents = std::strtoull(value, nullptr, 10);
+			else if (arg == "--small-files") options.small_files = std::strtoull(value, nullptr, 10);
+			else if (arg == "--layers") options.layers = std::strtoull(value, nullptr, 10);
+			else if (arg == "--checks") options.checks = std::strtoull(value, nullptr, 10);
+			else if (arg == "--filter") options.filter = value;
+			else return false;
+		}
+		return options.iterations != 0 && options.corpus.fan_out != 0;
+	}
+}
+
+int main(int argc, char** argv) {
+	tools::set_allocation_counting(true);
+
+	Options options;
+	if (!parse_options(argc, argv, options)) {
+		std::fprintf(stderr,
+			"usage: %s [--size bytes] [--depth n] [--fan-out n] [--duplicates ratio] [--escapes density]\n"
+			"          [--comments density] [--includes n] [--seed n] [--iterations n] [--small-documents n]\n"
+			"          [--small-files n] [--layers n] [--checks n] [--filter name] [--csv]\n",
+			argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::error_code error;
+	const std::filesystem::path directory = std::filesystem::temp_directory_path(error) / ("lexy-vdf-bench-" + std::to_string(options.corpus.seed));
+	std::filesystem::create_directories(directory, error);
+	if (error) {
+		std::fprintf(stderr, "cannot create %s\n", directory.string().c_str());
+		return EXIT_FAILURE;
+	}
+
+	const Corpus corpus = generate_corpus(options.corpus, directory.generic_string());
+	for (const CorpusFile& include : corpus.includes) {
+		write_file(include.path, include.content);
+	}
+	const std::filesystem::path document_path = directory / "document.vdf";
+	write_file(document_path, corpus.document);
+
+	const std::string_view document = corpus.document;
+	std::size_t total_bytes = document.size();
+	for (const CorpusFile& include : corpus.includes) {
+		total_bytes += include.content.size();
+	}
+
+	if (options.checks != 0 && check_quoted_string(options.corpus.seed, options.checks) + check_lexer(document) != 0) {
+		std::fprintf(stderr, "self-check failed\n");
+		return 2;
+	}
+
+	Runner runner(options);
+
+	runner.run("parser.parse", total_bytes, 1, [&] {
+		Parser parser = Parser::from_string(document);
+		return parser.parse();
+	});
+
+	runner.run("parser.parse_spans", total_bytes, 1, [&] {
+		Parser parser = Parser::from_string(document);
+		parser.set_track_spans(true);
+		return parser.parse();
+	});
+
+	// Tokens only, against the full parse above
+	runner.run("lexer.next", document.size(), 1, [&] {
+		Lexer lexer(document);
+		std::size_t tokens = 0;
+		while (lexer.next().kind != Token::Kind::Eof) {
+			tokens++;
+		}
+		return tokens != 0;
+	});
+
+	runner.run("parser.parse_parallel", total_bytes, 1, [&] {
+		Parser parser = Parser::from_string(document);
+		return parser.parse_parallel();
+	});
+
+	runner.run("parser.parse_file", total_bytes, 1, [&] {
+		Parser parser = Parser::from_file(document_path);
+		return !parser.has_error() && parser.parse();
+	});
+
+	runner.run("parser_pool.reparse", total_bytes, 1, [&] {
+		ParserPool::Lease parser = ParserPool::local().acquire();
+		return parser->reparse(document);
+	});
+
+	runner.run("key_values.from_string", total_bytes, 1, [&] {
+		return KeyValues::from_string(document) != nullptr;
+	});
+
+	runner.run("key_values.from_file", total_bytes, 1, [&] {
+		return KeyValues::from_file(document_path) != nullptr;
+	});
+
+	const std::unique_ptr<KeyValues> tree = KeyValues::from_string(document);
+	if (tree) {
+		runner.run("key_values.get", 0, corpus.root_keys.size() * 3, [&] {
+			std::size_t checksum = 0;
+			for (const std::string& key : corpus.root_keys) {
+				checksum += static_cast<std::size_t>(tree->GetInt(key));
+				checksum += static_cast<std::size_t>(tree->GetFloat(key));
+				checksum += tree->GetString(key).size();
+			}
+			return checksum != static_cast<std::size_t>(-1);
+		});
+
+		// Mods stacked over the document, each overriding every few root keys with a copy of the entry
+		std::vector<KeyValues> mods(options.layers);
+		for (std::size_t layer = 0; layer < mods.size(); layer++) {
+			for (std::size_t index = layer; index < corpus.root_keys.size(); index += layer + 2) {
+				auto found = tree->find(corpus.root_keys[index]);
+				if (found != tree->end()) mods[layer].insert(*found);
+			}
+		}
+		const std::size_t layered_lookups = corpus.root_keys.size() * 2;
+		auto lookup = [&corpus](const auto& values) {
+			std::size_t checksum = 0;
+			for (const std::string& key : corpus.root_keys) {
+				checksum += static_cast<std::size_t>(values.GetInt(key));
+				checksum += values.GetString(key).size();
+			}
+			return checksum != static_cast<std::size_t>(-1);
+		};
+
+		LayeredKeyValues layered;
+		for (const KeyValues& mod : mods) {
+			layered.push_bottom(mod);
+		}
+		layered.push_bottom(*tree);
+
+		runner.run("layered.get", 0, layered_lookups, [&] {
+			return lookup(layered);
+		});
+
+		runner.run("layered.flatten", total_bytes, 1, [&] {
+			return !layered.flatten().empty();
+		});
+
+		// The same stack merged eagerly, highest priority first since AppendKeyValues keeps existing keys
+		auto append_layers = [&] {
+			KeyValues merged;
+			for (const KeyValues& mod : mods) {
+				merged.AppendKeyValues(mod);
+			}
+			merged.AppendKeyValues(*tree);
+			return merged;
+		};
+
+		runner.run("layered.append_key_values", total_bytes, 1, [&] {
+			return !append_layers().empty();
+		});
+
+		const KeyValues appended = append_layers();
+		runner.run("layered.append_key_values_get", 0, layered_lookups, [&] {
+			return lookup(appended);
+		});
+	}
+
+	// Many small documents, a pooled parser against a fresh one per document
+	const std::string small_document = "\"unit\"\n{\n\t\"attack\"\t3\n\t\"defence\"\t2\n\t\"icon\"\t\"gfx/interface/unit.dds\"\n}\n";
+	const std::size_t small_count = options.small_documents;
+	runner.run("small_documents.fresh_parser", small_document.size() * small_count, small_count, [&] {
+		for (std::size_t index = 0; index < small_count; index++) {
+			Parser parser = Parser::from_string(small_document);
+			if (!parser.parse()) return false;
+		}
+		return true;
+	});
+
+	runner.run("small_documents.parser_pool", small_document.size() * small_count, small_count, [&] {
+		for (std::size_t index = 0; index < small_count; index++) {
+			ParserPool::Lease parser = ParserPool::local().acquire();
+			if (!parser->reparse(small_document)) return false;
+		}
+		return true;
+	});
+
+	// Error heavy loads, formatted into a stream against a batching sink and a null sink
+	const std::string broken_document = "\"unit\"\n{\n\t\"attack\"\t3\n\t\"icon\"\t\"gfx/interface/unit.dds\n";
+	auto parse_broken = [&](Parser& parser) {
+		for (std::size_t index = 0; index < small_count; index++) {
+			if (parser.reparse(broken_document) || !parser.has_error()) return false;
+		}
+		return true;
+	};
+
+	runner.run("diagnostics.error_log", broken_document.size() * small_count, small_count, [&] {
+		std::ostringstream log;
+		Parser parser;
+		parser.set_error_log_to(log);
+		return parse_broken(parser);
+	});
+
+	runner.run("diagnostics.buffered_sink", broken_document.size() * small_count, small_count, [&] {
+		std::size_t reported = 0;
+		BufferedDiagnosticSink sink([&reported](std::vector<Diagnostic>& batch) { reported += batch.size(); });
+		Parser parser;
+		parser.set_diagnostic_sink(&sink);
+		return parse_broken(parser);
+	});
+
+	runner.run("diagnostics.null_sink", broken_document.size() * small_count, small_count, [&] {
+		Parser parser;
+		parser.set_diagnostic_sink(&NullDiagnosticSink::instance());
+		return parse_broken(parser);
+	});
+
+	// Many small files sharing an include, loaded one after another against overlapped loads
+	const std::filesystem::path small_directory = directory / "small";
+	std::filesystem::create_directories(small_directory, error);
+	const std::filesystem::path small_include = small_directory / "common.vdf";
+	write_file(small_include, small_document);
+	const std::string small_file = "#include \"" + small_include.generic_string() + "\"\n" + small_document;
+	std::vector<std::filesystem::path> small_paths;
+	small_paths.reserve(options.small_files);
+	for (std::size_t index = 0; index < options.small_files; index++) {
+		small_paths.push_back(small_directory / ("file_" + std::to_string(index) + ".vdf"));
+		write_file(small_paths.back(), small_file);
+	}
+	const std::size_t small_files_bytes = (small_file.size() + small_document.size()) * small_paths.size();
+
+	runner.run("small_files.sequential", small_files_bytes, small_paths.size(), [&] {
+		for (const std::filesystem::path& path : small_paths) {
+			if (!KeyValues::from_file(path)) return false;
+		}
+		return true;
+	});
+
+	MainQueue main_queue;
+	const Executor executor = [&main_queue](std::function<void()> task) { main_queue.post(std::move(task)); };
+	runner.run("small_files.load_async", small_files_bytes, small_paths.size(), [&] {
+		std::size_t loaded = 0;
+		std::size_t finished = 0;
+		for (const std::filesystem::path& path : small_paths) {
+			load_counted(path, executor, loaded, finished);
+		}
+		main_queue.run_until([&] { return finished == small_paths.size(); });
+		return loaded == small_paths.size();
+	});
+
+	// One shared #base file filling in thousands of small includers, each overriding part of it
+	std::string base_document = "\"unit\"\n{\n";
+	for (std::size_t index = 0; index < 64; index++) {
+		base_document += "\t\"stat_" + std::to_string(index) + "\"\t" + std::to_string(index) + "\n";
+	}
+	base_document += "\t\"graphics\"\n\t{\n\t\t\"icon\"\t\"gfx/interface/base.dds\"\n\t\t\"scale\"\t1.5\n\t}\n}\n";
+	const std::filesystem::path base_path = small_directory / "base.vdf";
+	write_file(base_path, base_document);
+	const std::string includer_document = "#base \"" + base_path.generic_string() + "\"\n" + small_document;
+	std::vector<std::filesystem::path> includer_paths;
+	includer_paths.reserve(options.small_files);
+	for (std::size_t index = 0; index < options.small_files; index++) {
+		includer_paths.push_back(small_directory / ("includer_" + std::to_string(index) + ".vdf"));
+		write_file(includer_paths.back(), includer_document);
+	}
+	const std::size_t includer_bytes = (includer_document.size() + base_document.size()) * includer_paths.size();
+
+	runner.run("base_merge.files", includer_bytes, includer_paths.size(), [&] {
+		for (const std::filesystem::path& path : includer_paths) {
+			if (!KeyValues::from_file(path)) return false;
+		}
+		return true;
+	});
+
+	// The same merge on parsed trees, recursive against the shallow AppendKeyValues
+	const std::unique_ptr<KeyValues> base_tree = KeyValues::from_string(base_document);
+	const std::unique_ptr<KeyValues> includer_tree = KeyValues::from_string(small_document);
+	if (base_tree && includer_tree) {
+		runner.run("base_merge.deep_merge", base_document.size() * includer_paths.size(), includer_paths.size(), [&] {
+			std::size_t entries = 0;
+			for (std::size_t index = 0; index < includer_paths.size(); index++) {
+				KeyValues includer = *includer_tree;
+				entries += includer.deep_merge(*base_tree).size();
+			}
+			return entries != 0;
+		});
+
+		runner.run("base_merge.append_key_values", base_document.size() * includer_paths.size(), includer_paths.size(), [&] {
+			std::size_t entries = 0;
+			for (std::size_t index = 0; index < includer_paths.size(); index++) {
+				KeyValues includer = *includer_tree;
+				entries += includer.AppendKeyValues(*base_tree).size();
+			}
+			return entries != 0;
+		});
+	}
+
+	JsonOptions json_options;
+	json_options.pretty = false;
+	std::string json;
+	vdf_to_json(document, json, json_options);
+
+	std::string output;
+	runner.run("json.vdf_to_json", document.size(), 1, [&] {
+		output.clear();
+		return static_cast<bool>(vdf_to_json(document, output, json_options));
+	});
+
+	runner.run("json.json_to_vdf", json.size(), 1, [&] {
+		output.clear();
+		return static_cast<bool>(json_to_vdf(json, output, Writer::Style::Compact));
+	});
+
+	// A localization file saved as UTF-8 and as UTF-16LE
+	const std::string localization = make_localization(options.corpus.size);
+	const std::filesystem::path utf8_path = directory / "localization_utf8.vdf";
+	const std::filesystem::path utf16_path = directory / "localization_utf16.vdf";
+	write_file(utf8_path, localization);
+	write_file(utf16_path, to_utf16le(localization));
+
+	runner.run("localization.utf8_file", localization.size(), 1, [&] {
+		Parser parser = Parser::from_file(utf8_path);
+		return !parser.has_error() && parser.parse();
+	});
+
+	runner.run("localization.utf16_file", localization.size(), 1, [&] {
+		Parser parser = Parser::from_file(utf16_path);
+		return !parser.has_error() && parser.parse();
+	});
+
+	std::filesystem::remove_all(directory, error);
+	return runner.failed() ? 2 : EXIT_SUCCESS;
+}
@@ -0,0 +1,416 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "detail/StatementScanner.hpp"
+#include "detail/Unescape.hpp"
+
+using namespace lexy_vdf::detail;
+
+struct FieldSchema {
+	std::string key;
+	std::string member;
+	std::string type;
+	bool repeated;
+};
+
+struct StructSchema {
+	std::string name;
+	/// C++ type, the name mangled by type_name.
+	std::string type;
+	std::vector<FieldSchema> fields;
+};
+
+struct Schema {
+	std::string name_space;
+	std::vector<StructSchema> structs;
+};
+
+static constexpr std::array<std::pair<std::string_view, std::string_view>, 4> scalar_types { {
+	{ "int", "std::int32_t" },
+	{ "float", "std::float_t" },
+	{ "bool", "bool" },
+	{ "string", "std::string" },
+} };
+
+/// C++20 keywords and alternative tokens, sorted for binary_search.
+static constexpr std::array<std::string_view, 92> reserved_words {
+	"alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch", "char",
+	"char16_t", "char32_t", "char8_t", "class", "co_await", "co_return", "co_yield", "compl", "concept", "const",
+	"const_cast", "consteval", "constexpr", "constinit", "continue", "decltype", "default", "delete", "do", "double",
+	"dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "float", "for", "friend", "goto", "if",
+	"inline", "int", "long", "mutable", "namespace", "new", "noexcept", "not", "not_eq", "nullptr", "operator", "or",
+	"or_eq", "private", "protected", "public", "register", "reinterpret_cast", "requires", "return", "short", "signed",
+	"sizeof", "static", "static_assert", "static_cast", "struct", "switch", "template", "this", "thread_local", "throw",
+	"true", "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile",
+	"wchar_t", "while", "xor", "xor_eq",
+};
+
+bool is_reserved(std::string_view name) {
+	return std::binary_search(reserved_words.begin(), reserved_words.end(), name);
+}
+
+std::optional<std::string_view> scalar_type(std::string_view type) {
+	for (const auto& [name, cpp_type] : scalar_types) {
+		if (name == type) return cpp_type;
+	}
+	return std::nullopt;
+}
+
+bool is_identifier(std::string_view name) {
+	if (name.empty() || (name[0] >= '0' && name[0] <= '9')) return false;
+	return std::all_of(name.begin(), name.end(), [](char c) {
+		return c == '_' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+	});
+}
+
+bool is_namespace(std::string_view name) {
+	while (!name.empty()) {
+		const std::size_t separator = name.find("::");
+		const std::string_view part = name.substr(0, separator);
+		if (!is_identifier(part) || is_reserved(part)) return false;
+		if (separator == std::string_view::npos) return true;
+		name.remove_prefix(separator + 2);
+	}
+	return false;
+}
+
+/// Turns a VDF key into a member name, "Max Health" becomes "max_health".
+std::string member_name(std::string_view key) {
+	std::string result;
+	result.reserve(key.size() + 1);
+	for (char c : key) {
+		if (c >= 'A' && c <= 'Z') {
+			result.push_back(static_cast<char>(c | 0x20));
+		} else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+			result.push_back(c);
+		} else if (result.empty() || result.back() != '_') {
+			result.push_back('_');
+		}
+	}
+	if (result.empty() || (result[0] >= '0' && result[0] <= '9')) result.insert(result.begin(), '_');
+	if (is_reserved(result)) result.push_back('_');
+	return result;
+}
+
+/// Turns a struct name into the name of its C++ type, keywords get a trailing underscore like members.
+std::string type_name(std::string_view name) {
+	std::string result(name);
+	if (is_reserved(result)) result.push_back('_');
+	return result;
+}
+
+std::string string_literal(std::string_view text) {
+	std::string result = "\"";
+	for (char c : text) {
+		switch (c) {
+			case '"': result += "\\\""; break;
+			case '\\': result += "\\\\"; break;
+			case '\n': result += "\\n"; break;
+			case '\t': result += "\\t"; break;
+			case '\r': result += "\\r"; break;
+			default: result.push_back(c); break;
+		}
+	}
+	result.push_back('"');
+	return result;
+}
+
+class SchemaReader {
+public:
+	SchemaReader(std::string_view source, std::string_view file_name) : _source(source), _file_name(file_name) {}
+
+	std::optional<Schema> read() {
+		using Status = StatementScanner::Status;
+
+		Schema schema;
+		StatementScanner scanner(_source);
+		StatementScanner::Statement statement;
+		Status status;
+		while ((status = scanner.next(statement)) == Status::Ok) {
+			std::string key;
+			if (!check_plain(statement) || !text(statement.key, key)) return std::nullopt;
+
+			if (!statement.is_block()) {
+				if (key != "namespace") return fail(statement.key.begin, "expected a struct block or \"namespace\"");
+				schema.name_space.clear();
+				if (!text(statement.value, schema.name_space)) return std::nullopt;
+				if (!is_namespace(schema.name_space)) return fail(statement.value.begin, "invalid namespace name");
+				continue;
+			}
+
+			if (!is_identifier(key)) return fail(statement.key.begin, "struct name is not a valid identifier");
+			if (scalar_type(key) || find(schema, key)) return fail(statement.key.begin, "struct name is already in use");
+			std::string type = type_name(key);
+			for (const StructSchema& structure : schema.structs) {
+				if (structure.type == type) return fail(statement.key.begin, "struct name maps to the same type name as an earlier struct");
+			}
+
+			StructSchema& structure = schema.structs.emplace_back();
+			structure.name = std::move(key);
+			structure.type = std::move(type);
+			if (!read_fields(statement.body(), structure)) return std::nullopt;
+		}
+		if (status != Status::End || !scanner.at_end()) return fail(scanner.position(), "malformed statement");
+
+		for (const StructSchema& structure : schema.structs) {
+			for (const FieldSchema& field : structure.fields) {
+				if (!scalar_type(field.type) && !find(schema, field.type)) {
+					return fail(nullptr, "unknown type \"" + field.type + "\" for \"" + structure.name + "." + field.key + '"');
+				}
+			}
+		}
+		return schema;
+	}
+
+	static const StructSchema* find(const Schema& schema, std::string_view name) {
+		for (const StructSchema& structure : schema.structs) {
+			if (structure.name == name) return &structure;
+		}
+		return nullptr;
+	}
+
+private:
+	std::string_view _source;
+	std::string_view _file_name;
+
+	bool read_fields(std::string_view body, StructSchema& structure) {
+		using Status = StatementScanner::Status;
+
+		std::unordered_set<std::string> keys;
+		std::unordered_set<std::string> members;
+		StatementScanner scanner(body);
+		StatementScanner::Statement statement;
+		Status status;
+		while ((status = scanner.next(statement)) == Status::Ok) {
+			if (!check_plain(statement)) return false;
+			if (statement.is_block()) {
+				fail(statement.key.begin, "nested blocks are declared as their own struct");
+				return false;
+			}
+
+			FieldSchema field;
+			if (!text(statement.key, field.key) || !text(statement.value, field.type)) return false;
+			if (field.type.ends_with("[]")) {
+				field.repeated = true;
+				field.type.resize(field.type.size() - 2);
+			} else {
+				field.repeated = false;
+			}
+			field.member = member_name(field.key);
+
+			if (!keys.insert(field.key).second) {
+				fail(statement.key.begin, "duplicate key");
+				return false;
+			}
+			if (!members.insert(field.member).second) {
+				fail(statement.key.begin, "key maps to the same member name as an earlier key");
+				return false;
+			}
+			structure.fields.push_back(std::move(field));
+		}
+		if (status != Status::End || !scanner.at_end()) {
+			fail(scanner.position(), "malformed statement");
+			return false;
+		}
+		return true;
+	}
+
+	bool check_plain(const StatementScanner::Statement& statement) {
+		if (statement.is_include()) {
+			fail(statement.key.begin, "#include and #base are not supported in schemas");
+			return false;
+		}
+		if (statement.has_condition) {
+			fail(statement.condition.begin, "conditional attributes are not supported in schemas");
+			return false;
+		}
+		return true;
+	}
+
+	bool text(const ScannedToken& token, std::string& out) {
+		if (token.kind != ScannedToken::Kind::String) {
+			out = token.text();
+			return true;
+		}
+		if (!unescape_append(token.string_body(), out)) {
+			fail(token.begin, "invalid escape sequence");
+			return false;
+		}
+		return true;
+	}
+
+	std::nullopt_t fail(const char* position, std::string_view message) {
+		std::cerr << _file_name;
+		if (position) {
+			const std::string_view before = _source.substr(0, static_cast<std::size_t>(position - _source.data()));
+			const std::size_t line_begin = before.rfind('\n') + 1;
+			std::cerr << ':' << std::count(before.begin(), before.end(), '\n') + 1 << ':' << before.size() - line_begin + 1;
+		}
+		std::cerr << ": error: " << message << std::endl;
+		return std::nullopt;
+	}
+};
+
+/// Orders structs so that every struct is defined before the structs that contain it.
+std::optional<std::vector<const StructSchema*>> dependency_order(const Schema& schema) {
+	enum class Mark : unsigned char { None, Visiting, Done };
+	std::unordered_map<const StructSchema*, Mark> marks;
+	std::vector<const StructSchema*> order;
+	order.reserve(schema.structs.size());
+
+	auto visit = [&](auto& self, const StructSchema& structure) -> bool {
+		Mark& mark = marks[&structure];
+		if (mark == Mark::Done) return true;
+		if (mark == Mark::Visiting) {
+			std::cerr << "error: struct \"" << structure.name << "\" contains itself" << std::endl;
+			return false;
+		}
+		mark = Mark::Visiting;
+		for (const FieldSchema& field : structure.fields) {
+			if (const StructSchema* nested = SchemaReader::find(schema, field.type); nested && !self(self, *nested)) return false;
+		}
+		marks[&structure] = Mark::Done;
+		order.push_back(&structure);
+		return true;
+	};
+
+	for (const StructSchema& structure : schema.structs) {
+		if (!visit(visit, structure)) return std::nullopt;
+	}
+	return order;
+}
+
+std::string generate(const Schema& schema, const std::vector<const StructSchema*>& order, std::string_view schema_name) {
+	const std::string qualifier = schema.name_space.empty() ? "::" : "::" + schema.name_space + "::";
+	auto open_namespace = [&](std::ostream& out) {
+		if (!schema.name_space.empty()) out << "namespace " << schema.name_space << " {\n";
+	};
+	auto close_namespace = [&](std::ostream& out) {
+		if (!schema.name_space.empty()) out << "}\n";
+	};
+	const char* indent = schema.name_space.empty() ? "" : "\t";
+
+	std::ostringstream out;
+	out << "// Generated by lexy-vdf codegen from " << schema_name << ", do not edit.\n"
+		<< "#pragma once\n\n"
+		<< "#include <cmath>\n"
+		<< "#include <cstdint>\n"
+		<< "#include <filesystem>\n"
+		<< "#include <string>\n"
+		<< "#include <string_view>\n"
+		<< "#include <vector>\n\n"
+		<< "#include <lexy-vdf/Binding.hpp>\n\n";
+
+	open_namespace(out);
+	for (std::size_t index = 0; index < order.size(); index++) {
+		const StructSchema* structure = order[index];
+		if (index != 0) out << '\n';
+		out << indent << "struct " << structure->type << " {\n";
+		for (const FieldSchema& field : structure->fields) {
+			const std::string_view type = scalar_type(field.type).value_or(SchemaReader::find(schema, field.type)->type);
+			out << indent << '\t';
+			if (field.repeated) {
+				out << "std::vector<" << type << "> ";
+			} else {
+				out << type << ' ';
+			}
+			out << field.member << " {};\n";
+		}
+		out << indent << "};\n";
+	}
+	close_namespace(out);
+
+	out << "\nnamespace lexy_vdf {\n";
+	for (std::size_t index = 0; index < order.size(); index++) {
+		const std::string name = qualifier + order[index]->type;
+		const StructSchema* structure = order[index];
+		if (index != 0) out << '\n';
+		out << "\ttemplate<>\n"
+			<< "\tstruct Binding<" << name << "> {\n"
+			<< "\t\tstatic constexpr auto fields = make_fields(";
+		for (std::size_t index = 0; index < structure->fields.size(); index++) {
+			const FieldSchema& field = structure->fields[index];
+			out << (index == 0 ? "\n" : ",\n") << "\t\t\tfield<" << string_literal(field.key) << ">(&" << name << "::" << field.member << ")";
+		}
+		out << (structure->fields.empty() ? ");\n" : "\n\t\t);\n") << "\t};\n";
+	}
+	out << "}\n\n";
+
+	open_namespace(out);
+	for (std::size_t index = 0; index < order.size(); index++) {
+		const std::string& name = order[index]->type;
+		if (index != 0) out << '\n';
+		out << indent << "inline lexy_vdf::BindResult load_from_file(const std::filesystem::path& path, " << name
+			<< "& out, const lexy_vdf::BindOptions& options = {}) {\n"
+			<< indent << "\treturn lexy_vdf::bind_from_file(path, out, options);\n"
+			<< indent << "}\n\n"
+			<< indent << "inline lexy_vdf::BindResult load_from_string(std::string_view string, " << name
+			<< "& out, const lexy_vdf::BindOptions& options = {}) {\n"
+			<< indent << "\treturn lexy_vdf::bind_from_string(string, out, options);\n"
+			<< indent << "}\n";
+	}
+	close_namespace(out);
+	return std::move(out).str();
+}
+
+std::optional<std::string> read_file(const char* path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) return std::nullopt;
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+int run(const char* schema_path, const char* output_path) {
+	std::optional<std::string> source = read_file(schema_path);
+	if (!source) {
+		std::fprintf(stderr, "%s: error: could not read schema\n", schema_path);
+		return EXIT_FAILURE;
+	}
+
+	std::optional<Schema> schema = SchemaReader(*source, schema_path).read();
+	if (!schema) return 2;
+
+	std::optional<std::vector<const StructSchema*>> order = dependency_order(*schema);
+	if (!order) return 2;
+
+	std::string_view schema_name = schema_path;
+	if (std::size_t separator = schema_name.find_last_of("/\\"); separator != std::string_view::npos) {
+		schema_name.remove_prefix(separator + 1);
+	}
+	const std::string header = generate(*schema, *order, schema_name);
+
+	if (!output_path) {
+		std::cout << header;
+		return EXIT_SUCCESS;
+	}
+
+	// Leave an unchanged header untouched so dependent objects are not rebuilt.
+	if (read_file(output_path) == header) return EXIT_SUCCESS;
+	std::ofstream output(output_path, std::ios::binary | std::ios::trunc);
+	if (!output || !output.write(header.data(), static_cast<std::streamsize>(header.size()))) {
+		std::fprintf(stderr, "%s: error: could not write header\n", output_path);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+	switch (argc) {
+		case 2: return run(argv[1], nullptr);
+		case 3: return run(argv[1], argv[2]);
+		default:
+			std::fprintf(stderr, "usage: %s <schema> [output header]\n", argv[0]);
+			return EXIT_FAILURE;
+	}
+}
@@ -1,57 +1,21 @@
-#include <cctype>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
-#include <ostream>
 #include <string>
 #include <string_view>
-#include <type_traits>
-#include <variant>
+#include <vector>
 
+#include <lexy-vdf/Json.hpp>
 #include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/MemoryUsage.hpp>
+#include <lexy-vdf/ParseProfile.hpp>
 #include <lexy-vdf/Parser.hpp>
+#include <lexy-vdf/Writer.hpp>
 
-template<class... Ts>
-struct overloaded : Ts... {
-	using Ts::operator()...;
-};
-template<class... Ts>
-overloaded(Ts...) -> overloaded<Ts...>;
-
-void print_string(std::string_view name) {
-	if (std::string_view::npos != name.find_first_of(" \t\n")) {
-		std::cout << '"' << name << '"';
-		return;
-	}
-	std::cout << name;
-}
-
-void print(const lexy_vdf::KeyValues& kv, int indent = 0) {
-	for (const auto& node : kv) {
-		std::visit(
-			overloaded {
-				[](std::monostate) {},
-				[&node, &indent](auto&& arg) {
-					std::cout << std::string(indent, '\t');
-					print_string(node.first);
-					std::cout << ": ";
-					if constexpr (std::is_same_v<std::string, std::decay_t<decltype(arg)>>) {
-						print_string(arg);
-						std::cout << std::endl;
-						return;
-					}
-					std::cout << arg << std::endl;
-				},
-				[&node, &indent](const lexy_vdf::KeyValues& arg) {
-					std::cout << std::string(indent, '\t');
-					print_string(node.first);
-					std::cout << ": {" << std::endl;
-					print(arg, indent + 1);
-					std::cout << std::string(indent, '\t') << '}' << std::endl;
-				} },
-			node.second);
-	}
-}
+#include "CountingNew.hpp"
 
 int print_key_values(const std::string_view path) {
 	auto parser = lexy_vdf::Parser::from_file(path);
@@ -70,18 +34,108 @@ int print_key_values(const std::string_view path) {
 		}
 	}
 
-	print(*parser.get_key_values());
+	lexy_vdf::Writer(std::cout).write(*parser.get_key_values());
+
+	return EXIT_SUCCESS;
+}
+
+int print_memory_usage(const std::string_view path) {
+	lexy_vdf::tools::set_allocation_counting(true);
+	const lexy_vdf::AllocationCounter::Stats before = lexy_vdf::AllocationCounter::get_stats();
+	auto parser = lexy_vdf::Parser::from_file(path);
+	if (parser.has_error()) {
+		return 1;
+	}
+
+	parser.parse();
+	if (parser.has_error()) {
+		return 2;
+	}
+	const lexy_vdf::AllocationCounter::Stats after = lexy_vdf::AllocationCounter::get_stats();
 
+	const lexy_vdf::MemoryUsage usage = parser.get_key_values()->memory_usage();
+	std::printf("%s\n", std::string(path).c_str());
+	std::printf("  keys:            %zu bytes\n", usage.key_bytes);
+	std::printf("  string values:   %zu bytes\n", usage.string_value_bytes);
+	std::printf("  nodes:           %zu bytes in %zu nodes\n", usage.node_bytes, usage.nodes);
+	std::printf("  buckets:         %zu bytes\n", usage.bucket_bytes);
+	std::printf("  conditionals:    %zu bytes\n", usage.conditional_bytes);
+	std::printf("  maps:            %zu\n", usage.maps);
+	std::printf("  total:           %zu bytes in %zu allocations\n", usage.total(), usage.allocations);
+	std::printf("  parse allocated: %zu bytes in %zu allocations, peak %zu bytes in use\n",
+		after.bytes_allocated - before.bytes_allocated, after.allocations - before.allocations, after.peak_bytes_in_use);
 	return EXIT_SUCCESS;
 }
 
+int print_profile(const std::string_view path) {
+	auto parser = lexy_vdf::Parser::from_file(path);
+	if (parser.has_error()) {
+		return 1;
+	}
+
+	const bool parsed = parser.parse();
+	const lexy_vdf::ParseProfile& profile = parser.get_profile();
+	if (!profile.collected) {
+		std::fprintf(stderr, "profiling is not compiled in, rebuild with lvdf_profiling=yes\n");
+		return EXIT_FAILURE;
+	}
+
+	auto milliseconds = [](std::chrono::nanoseconds time) {
+		return std::chrono::duration<double, std::milli>(time).count();
+	};
+
+	std::vector<lexy_vdf::ParseProfile::Production> productions = profile.productions;
+	std::sort(productions.begin(), productions.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.time > rhs.time;
+	});
+
+	std::printf("%s: %.3f ms%s\n", std::string(path).c_str(), milliseconds(profile.total_time), parsed ? "" : " (failed)");
+	std::printf("  %-22s %10s %12s %12s\n", "production", "count", "bytes", "ms");
+	for (const auto& production : productions) {
+		if (production.count == 0) continue;
+		std::printf("  %-22.*s %10zu %12zu %12.3f\n", static_cast<int>(production.name.size()), production.name.data(),
+			production.count, production.bytes, milliseconds(production.time));
+	}
+	std::printf("  %-22s %10zu %12s %12.3f\n", "KeyValues insert", profile.inserts, "", milliseconds(profile.insert_time));
+	for (const auto& include : profile.includes) {
+		std::printf("  include %s: %.3f ms\n", include.path.c_str(), milliseconds(include.time));
+	}
+	return parsed ? EXIT_SUCCESS : 2;
+}
+
+int transcode(const lexy_vdf::TranscodeResult& result) {
+	for (auto& warning : result.warnings) {
+		std::cerr << "Warning: " << warning.message << std::endl;
+	}
+	for (auto& error : result.errors) {
+		std::cerr << "Error: " << error.message;
+		if (error.start_line != 0) std::cerr << " at " << error.start_line << ':' << error.start_column;
+		std::cerr << std::endl;
+	}
+	return result ? EXIT_SUCCESS : 2;
+}
+
 int main(int argc, char** argv) {
 	switch (argc) {
 		case 2:
 			return print_key_values(argv[1]);
+		case 3:
+			if (std::string_view(argv[1]) == "--to-json") {
+				return transcode(lexy_vdf::vdf_file_to_json(argv[2], std::cout));
+			}
+			if (std::string_view(argv[1]) == "--from-json") {
+				return transcode(lexy_vdf::json_file_to_vdf(argv[2], std::cout));
+			}
+			if (std::string_view(argv[1]) == "--memory") {
+				return print_memory_usage(argv[2]);
+			}
+			if (std::string_view(argv[1]) == "--profile") {
+				return print_profile(argv[2]);
+			}
+			goto default_jump;
 		default:
 		default_jump:
-			std::fprintf(stderr, "usage: %s <filename>\n", argv[0]);
+			std::fprintf(stderr, "usage: %s [--to-json | --from-json | --memory | --profile] <filename>\n", argv[0]);
 			return EXIT_FAILURE;
 	}
 
@@ -0,0 +1,185 @@
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <lexy-vdf/AsyncLoad.hpp>
+#include <lexy-vdf/Parser.hpp>
+
+#include "detail/IncludeCache.hpp"
+#include "detail/StatementScanner.hpp"
+#include "detail/Unescape.hpp"
+
+using namespace lexy_vdf;
+
+struct AsyncLoader::Request {
+	std::string path;
+	Executor executor;
+	std::coroutine_handle<> handle;
+	Parser parser;
+	detail::IncludeCache::Files includes;
+	LoadResult result;
+};
+
+struct AsyncLoader::Queue {
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::deque<std::function<void()>> tasks;
+	std::vector<std::thread> threads;
+	bool stopping = false;
+
+	explicit Queue(std::size_t thread_count) {
+		threads.reserve(thread_count);
+		for (std::size_t index = 0; index < thread_count; index++) {
+			threads.emplace_back([this] { work(); });
+		}
+	}
+
+	/// Runs the queued tasks before joining.
+	~Queue() {
+		{
+			std::lock_guard lock(mutex);
+			stopping = true;
+		}
+		ready.notify_all();
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+	}
+
+	void push(std::function<void()> task) {
+		{
+			std::lock_guard lock(mutex);
+			tasks.push_back(std::move(task));
+		}
+		ready.notify_one();
+	}
+
+	void work() {
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock lock(mutex);
+				ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+				if (tasks.empty()) return;
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+};
+
+namespace {
+	///
+	/// @brief Loads every file included anywhere in source, and the files those include
+	///
+	/// Only the statement structure is scanned, a malformed document stops the scan early and
+	/// its remaining includes are read by the parse instead.
+	///
+	void prefetch_includes(std::string_view source, detail::IncludeCache::Files& files) {
+		detail::StatementScanner scanner(source);
+		detail::StatementScanner::Statement statement;
+		while (scanner.next(statement) == detail::StatementScanner::Status::Ok) {
+			if (statement.is_block()) {
+				prefetch_includes(statement.body(), files);
+				continue;
+			}
+			if (!statement.is_include() || statement.value.kind != detail::ScannedToken::Kind::String) continue;
+
+			std::optional<std::string> path = detail::unescape(statement.value.string_body());
+			if (!path || files.contains(*path)) continue;
+
+			// Map nodes are stable, so the key can serve as the path the parser reports errors with
+			auto [entry, inserted] = files.try_emplace(std::move(*path));
+			Parser& parser = entry->second;
+			parser.set_error_log_to_null();
+			parser.load_from_file(entry->first.c_str());
+			if (!parser.has_error()) prefetch_includes(parser.get_source(), files);
+		}
+	}
+}
+
+AsyncLoader::Awaitable::Awaitable(AsyncLoader& p_loader, std::shared_ptr<Request> p_request)
+	: _loader(&p_loader),
+	  _request(std::move(p_request)) {}
+
+void AsyncLoader::Awaitable::await_suspend(std::coroutine_handle<> p_handle) {
+	_request->handle = p_handle;
+	_loader->_read_queue->push([loader = _loader, request = _request] { loader->_read(request); });
+}
+
+LoadResult AsyncLoader::Awaitable::await_resume() {
+	return std::move(_request->result);
+}
+
+AsyncLoader::AsyncLoader(std::size_t p_parse_threads)
+	: _read_queue(std::make_unique<Queue>(1)),
+	  _parse_queue(std::make_unique<Queue>(p_parse_threads == 0 ? 1 : p_parse_threads)) {}
+
+// Reads hand their requests to the parse queue, so the read queue has to drain first.
+AsyncLoader::~AsyncLoader() {
+	_read_queue.reset();
+	_parse_queue.reset();
+}
+
+AsyncLoader& AsyncLoader::shared() {
+	static AsyncLoader loader;
+	return loader;
+}
+
+AsyncLoader::Awaitable AsyncLoader::load(std::filesystem::path p_path, Executor p_executor) {
+	std::shared_ptr<Request> request = std::make_shared<Request>();
+	request->path = p_path.string();
+	request->executor = std::move(p_executor);
+	return Awaitable(*this, std::move(request));
+}
+
+void AsyncLoader::_read(std::shared_ptr<Request> request) {
+	request->parser.set_error_log_to_null();
+	request->parser.load_from_file(request->path.c_str());
+	if (!request->parser.has_error()) prefetch_includes(request->parser.get_source(), request->includes);
+	_parse_queue->push([request = std::move(request)] { _parse(*request); });
+}
+
+///
+/// @brief Parses a request with its prefetched includes and resumes its coroutine
+///
+/// Everything but the result is released before resuming, the awaiting coroutine may destroy
+/// the request as soon as it runs.
+///
+void AsyncLoader::_parse(Request& request) {
+	LoadResult& result = request.result;
+	result.path = request.path;
+	if (!request.parser.has_error()) {
+		detail::IncludeCache cache(request.includes);
+		if (request.parser.parse()) result.key_values.reset(request.parser.release_key_values());
+	}
+	// Errors and warnings have const members, so they are copy constructed rather than assigned
+	for (const ParseError& error : request.parser.get_errors()) {
+		result.errors.push_back(error);
+	}
+	for (const ParseWarning& warning : request.parser.get_warnings()) {
+		result.warnings.push_back(warning);
+	}
+	request.includes.clear();
+	request.parser.reset();
+
+	const std::coroutine_handle<> handle = request.handle;
+	if (!request.executor) {
+		handle.resume();
+		return;
+	}
+	Executor executor = std::move(request.executor);
+	executor([handle] { handle.resume(); });
+}
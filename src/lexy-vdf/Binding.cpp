@@ -0,0 +1,286 @@
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <lexy-vdf/Binding.hpp>
+#include <lexy-vdf/ConditionSet.hpp>
+#include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/ParseError.hpp>
+
+#include <lexy/encoding.hpp>
+
+#include "detail/BasicBufferHandler.hpp"
+#include "detail/ConditionEvaluator.hpp"
+#include "detail/DefaultConditions.hpp"
+#include "detail/Errors.hpp"
+#include "detail/ScannedValidation.hpp"
+#include "detail/StatementScanner.hpp"
+#include "detail/Unescape.hpp"
+#include "detail/UnquotedToken.hpp"
+#include "detail/Warnings.hpp"
+
+using namespace lexy_vdf;
+using namespace lexy_vdf::detail;
+
+namespace {
+	/// Types a word like grammar::ValueExpression, false if the grammar doesn't read it as a single token.
+	bool read_word(std::string_view word, BindValue& value) {
+		const UnquotedToken token = match_unquoted(word);
+		if (!token.covers(word)) return false;
+		value.text = word;
+		value.int_value = token.int_value;
+		value.float_value = token.float_value;
+		switch (token.kind) {
+			case UnquotedToken::Kind::Integer: value.kind = BindValue::Kind::Int; break;
+			case UnquotedToken::Kind::Float: value.kind = BindValue::Kind::Float; break;
+			default: value.kind = BindValue::Kind::String; break;
+		}
+		return true;
+	}
+
+	/// Fields of one bound object that already hold a value, the first value of a key wins like it does in KeyValues.
+	struct Assigned {
+		std::vector<bool> fields;
+		/// Nested structs that are not repeated, kept so a #base can fill in what they lack.
+		std::vector<std::unique_ptr<Assigned>> nested;
+
+		explicit Assigned(std::size_t count) : fields(count), nested(count) {}
+
+		Assigned& child(std::size_t index, std::size_t count) {
+			if (!nested[index]) nested[index] = std::make_unique<Assigned>(count);
+			return *nested[index];
+		}
+	};
+
+	std::optional<ParseError> load_source(const std::filesystem::path& path, BasicBufferHandler<lexy::utf8_char_encoding>& buffer_handler) {
+		const std::string path_string = path.string();
+		return buffer_handler.load_file(path_string.c_str());
+	}
+
+	std::string_view get_source(const BasicBufferHandler<lexy::utf8_char_encoding>& buffer_handler) {
+		const auto& buffer = buffer_handler.get_buffer();
+		return std::string_view(buffer.data(), buffer.size());
+	}
+
+	struct Binder {
+		const BindOptions& options;
+		std::string_view source;
+		BindResult result;
+		ConditionSet conditions;
+		std::vector<std::string> path;
+
+		Binder(const BindOptions& options, std::string_view source) : options(options), source(source) {
+			if (options.use_default_conditions) {
+				for (std::string_view condition : default_conditions) {
+					conditions.add(condition);
+				}
+			}
+			for (const std::string& condition : options.conditions) {
+				conditions.add(condition);
+			}
+		}
+
+		std::string path_to(std::string_view key) const {
+			std::string result;
+			for (const std::string& segment : path) {
+				result.append(segment).push_back('/');
+			}
+			result.append(key);
+			return result;
+		}
+
+		void malformed(const char* position) {
+			result.errors.push_back(errors::make_malformed_error(source, position, "Binding"));
+		}
+
+		/// Checks the value of a statement that is not bound, Parser rejects it all the same.
+		bool skip(const ScannedToken& value) {
+			const char* malformed_at = find_malformed_value(value);
+			if (malformed_at) malformed(malformed_at);
+			return !malformed_at;
+		}
+
+		///
+		/// @brief Binds the statements of range into object, skipping fields assigned before
+		///
+		/// The top level #base statements of a file are bound after the rest of it, deep, so they
+		/// only fill in fields the file left unassigned, as Parser does when it merges them. Input
+		/// Parser rejects is rejected, the values of statements that aren't bound included.
+		///
+		bool bind_block(std::string_view range, const BindTable& table, void* object, Assigned& assigned, bool top_level, bool deep) {
+			using Status = StatementScanner::Status;
+
+			StatementScanner scanner(range);
+			StatementScanner::Statement statement;
+			Status status;
+			std::string key_buffer;
+			std::string value_buffer;
+			std::vector<std::string> bases;
+			while ((status = scanner.next(statement)) == Status::Ok) {
+				if (statement.is_include()) {
+					std::string file;
+					if (!is_valid_string_body(statement.value.string_body()) || !unescape_append(statement.value.string_body(), file)) {
+						malformed(statement.value.begin);
+						return false;
+					}
+					const bool is_base = statement.key.text() == "#base";
+					if (is_base && top_level) {
+						bases.push_back(std::move(file));
+					} else {
+						include(file, table, object, assigned, deep || is_base);
+					}
+					continue;
+				}
+
+				if (!is_valid_key(statement.key)) {
+					malformed(statement.key.begin);
+					return false;
+				}
+				std::string_view key = statement.key.text();
+				if (statement.key.kind == ScannedToken::Kind::String) {
+					key_buffer.clear();
+					if (!unescape_append(statement.key.string_body(), key_buffer)) {
+						malformed(statement.key.begin);
+						return false;
+					}
+					key = key_buffer;
+				}
+
+				if (statement.has_condition) {
+					auto has_condition = [this](std::string_view name) {
+						return conditions.contains(name);
+					};
+					std::optional<bool> enabled = ConditionEvaluator(statement.condition.text(), has_condition).evaluate();
+					if (!enabled) {
+						malformed(statement.condition.begin);
+						return false;
+					}
+					if (!*enabled) {
+						if (!skip(statement.value)) return false;
+						continue;
+					}
+				}
+
+				const BindField* field = table.find(key);
+				if (!field) {
+					if (options.unknown_keys == BindOptions::UnknownKeys::Report) {
+						result.warnings.push_back(warnings::unknown_key(path_to(key)));
+					}
+					if (!skip(statement.value)) return false;
+					continue;
+				}
+
+				const std::size_t index = static_cast<std::size_t>(field - table.fields.data());
+				if (field->nested) {
+					if (!statement.is_block()) {
+						result.warnings.push_back(warnings::type_mismatch(path_to(key)));
+						if (!skip(statement.value)) return false;
+						continue;
+					}
+					if (!field->repeated && assigned.fields[index] && !deep) {
+						if (!skip(statement.value)) return false;
+						continue;
+					}
+					assigned.fields[index] = true;
+
+					path.emplace_back(key);
+					bool bound;
+					if (field->repeated) {
+						Assigned element(field->nested->fields.size());
+						bound = bind_block(statement.body(), *field->nested, field->enter(object), element, false, deep);
+					} else {
+						bound = bind_block(statement.body(), *field->nested, field->enter(object), assigned.child(index, field->nested->fields.size()), false, deep);
+					}
+					path.pop_back();
+					if (!bound) return false;
+					continue;
+				}
+
+				if (!field->repeated) {
+					if (assigned.fields[index]) {
+						if (!skip(statement.value)) return false;
+						continue;
+					}
+					assigned.fields[index] = true;
+				}
+
+				BindValue value {};
+				if (statement.is_block()) {
+					result.warnings.push_back(warnings::type_mismatch(path_to(key)));
+					if (!skip(statement.value)) return false;
+					continue;
+				} else if (statement.value.kind == ScannedToken::Kind::String) {
+					value_buffer.clear();
+					if (!is_valid_string_body(statement.value.string_body()) || !unescape_append(statement.value.string_body(), value_buffer)) {
+						malformed(statement.value.begin);
+						return false;
+					}
+					value.kind = BindValue::Kind::String;
+					value.text = value_buffer;
+				} else if (!read_word(statement.value.text(), value)) {
+					malformed(statement.value.begin);
+					return false;
+				}
+
+				if (!field->assign(object, value)) {
+					result.warnings.push_back(warnings::type_mismatch(path_to(key)));
+				}
+			}
+
+			if (status != Status::End || !scanner.at_end()) {
+				malformed(scanner.position());
+				return false;
+			}
+			for (const std::string& base : bases) {
+				include(base, table, object, assigned, true);
+			}
+			return true;
+		}
+
+		///
+		/// @brief Binds an included file into the fields the including one left unassigned
+		///
+		/// A file that can't be loaded or bound is reported as a warning like KeyValues::MergeWith
+		/// failures are, fields it bound before failing stay bound.
+		///
+		void include(const std::string& file, const BindTable& table, void* object, Assigned& assigned, bool deep) {
+			BasicBufferHandler<lexy::utf8_char_encoding> buffer_handler;
+			if (load_source(file, buffer_handler)) {
+				result.warnings.push_back(warnings::merge_check(file, KeyValues::MergeError::FileMissing).value());
+				return;
+			}
+
+			const std::string_view included_source = get_source(buffer_handler);
+			Binder included { options, included_source };
+			included.path = path;
+			if (!included.bind_block(included_source, table, object, assigned, true, deep)) {
+				result.warnings.push_back(warnings::merge_check(file, KeyValues::MergeError::ParseFail).value());
+			}
+			for (ParseWarning& warning : included.result.warnings) {
+				result.warnings.push_back(std::move(warning));
+			}
+		}
+	};
+}
+
+BindResult detail::bind_buffer(std::string_view source, const BindTable& table, void* object, const BindOptions& options) {
+	Binder binder { options, source };
+	Assigned assigned(table.fields.size());
+	binder.bind_block(source, table, object, assigned, true, false);
+	return std::move(binder.result);
+}
+
+BindResult detail::bind_file(const std::filesystem::path& path, const BindTable& table, void* object, const BindOptions& options) {
+	BasicBufferHandler<lexy::utf8_char_encoding> buffer_handler;
+	if (auto error = load_source(path, buffer_handler); error) {
+		BindResult result;
+		result.errors.push_back(error.value());
+		return result;
+	}
+	return bind_buffer(get_source(buffer_handler), table, object, options);
+}
@@ -0,0 +1,272 @@
+#include <charconv>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <lexy-vdf/CompiledPath.hpp>
+#include <lexy-vdf/KeyValues.hpp>
+
+using namespace lexy_vdf;
+
+namespace {
+	struct PathReader {
+		std::string_view source;
+		std::size_t position = 0;
+
+		bool at_end() const { return position >= source.size(); }
+		char peek() const { return source[position]; }
+
+		/// Reads until one of stop_chars, resolving backslash escapes.
+		std::optional<std::string> read_until(std::string_view stop_chars) {
+			std::string result;
+			while (!at_end() && stop_chars.find(peek()) == std::string_view::npos) {
+				if (peek() == '\\') {
+					position++;
+					if (at_end()) return std::nullopt;
+				}
+				result.push_back(source[position++]);
+			}
+			return result;
+		}
+	};
+
+	std::size_t hash_key(std::string_view key) {
+		return string_hash {}(key);
+	}
+
+	std::optional<CompiledPath::Predicate> compile_predicate(PathReader& reader) {
+		// reader is positioned after '['
+		std::optional<std::string> key = reader.read_until("=]");
+		if (!key || key->empty() || reader.at_end()) return std::nullopt;
+
+		CompiledPath::Predicate predicate {};
+		predicate.key = std::move(*key);
+		predicate.hash = hash_key(predicate.key);
+		if (reader.peek() == '=') {
+			reader.position++;
+			std::optional<std::string> value = reader.read_until("]");
+			if (!value || reader.at_end()) return std::nullopt;
+
+			std::int32_t int_value;
+			auto [int_end, int_error] = std::from_chars(value->data(), value->data() + value->size(), int_value);
+			if (int_error == std::errc {} && int_end == value->data() + value->size()) predicate.int_value = int_value;
+
+			char* float_end;
+			const double float_value = std::strtod(value->c_str(), &float_end);
+			if (!value->empty() && float_end == value->c_str() + value->size()) predicate.float_value = static_cast<std::float_t>(float_value);
+
+			predicate.value = std::move(*value);
+		}
+		reader.position++; // ']'
+		return predicate;
+	}
+
+	std::optional<CompiledPath::Segment> compile_segment(PathReader& reader) {
+		CompiledPath::Segment segment {};
+		segment.type = CompiledPath::Segment::Type::Key;
+
+		if (reader.peek() == '[') {
+			std::size_t end = reader.source.find(']', reader.position);
+			if (end == std::string_view::npos) return std::nullopt;
+			std::string_view index = reader.source.substr(reader.position + 1, end - reader.position - 1);
+			std::size_t number;
+			auto [index_end, error] = std::from_chars(index.data(), index.data() + index.size(), number);
+			if (error != std::errc {} || index_end != index.data() + index.size()) return std::nullopt;
+			segment.key = std::to_string(number);
+			reader.position = end + 1;
+		} else if (reader.peek() == '*' && (reader.position + 1 == reader.source.size() || reader.source[reader.position + 1] == '/' || reader.source[reader.position + 1] == '[')) {
+			segment.type = CompiledPath::Segment::Type::Wildcard;
+			reader.position++;
+		} else {
+			std::optional<std::string> key = reader.read_until("/[");
+			if (!key || key->empty()) return std::nullopt;
+			segment.key = std::move(*key);
+		}
+		segment.hash = hash_key(segment.key);
+
+		while (!reader.at_end() && reader.peek() == '[') {
+			reader.position++;
+			std::optional<CompiledPath::Predicate> predicate = compile_predicate(reader);
+			if (!predicate) return std::nullopt;
+			segment.predicates.push_back(std::move(*predicate));
+		}
+
+		if (!reader.at_end()) {
+			if (reader.peek() != '/') return std::nullopt;
+			reader.position++;
+			if (reader.at_end()) return std::nullopt;
+		}
+		return segment;
+	}
+
+	template<typename Callback>
+	void for_each_match(const KeyValues& block, const CompiledPath::Segment& segment, Callback&& callback) {
+		if (segment.type == CompiledPath::Segment::Type::Key) {
+			auto found = block.find(segment.lookup_key());
+			if (found != block.end() && segment.matches_value(found->second)) callback(found->second);
+			return;
+		}
+
+		for (const auto& node : block) {
+			if (segment.matches_value(node.second)) callback(node.second);
+		}
+	}
+
+	void evaluate_path(const KeyValues& block, const std::vector<CompiledPath::Segment>& segments, std::size_t index, std::vector<const ValueType*>& result) {
+		for_each_match(block, segments[index], [&](const ValueType& value) {
+			if (index + 1 == segments.size()) {
+				result.push_back(&value);
+			} else if (const KeyValues* child = std::get_if<KeyValues>(&value)) {
+				evaluate_path(*child, segments, index + 1, result);
+			}
+		});
+	}
+}
+
+bool CompiledPath::Predicate::matches(const ValueType& p_value) const {
+	const KeyValues* block = std::get_if<KeyValues>(&p_value);
+	if (!block) return false;
+
+	auto found = block->find(PrehashedKey { key, hash });
+	if (found == block->end()) return false;
+	if (!value) return true;
+
+	return std::visit([this](auto&& arg) -> bool {
+		using T = std::decay_t<decltype(arg)>;
+		if constexpr (std::is_same_v<T, std::string>) {
+			return arg == *value;
+		} else if constexpr (std::is_same_v<T, std::int32_t>) {
+			return int_value && arg == *int_value;
+		} else if constexpr (std::is_same_v<T, std::float_t>) {
+			return float_value && arg == *float_value;
+		}
+		return false;
+	},
+		found->second);
+}
+
+bool CompiledPath::Segment::matches_key(KeyObserverType p_key) const {
+	return type == Type::Wildcard || key == p_key;
+}
+
+bool CompiledPath::Segment::matches_value(const ValueType& p_value) const {
+	for (const Predicate& predicate : predicates) {
+		if (!predicate.matches(p_value)) return false;
+	}
+	return true;
+}
+
+PrehashedKey CompiledPath::Segment::lookup_key() const {
+	return PrehashedKey { key, hash };
+}
+
+std::optional<CompiledPath> CompiledPath::compile(std::string_view p_path) {
+	if (p_path.empty()) return std::nullopt;
+
+	CompiledPath result;
+	result._source = p_path;
+	PathReader reader { result._source };
+	while (!reader.at_end()) {
+		std::optional<Segment> segment = compile_segment(reader);
+		if (!segment) return std::nullopt;
+		result._segments.push_back(std::move(*segment));
+	}
+	return result;
+}
+
+const std::vector<CompiledPath::Segment>& CompiledPath::segments() const {
+	return _segments;
+}
+
+std::string_view CompiledPath::source() const {
+	return _source;
+}
+
+std::vector<const ValueType*> CompiledPath::evaluate(const KeyValues& p_key_values) const {
+	std::vector<const ValueType*> result;
+	if (!_segments.empty()) evaluate_path(p_key_values, _segments, 0, result);
+	return result;
+}
+
+/// QueryBatch ///
+
+struct QueryBatch::Node {
+	CompiledPath::Segment segment;
+	std::vector<std::unique_ptr<Node>> children;
+	std::vector<std::size_t> terminals;
+
+	void evaluate(const KeyValues& block, result_type& result) const {
+		for (const std::unique_ptr<Node>& child : children) {
+			for_each_match(block, child->segment, [&](const ValueType& value) {
+				for (std::size_t terminal : child->terminals) {
+					result[terminal].push_back(&value);
+				}
+				if (child->children.empty()) return;
+				if (const KeyValues* child_block = std::get_if<KeyValues>(&value)) {
+					child->evaluate(*child_block, result);
+				}
+			});
+		}
+	}
+};
+
+QueryBatch::QueryBatch() : _root(std::make_unique<Node>()) {}
+
+QueryBatch::QueryBatch(const std::vector<CompiledPath>& p_paths) : QueryBatch() {
+	for (const CompiledPath& path : p_paths) {
+		add(path);
+	}
+}
+
+QueryBatch::QueryBatch(QueryBatch&&) = default;
+QueryBatch& QueryBatch::operator=(QueryBatch&&) = default;
+QueryBatch::~QueryBatch() = default;
+
+///
+/// @brief Adds p_path to the batch, returning the index of its results in evaluate
+///
+std::size_t QueryBatch::add(const CompiledPath& p_path) {
+	Node* node = _root.get();
+	for (const CompiledPath::Segment& segment : p_path.segments()) {
+		Node* next = nullptr;
+		for (const std::unique_ptr<Node>& child : node->children) {
+			if (child->segment == segment) {
+				next = child.get();
+				break;
+			}
+		}
+		if (!next) {
+			next = node->children.emplace_back(std::make_unique<Node>(segment)).get();
+		}
+		node = next;
+	}
+	node->terminals.push_back(_path_count);
+	return _path_count++;
+}
+
+std::size_t QueryBatch::size() const {
+	return _path_count;
+}
+
+QueryBatch::result_type QueryBatch::evaluate(const KeyValues& p_key_values) const {
+	result_type result(_path_count);
+	_root->evaluate(p_key_values, result);
+	return result;
+}
+
+/// KeyValues ///
+
+std::vector<const ValueType*> KeyValues::query(std::string_view p_path) const {
+	std::optional<CompiledPath> path = CompiledPath::compile(p_path);
+	if (!path) return {};
+	return path->evaluate(*this);
+}
+
+std::vector<const ValueType*> KeyValues::query(const CompiledPath& p_path) const {
+	return p_path.evaluate(*this);
+}
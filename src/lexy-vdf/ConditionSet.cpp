@@ -0,0 +1,134 @@
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <lexy-vdf/ConditionSet.hpp>
+
+using namespace lexy_vdf;
+
+ConditionSet::ConditionSet(std::initializer_list<std::string_view> p_names) {
+	for (std::string_view name : p_names) {
+		add(name);
+	}
+}
+
+///
+/// @brief Enables p_name, interning it first if needed
+///
+/// @return false when every index is already taken by another name
+///
+bool ConditionSet::add(std::string_view p_name) {
+	const Index index = intern(p_name);
+	if (index == unknown) return false;
+	_enabled.set(index);
+	return true;
+}
+
+bool ConditionSet::remove(std::string_view p_name) {
+	const Index index = find(p_name);
+	if (!test(index)) return false;
+	_enabled.reset(index);
+	return true;
+}
+
+bool ConditionSet::contains(std::string_view p_name) const {
+	return test(find(p_name));
+}
+
+///
+/// @brief Disables every condition, interned names keep their index
+///
+void ConditionSet::clear() {
+	_enabled.reset();
+}
+
+ConditionSet::Index ConditionSet::intern(std::string_view p_name) {
+	if (auto found = _indices.find(p_name); found != _indices.end()) return found->second;
+	if (_names.size() == capacity) return unknown;
+
+	const Index index = static_cast<Index>(_names.size());
+	_names.emplace_back(p_name);
+	_indices.emplace(p_name, index);
+	return index;
+}
+
+ConditionSet::Index ConditionSet::find(std::string_view p_name) const {
+	auto found = _indices.find(p_name);
+	return found == _indices.end() ? unknown : found->second;
+}
+
+std::vector<std::string_view> ConditionSet::enabled() const {
+	std::vector<std::string_view> result;
+	result.reserve(size());
+	for (std::size_t index = 0; index < _names.size(); index++) {
+		if (_enabled.test(index)) result.push_back(_names[index]);
+	}
+	return result;
+}
+
+ConditionPredicate::ConditionPredicate(std::vector<Instruction> p_program, std::vector<std::string> p_names)
+	: _program(std::move(p_program)),
+	  _names(std::move(p_names)) {}
+
+///
+/// @brief Runs the program with a bit stack, operands are looked up by name in p_conditions
+///
+bool ConditionPredicate::evaluate(const ConditionSet& p_conditions) const {
+	if (_program.empty()) return true;
+
+	std::uint64_t stack = 0;
+	for (const Instruction& instruction : _program) {
+		switch (instruction.op) {
+			case Op::Test:
+				stack = (stack << 1) | static_cast<std::uint64_t>(p_conditions.contains(_names[instruction.operand]));
+				break;
+			case Op::Not:
+				stack ^= 1;
+				break;
+			case Op::And:
+				stack = (stack >> 1) & (stack | ~std::uint64_t { 1 });
+				break;
+			case Op::Or:
+				stack = (stack >> 1) | (stack & 1);
+				break;
+		}
+	}
+	return stack & 1;
+}
+
+///
+/// @brief Rebuilds the attribute text, e.g. "[$WIN32 && !$X360]"
+///
+std::string ConditionPredicate::to_string() const {
+	// Operator precedence of each partial expression, to only parenthesize where needed.
+	std::vector<std::pair<std::string, int>> stack;
+	for (const Instruction& instruction : _program) {
+		switch (instruction.op) {
+			case Op::Test:
+				stack.emplace_back('$' + _names[instruction.operand], 3);
+				break;
+			case Op::Not: {
+				auto& operand = stack.back();
+				operand.first = operand.second < 2 ? "!(" + operand.first + ')' : '!' + operand.first;
+				operand.second = 2;
+				break;
+			}
+			case Op::And:
+			case Op::Or: {
+				const int precedence = instruction.op == Op::And ? 1 : 0;
+				auto rhs = std::move(stack.back());
+				stack.pop_back();
+				auto& lhs = stack.back();
+				if (lhs.second < precedence) lhs.first = '(' + lhs.first + ')';
+				if (rhs.second <= precedence) rhs.first = '(' + rhs.first + ')';
+				lhs.first += instruction.op == Op::And ? " && " : " || ";
+				lhs.first += rhs.first;
+				lhs.second = precedence;
+				break;
+			}
+		}
+	}
+	return stack.empty() ? std::string() : '[' + stack.back().first + ']';
+}
@@ -0,0 +1,127 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <lexy-vdf/Diagnostics.hpp>
+
+using namespace lexy_vdf;
+
+namespace {
+	std::atomic<std::uint64_t> next_sink_id { 1 };
+
+	/// Buffer the calling thread last reported to, sink ids are never reused so a stale entry can't match.
+	struct LocalBuffer {
+		std::uint64_t sink = 0;
+		void* buffer = nullptr;
+	};
+	thread_local LocalBuffer local_buffer;
+
+	const char* severity_name(Diagnostic::Severity severity) {
+		switch (severity) {
+			case Diagnostic::Severity::Warning: return "warning";
+			case Diagnostic::Severity::Error: return "error";
+			case Diagnostic::Severity::Fatal: return "fatal error";
+		}
+		return "error";
+	}
+}
+
+void lexy_vdf::write_diagnostic(std::string& p_out, const Diagnostic& p_diagnostic) {
+	if (!p_diagnostic.file.empty()) {
+		p_out += p_diagnostic.file;
+		p_out += ':';
+	}
+	if (p_diagnostic.line != 0) {
+		p_out += std::to_string(p_diagnostic.line);
+		p_out += ':';
+		p_out += std::to_string(p_diagnostic.column);
+		p_out += ':';
+	}
+	if (!p_diagnostic.file.empty() || p_diagnostic.line != 0) p_out += ' ';
+	p_out += severity_name(p_diagnostic.severity);
+	p_out += ": ";
+	p_out += p_diagnostic.message;
+	p_out += '\n';
+}
+
+NullDiagnosticSink& NullDiagnosticSink::instance() {
+	static NullDiagnosticSink sink;
+	return sink;
+}
+
+BufferedDiagnosticSink::BufferedDiagnosticSink(std::ostream& p_stream, std::size_t p_batch_size)
+	: BufferedDiagnosticSink(
+		  [&p_stream](std::vector<Diagnostic>& batch) {
+			  std::string text;
+			  for (const Diagnostic& diagnostic : batch) {
+				  write_diagnostic(text, diagnostic);
+			  }
+			  p_stream.write(text.data(), static_cast<std::streamsize>(text.size()));
+			  p_stream.flush();
+		  },
+		  p_batch_size) {}
+
+BufferedDiagnosticSink::BufferedDiagnosticSink(Flush p_flush, std::size_t p_batch_size)
+	: _flush(std::move(p_flush)), _batch_size(p_batch_size == 0 ? 1 : p_batch_size), _id(next_sink_id.fetch_add(1, std::memory_order_relaxed)) {}
+
+BufferedDiagnosticSink::~BufferedDiagnosticSink() {
+	flush();
+}
+
+///
+/// @brief Queues p_diagnostic on the calling thread's buffer, handing the buffer on once it holds a batch
+///
+void BufferedDiagnosticSink::report(Diagnostic&& p_diagnostic) {
+	Buffer& buffer = _local();
+	buffer.pending.push_back(std::move(p_diagnostic));
+	if (buffer.pending.size() < _batch_size) return;
+
+	std::lock_guard lock(_mutex);
+	_drain(buffer);
+}
+
+void BufferedDiagnosticSink::flush() {
+	std::lock_guard lock(_mutex);
+	for (auto& [thread, buffer] : _buffers) {
+		_drain(*buffer);
+	}
+}
+
+void BufferedDiagnosticSink::flush_thread() {
+	Buffer& buffer = _local();
+	if (buffer.pending.empty()) return;
+
+	std::lock_guard lock(_mutex);
+	_drain(buffer);
+}
+
+///
+/// @brief Buffer of the calling thread, registered on its first report
+///
+/// A thread only looks the buffer up under the lock when it last reported to another sink.
+///
+BufferedDiagnosticSink::Buffer& BufferedDiagnosticSink::_local() {
+	if (local_buffer.sink == _id) return *static_cast<Buffer*>(local_buffer.buffer);
+
+	std::lock_guard lock(_mutex);
+	std::unique_ptr<Buffer>& buffer = _buffers[std::this_thread::get_id()];
+	if (!buffer) {
+		buffer = std::make_unique<Buffer>();
+		buffer->pending.reserve(_batch_size);
+	}
+	local_buffer = { _id, buffer.get() };
+	return *buffer;
+}
+
+void BufferedDiagnosticSink::_drain(Buffer& buffer) {
+	if (buffer.pending.empty()) return;
+	if (_flush) _flush(buffer.pending);
+	buffer.pending.clear();
+}
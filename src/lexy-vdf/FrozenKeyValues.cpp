@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <lexy-vdf/FrozenKeyValues.hpp>
+#include <lexy-vdf/KeyValues.hpp>
+
+#include "detail/KeyValuesHash.hpp"
+#include "detail/MemoryEstimate.hpp"
+
+using namespace lexy_vdf;
+
+namespace {
+	std::size_t hash_frozen_value(const FrozenValueType& value) {
+		return std::visit([](auto&& arg) -> std::size_t {
+			using T = std::decay_t<decltype(arg)>;
+			if constexpr (std::is_same_v<T, std::monostate>) {
+				return detail::hash_seed(0);
+			} else if constexpr (std::is_same_v<T, FrozenString>) {
+				return detail::hash_string(*arg);
+			} else if constexpr (std::is_same_v<T, std::int32_t>) {
+				return detail::hash_int(arg);
+			} else if constexpr (std::is_same_v<T, std::float_t>) {
+				return detail::hash_float(arg);
+			} else if constexpr (std::is_same_v<T, FrozenBlock>) {
+				return detail::hash_block(arg->hash());
+			}
+		},
+			value);
+	}
+
+	bool frozen_equals(const FrozenValueType& frozen, const ValueType& value) {
+		if (frozen.index() != value.index()) return false;
+		switch (value.index()) {
+			case 0: return true;
+			case 1: return *std::get<FrozenString>(frozen) == std::get<std::string>(value);
+			case 2: return std::get<std::int32_t>(frozen) == std::get<std::int32_t>(value);
+			case 3: return std::get<std::float_t>(frozen) == std::get<std::float_t>(value);
+			case 4: return std::get<FrozenBlock>(frozen)->equals(std::get<KeyValues>(value));
+			default: return false;
+		}
+	}
+
+	bool frozen_equals(const FrozenValueType& lhs, const FrozenValueType& rhs) {
+		if (lhs.index() != rhs.index()) return false;
+		switch (lhs.index()) {
+			case 0: return true;
+			case 1: {
+				const FrozenString& left = std::get<FrozenString>(lhs);
+				const FrozenString& right = std::get<FrozenString>(rhs);
+				return left == right || *left == *right;
+			}
+			case 2: return std::get<std::int32_t>(lhs) == std::get<std::int32_t>(rhs);
+			case 3: return std::get<std::float_t>(lhs) == std::get<std::float_t>(rhs);
+			case 4: {
+				const FrozenBlock& left = std::get<FrozenBlock>(lhs);
+				const FrozenBlock& right = std::get<FrozenBlock>(rhs);
+				return left == right || left->equals(*right);
+			}
+			default: return false;
+		}
+	}
+
+	/// Bytes owned by one frozen block itself, its children are accounted for when they are interned.
+	std::size_t own_bytes(const FrozenKeyValues& block) {
+		std::size_t result = sizeof(FrozenKeyValues) + detail::shared_overhead + block.size() * sizeof(FrozenKeyValues::Entry) +
+			block.conditionals().size() * sizeof(ConditionalEntry);
+		for (const FrozenKeyValues::Entry& entry : block) {
+			result += detail::string_heap_bytes(entry.key);
+		}
+		return result;
+	}
+
+	struct Freezer {
+		detail::SubtreeHashCache hashes;
+
+		FrozenValueType freeze_value(const ValueType& value, const FrozenValueType* previous) {
+			return std::visit([&](auto&& arg) -> FrozenValueType {
+				using T = std::decay_t<decltype(arg)>;
+				if constexpr (std::is_same_v<T, std::monostate>) {
+					return std::monostate {};
+				} else if constexpr (std::is_same_v<T, std::string>) {
+					if (previous && frozen_equals(*previous, value)) return *previous;
+					return std::make_shared<const std::string>(arg);
+				} else if constexpr (std::is_same_v<T, std::int32_t> || std::is_same_v<T, std::float_t>) {
+					return arg;
+				} else if constexpr (std::is_same_v<T, KeyValues>) {
+					const FrozenBlock* previous_block = previous ? std::get_if<FrozenBlock>(previous) : nullptr;
+					return freeze_block(arg, previous_block ? *previous_block : nullptr);
+				}
+			},
+				value);
+		}
+
+		FrozenBlock freeze_block(const KeyValues& key_values, const FrozenBlock& previous) {
+			if (previous && previous->size() == key_values.size() &&
+				previous->hash() == detail::hash_key_values(key_values, &hashes) &&
+				previous->equals(key_values)) {
+				return previous;
+			}
+
+			std::vector<FrozenKeyValues::Entry> entries;
+			entries.reserve(key_values.size());
+			for (const auto& [key, value] : key_values) {
+				const FrozenValueType* previous_value = previous ? previous->find(key) : nullptr;
+				entries.push_back({ key, freeze_value(value, previous_value) });
+			}
+			return std::make_shared<const FrozenKeyValues>(std::move(entries), key_values.conditionals());
+		}
+	};
+
+	FrozenBlock rebuild_path(const FrozenKeyValues& block, std::span<const KeyObserverType> path, const FrozenValueType* value) {
+		std::vector<FrozenKeyValues::Entry> entries(block.begin(), block.end());
+		auto found = std::lower_bound(entries.begin(), entries.end(), path.front(), [](const FrozenKeyValues::Entry& entry, KeyObserverType key) {
+			return entry.key < key;
+		});
+		const bool exists = found != entries.end() && found->key == path.front();
+
+		if (path.size() == 1) {
+			if (!value) {
+				if (exists) entries.erase(found);
+			} else if (exists) {
+				found->value = *value;
+			} else {
+				entries.insert(found, { KeyType(path.front()), *value });
+			}
+			return std::make_shared<const FrozenKeyValues>(std::move(entries), block.conditionals());
+		}
+
+		const FrozenBlock* child = exists ? std::get_if<FrozenBlock>(&found->value) : nullptr;
+		if (!child) {
+			if (!value) return nullptr;
+			FrozenKeyValues empty({});
+			FrozenValueType next = rebuild_path(empty, path.subspan(1), value);
+			if (exists) {
+				found->value = std::move(next);
+			} else {
+				entries.insert(found, { KeyType(path.front()), std::move(next) });
+			}
+		} else {
+			FrozenBlock next = rebuild_path(**child, path.subspan(1), value);
+			if (!next) return nullptr;
+			found->value = std::move(next);
+		}
+		return std::make_shared<const FrozenKeyValues>(std::move(entries), block.conditionals());
+	}
+}
+
+FrozenKeyValues::FrozenKeyValues(std::vector<Entry> entries, std::vector<ConditionalEntry> conditionals)
+	: _entries(std::move(entries)), _conditionals(std::move(conditionals)) {
+	std::stable_sort(_entries.begin(), _entries.end(), [](const Entry& lhs, const Entry& rhs) {
+		return lhs.key < rhs.key;
+	});
+	// KeyValues keeps the first of duplicate keys, so do the same
+	_entries.erase(std::unique(_entries.begin(), _entries.end(), [](const Entry& lhs, const Entry& rhs) {
+		return lhs.key == rhs.key;
+	}),
+		_entries.end());
+
+	_hash = detail::hash_block_seed(_entries.size());
+	for (const Entry& entry : _entries) {
+		_hash += detail::hash_entry(entry.key, hash_frozen_value(entry.value));
+	}
+	if (!_conditionals.empty()) _hash += detail::hash_conditionals(_conditionals, nullptr);
+}
+
+FrozenBlock FrozenKeyValues::freeze(const KeyValues& p_key_values) {
+	return freeze(p_key_values, nullptr);
+}
+
+///
+/// @brief Freezes p_key_values, sharing every subtree and string that is unchanged from p_previous
+///
+/// If nothing changed p_previous itself is returned.
+///
+FrozenBlock FrozenKeyValues::freeze(const KeyValues& p_key_values, const FrozenBlock& p_previous) {
+	Freezer freezer;
+	return freezer.freeze_block(p_key_values, p_previous);
+}
+
+///
+/// @brief Returns a new version with p_value stored at p_path, creating missing blocks along the way
+///
+/// Only the blocks on p_path are copied, every other subtree is shared with this version.
+///
+FrozenBlock FrozenKeyValues::with(std::span<const KeyObserverType> p_path, const ValueType& p_value) const {
+	if (p_path.empty()) return nullptr;
+	Freezer freezer;
+	FrozenValueType value = freezer.freeze_value(p_value, nullptr);
+	return rebuild_path(*this, p_path, &value);
+}
+
+///
+/// @brief Returns a new version with the entry at p_path removed, or nullptr if p_path does not lead through blocks
+///
+FrozenBlock FrozenKeyValues::without(std::span<const KeyObserverType> p_path) const {
+	if (p_path.empty()) return nullptr;
+	return rebuild_path(*this, p_path, nullptr);
+}
+
+KeyValues FrozenKeyValues::thaw() const {
+	KeyValues result;
+	result.reserve(_entries.size());
+	for (const Entry& entry : _entries) {
+		result.emplace(entry.key, std::visit([](auto&& arg) -> ValueType {
+			using T = std::decay_t<decltype(arg)>;
+			if constexpr (std::is_same_v<T, FrozenString>) {
+				return *arg;
+			} else if constexpr (std::is_same_v<T, FrozenBlock>) {
+				return arg->thaw();
+			} else {
+				return arg;
+			}
+		},
+						  entry.value));
+	}
+	for (const ConditionalEntry& entry : _conditionals) {
+		result.add_conditional(entry.key, entry.value, entry.predicate);
+	}
+	return result;
+}
+
+bool FrozenKeyValues::equals(const KeyValues& p_key_values) const {
+	if (_entries.size() != p_key_values.size() || _conditionals != p_key_values.conditionals()) return false;
+	for (const Entry& entry : _entries) {
+		auto found = p_key_values.find(entry.key);
+		if (found == p_key_values.end() || !frozen_equals(entry.value, found->second)) return false;
+	}
+	return true;
+}
+
+bool FrozenKeyValues::equals(const FrozenKeyValues& p_other) const {
+	if (this == &p_other) return true;
+	if (_hash != p_other._hash || _entries.size() != p_other._entries.size()) return false;
+	for (std::size_t index = 0; index < _entries.size(); index++) {
+		const Entry& lhs = _entries[index];
+		const Entry& rhs = p_other._entries[index];
+		if (lhs.key != rhs.key || !frozen_equals(lhs.value, rhs.value)) return false;
+	}
+	return _conditionals == p_other._conditionals;
+}
+
+FrozenKeyValues::const_iterator FrozenKeyValues::_lower_bound(KeyObserverType key) const {
+	return std::lower_bound(_entries.begin(), _entries.end(), key, [](const Entry& entry, KeyObserverType key) {
+		return entry.key < key;
+	});
+}
+
+const FrozenValueType* FrozenKeyValues::find(KeyObserverType p_key) const {
+	const_iterator found = _lower_bound(p_key);
+	if (found == _entries.end() || found->key != p_key) return nullptr;
+	return &found->value;
+}
+
+bool FrozenKeyValues::contains(KeyObserverType p_key) const {
+	return find(p_key) != nullptr;
+}
+
+std::int32_t FrozenKeyValues::GetInt(KeyObserverType p_key, std::int32_t p_default_value) const {
+	const FrozenValueType* value = find(p_key);
+	if (!value) return p_default_value;
+	const std::int32_t* result = std::get_if<std::int32_t>(value);
+	if (!result) return p_default_value;
+	return *result;
+}
+
+std::float_t FrozenKeyValues::GetFloat(KeyObserverType p_key, std::float_t p_default_value) const {
+	const FrozenValueType* value = find(p_key);
+	if (!value) return p_default_value;
+	const std::float_t* result = std::get_if<std::float_t>(value);
+	if (!result) return p_default_value;
+	return *result;
+}
+
+std::string_view FrozenKeyValues::GetString(KeyObserverType p_key, std::string_view p_default_value) const {
+	const FrozenValueType* value = find(p_key);
+	if (!value) return p_default_value;
+	const FrozenString* result = std::get_if<FrozenString>(value);
+	if (!result) return p_default_value;
+	return **result;
+}
+
+FrozenBlock FrozenKeyValues::GetBlock(KeyObserverType p_key) const {
+	const FrozenValueType* value = find(p_key);
+	if (!value) return nullptr;
+	const FrozenBlock* result = std::get_if<FrozenBlock>(value);
+	if (!result) return nullptr;
+	return *result;
+}
+
+std::size_t FrozenInterner::StringHash::operator()(std::string_view string) const {
+	return detail::hash_string(string);
+}
+
+///
+/// @brief Children are interned before their parents, so equal blocks compare their children by pointer
+///
+bool FrozenInterner::BlockEqual::operator()(const FrozenBlock& lhs, const FrozenBlock& rhs) const {
+	return lhs->equals(*rhs);
+}
+
+///
+/// @brief Freezes p_key_values bottom up, replacing every string and block with an equal one seen before
+///
+FrozenBlock FrozenInterner::freeze(const KeyValues& p_key_values) {
+	std::vector<FrozenKeyValues::Entry> entries;
+	entries.reserve(p_key_values.size());
+	for (const auto& [key, value] : p_key_values) {
+		entries.push_back({ key, _freeze_value(value) });
+	}
+	return _intern_block(std::make_shared<const FrozenKeyValues>(std::move(entries), p_key_values.conditionals()));
+}
+
+///
+/// @brief Deduplicates an already frozen tree, subtrees that are interned already are returned as is
+///
+FrozenBlock FrozenInterner::intern(const FrozenBlock& p_block) {
+	if (!p_block) return nullptr;
+	if (auto found = _blocks.find(p_block); found != _blocks.end() && *found == p_block) return p_block;
+
+	std::vector<FrozenKeyValues::Entry> entries;
+	entries.reserve(p_block->size());
+	bool changed = false;
+	for (const FrozenKeyValues::Entry& entry : *p_block) {
+		FrozenValueType value = _intern_value(entry.value);
+		changed |= value != entry.value;
+		entries.push_back({ entry.key, std::move(value) });
+	}
+	return _intern_block(changed ? std::make_shared<const FrozenKeyValues>(std::move(entries), p_block->conditionals()) : p_block);
+}
+
+FrozenString FrozenInterner::intern(std::string_view p_string) {
+	_stats.strings++;
+	if (auto found = _strings.find(p_string); found != _strings.end()) {
+		_stats.shared_strings++;
+		_stats.bytes_saved += sizeof(std::string) + detail::shared_overhead + detail::string_heap_bytes(p_string.size());
+		return *found;
+	}
+	return *_strings.insert(std::make_shared<const std::string>(p_string)).first;
+}
+
+void FrozenInterner::clear() {
+	_strings.clear();
+	_blocks.clear();
+	_stats = {};
+}
+
+FrozenValueType FrozenInterner::_freeze_value(const ValueType& value) {
+	return std::visit([this](auto&& arg) -> FrozenValueType {
+		using T = std::decay_t<decltype(arg)>;
+		if constexpr (std::is_same_v<T, std::monostate>) {
+			return std::monostate {};
+		} else if constexpr (std::is_same_v<T, std::string>) {
+			return intern(arg);
+		} else if constexpr (std::is_same_v<T, std::int32_t> || std::is_same_v<T, std::float_t>) {
+			return arg;
+		} else if constexpr (std::is_same_v<T, KeyValues>) {
+			return freeze(arg);
+		}
+	},
+		value);
+}
+
+FrozenValueType FrozenInterner::_intern_value(const FrozenValueType& value) {
+	if (const FrozenString* string = std::get_if<FrozenString>(&value)) {
+		_stats.strings++;
+		auto [found, inserted] = _strings.insert(*string);
+		if (!inserted && *found != *string) {
+			_stats.shared_strings++;
+			_stats.bytes_saved += sizeof(std::string) + detail::shared_overhead + detail::string_heap_bytes(**string);
+		}
+		return *found;
+	}
+	if (const FrozenBlock* block = std::get_if<FrozenBlock>(&value)) {
+		return intern(*block);
+	}
+	return value;
+}
+
+FrozenBlock FrozenInterner::_intern_block(FrozenBlock block) {
+	_stats.blocks++;
+	auto [found, inserted] = _blocks.insert(block);
+	if (!inserted && *found != block) {
+		_stats.shared_blocks++;
+		_stats.bytes_saved += own_bytes(*block);
+	}
+	return *found;
+}
@@ -6,9 +6,11 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <variant>
 
+#include <lexy-vdf/ConditionSet.hpp>
 #include <lexy-vdf/KeyValues.hpp>
 #include <lexy-vdf/Parser.hpp>
 
@@ -22,8 +24,20 @@
 
 #include "lexy-vdf/ParseWarning.hpp"
 
+#include "detail/Condition.hpp"
+#include "detail/LexyQuotedString.hpp"
+#include "detail/RecycledTree.hpp"
 #include "detail/Warnings.hpp"
 
+#ifdef LVDF_PROFILING
+#include "detail/LexyProfile.hpp"
+#include "detail/Profiler.hpp"
+
+#define LVDF_PROFILED(production, ...) lexy_vdf::detail::lexydsl::profile<lexy_vdf::detail::ProfileId::production>(__VA_ARGS__)
+#else
+#define LVDF_PROFILED(production, ...) __VA_ARGS__
+#endif
+
 namespace lexy_vdf::grammar {
 	struct KeyValueStatement;
 
@@ -35,40 +49,27 @@ namespace lexy_vdf::grammar {
 
 	struct EmplaceFile {
 		std::string file;
+		/// A #base inside a block, deep merged in place rather than appended.
+		bool base = false;
+	};
+
+	struct EmplaceBase {
+		std::string file;
 	};
 
 	static constexpr auto whitespace_specifier = lexy::dsl::unicode::blank / lexy::dsl::unicode::newline;
 	static constexpr auto comment_specifier = LEXY_LIT("//") >> lexy::dsl::until(lexy::dsl::newline).or_eof();
 
 	struct PlainValue {
-		static constexpr auto rule = lexy::dsl::identifier(lexy::dsl::unicode::xid_start_underscore, lexy::dsl::unicode::xid_continue);
+		static constexpr auto rule = LVDF_PROFILED(PlainValue, lexy::dsl::identifier(lexy::dsl::unicode::xid_start_underscore, lexy::dsl::unicode::xid_continue));
 		static constexpr auto value = lexy::as_string<std::string>;
 	};
 
 	struct StringValue {
-		static constexpr auto escaped_symbols = lexy::symbol_table<char> //
-													.map<'"'>('"')
-													.map<'\''>('\'')
-													.map<'\\'>('\\')
-													.map<'/'>('/')
-													.map<'b'>('\b')
-													.map<'f'>('\f')
-													.map<'n'>('\n')
-													.map<'r'>('\r')
-													.map<'t'>('\t');
-		static constexpr auto rule = [] {
-			// Arbitrary code points that aren't control characters.
-			auto c = -lexy::dsl::unicode::control;
-
-			// Escape sequences start with a backlash.
-			// They either map one of the symbols,
-			// or a Unicode code point of the form uXXXX.
-			auto escape = lexy::dsl::backslash_escape //
-							  .symbol<escaped_symbols>();
-			return lexy::dsl::quoted(c, escape);
-		}();
-
-		static constexpr auto value = lexy::as_string<std::string>;
+		// Arbitrary code points that aren't control characters, and backslash escapes of
+		// " ' \\ / b f n r t, see detail::unescape_symbol.
+		static constexpr auto rule = LVDF_PROFILED(StringValue, detail::lexydsl::quoted_string);
+		static constexpr auto value = lexy::forward<std::string>;
 	};
 
 	struct FloatValue : lexy::token_production {
@@ -81,7 +82,7 @@ namespace lexy_vdf::grammar {
 			// We want either a fraction with an optional exponent, or an exponent.
 			auto real_part = fraction >> lexy::dsl::if_(exponent) | exponent;
 			auto real_number = lexy::dsl::token(integer_part + real_part);
-			return lexy::dsl::capture(real_number);
+			return LVDF_PROFILED(FloatValue, lexy::dsl::capture(real_number));
 		}();
 		static constexpr auto value =
 			lexy::as_string<std::string> |
@@ -91,12 +92,12 @@ namespace lexy_vdf::grammar {
 	};
 
 	struct IntegerValue : lexy::token_production {
-		static constexpr auto rule = LEXY_LIT("0x") >> lexy::dsl::integer<int, lexy::dsl::hex> | lexy::dsl::integer<int>;
+		static constexpr auto rule = LVDF_PROFILED(IntegerValue, LEXY_LIT("0x") >> lexy::dsl::integer<int, lexy::dsl::hex> | lexy::dsl::integer<int>);
 		static constexpr auto value = lexy::forward<std::int32_t>;
 	};
 
 	struct IncludeStatement {
-		static constexpr auto rule = (LEXY_LIT("#include") | LEXY_LIT("#base")) >> lexy::dsl::p<StringValue>;
+		static constexpr auto rule = LVDF_PROFILED(IncludeStatement, LEXY_LIT("#include") >> lexy::dsl::p<StringValue>);
 		static constexpr auto value =
 			lexy::as_string<std::string> |
 			lexy::callback_with_state<EmplaceFile>(
@@ -105,25 +106,139 @@ namespace lexy_vdf::grammar {
 				});
 	};
 
-	struct ListValue {
-		static constexpr auto rule = lexy::dsl::curly_bracketed.list(lexy::dsl::recurse_branch<KeyValueStatement> | lexy::dsl::p<IncludeStatement>);
+	/// A #base inside a block, deep merged in place so it only fills in what the entries before it lack.
+	struct NestedBaseStatement {
+		static constexpr auto rule = LVDF_PROFILED(BaseStatement, LEXY_LIT("#base") >> lexy::dsl::p<StringValue>);
 		static constexpr auto value =
-			lexy::fold_inplace<KeyValues>(
-				std::initializer_list<KeyValues::value_type> {},
-				[](Parser::State&, KeyValues& values, KeyValues::copy_pair_type kv) {
-					if (kv.second.index() == 0) return;
-					values.emplace(kv.first, kv.second);
+			lexy::as_string<std::string> |
+			lexy::callback_with_state<EmplaceFile>(
+				[](Parser::State&, auto&& base) {
+					return EmplaceFile { LEXY_MOV(base), true };
+				});
+	};
+
+	/// A top level #base, merged under the file once it is complete so the file's own keys win
+	/// wherever the statement stands.
+	struct BaseStatement {
+		static constexpr auto rule = LVDF_PROFILED(BaseStatement, LEXY_LIT("#base") >> lexy::dsl::p<StringValue>);
+		static constexpr auto value =
+			lexy::as_string<std::string> |
+			lexy::callback_with_state<EmplaceBase>(
+				[](Parser::State&, auto&& base) {
+					return EmplaceBase { LEXY_MOV(base) };
+				});
+	};
+
+	struct Statement {
+		KeyType key;
+		ValueType value;
+		std::optional<detail::Condition> condition;
+		const char* key_position = nullptr;
+		const char* value_position = nullptr;
+	};
+
+	struct ListValue {
+		/// Entries whose condition does not hold are dropped, unless conditionals are kept and no
+		/// plain entry of that key came before them, see KeyValues::resolve.
+		static void insert(Parser::State* state, KeyValues& values, Statement statement) {
+			if (statement.value.index() == 0) return;
+#ifdef LVDF_PROFILING
+			detail::ProfileTimer timer([](detail::Profiler& profiler, auto time) {
+				profiler.add_insert(time);
+			});
+#endif
+			if (statement.condition) {
+				const detail::Condition& condition = *statement.condition;
+				if (state && state->keep_conditionals) {
+					if (!condition.overflow) {
+						if (!values.contains(statement.key)) {
+							values.add_conditional(LEXY_MOV(statement.key), LEXY_MOV(statement.value), condition.compile(state->conditions));
+						} else if (state->spans) {
+							state->spans->discard(statement.value);
+						}
+						return;
+					}
+					state->parse_warnings->push_back(warnings::condition_too_complex(statement.key));
+				}
+				if (!condition.value) {
+					if (state && state->spans) state->spans->discard(statement.value);
+					return;
+				}
+			}
+
+			// try_emplace leaves a duplicate's value in the statement, so its spans can be discarded
+			auto [entry, inserted] = values.try_emplace(LEXY_MOV(statement.key), LEXY_MOV(statement.value));
+			if (!state || !state->spans) return;
+			if (!inserted) {
+				state->spans->discard(statement.value);
+				return;
+			}
+			state->spans->record(*entry, state->offset_of(statement.key_position), state->offset_of(statement.value_position));
+		}
+
+		static KeyValues::MergeError merge(KeyValues& values, const std::string& file) {
+#ifdef LVDF_PROFILING
+			detail::ProfileTimer timer([&file](detail::Profiler& profiler, auto time) {
+				profiler.add_include(file, time);
+			});
+#endif
+			return values.MergeWith(file);
+		}
+
+		static KeyValues::MergeError merge_base(KeyValues& values, const std::string& file) {
+#ifdef LVDF_PROFILING
+			detail::ProfileTimer timer([&file](detail::Profiler& profiler, auto time) {
+				profiler.add_include(file, time);
+			});
+#endif
+			return values.merge_base(file);
+		}
+
+		static constexpr auto rule = LVDF_PROFILED(ListValue, lexy::dsl::curly_bracketed.list(lexy::dsl::recurse_branch<KeyValueStatement> | lexy::dsl::p<IncludeStatement> | lexy::dsl::p<NestedBaseStatement>));
+
+		/// Folds the statements of a block into a KeyValues constructed from init.
+		template<typename Init>
+		static constexpr auto fold(Init init) {
+			return lexy::fold_inplace<KeyValues>(
+				init,
+				[](Parser::State& state, KeyValues& values, Statement statement) {
+					insert(&state, values, LEXY_MOV(statement));
+				},
+				[](Parser::State& state, KeyValues& values, EmplaceFile file) {
+					const KeyValues::MergeError error = file.base ? merge_base(values, file.file) : merge(values, file.file);
+					if (auto warning = warnings::merge_check(file.file, error); warning) state.parse_warnings->push_back(warning.value());
 				},
-				[](Parser::State& state, KeyValues& values, auto file) {
-					if (auto warning = warnings::merge_check(file.file, values.MergeWith(file.file)); warning)
-						state.parse_warnings->push_back(warning.value());
+				[](Parser::State& state, KeyValues&, EmplaceBase base) {
+					state.bases.push_back(LEXY_MOV(base.file));
 				},
-				[](KeyValues& values, KeyValues::copy_pair_type kv) {
-					if (kv.second.index() == 0) return;
-					values.emplace(kv.first, kv.second);
+				[](KeyValues& values, Statement statement) {
+					insert(nullptr, values, LEXY_MOV(statement));
 				},
 				[](KeyValues& values, EmplaceFile file) {
-					values.MergeWith(file.file);
+					if (file.base) {
+						merge_base(values, file.file);
+					} else {
+						merge(values, file.file);
+					}
+				},
+				[](KeyValues& values, EmplaceBase base) {
+					merge_base(values, base.file);
+				});
+		}
+		static constexpr auto value = fold(std::initializer_list<KeyValues::value_type> {});
+	};
+
+	struct ConditionName {
+		static constexpr auto rule = lexy::dsl::identifier(lexy::dsl::unicode::xid_start_underscore, lexy::dsl::unicode::xid_continue);
+		static constexpr auto value =
+			lexy::callback_with_state<detail::Condition>(
+				[](Parser::State& state, auto lexeme) {
+					const std::string_view name(lexeme.data(), lexeme.size());
+					const ConditionSet::Index index = state.keep_conditionals ? state.conditions.intern(name) : state.conditions.find(name);
+					return detail::Condition::operand(index, state.conditions.test(index));
+				},
+				[](auto) {
+					return detail::Condition::operand(ConditionSet::unknown, false);
 				});
 	};
 
@@ -134,7 +249,7 @@ namespace lexy_vdf::grammar {
 
 		static constexpr auto atom = [] {
 			auto paren = lexy::dsl::parenthesized(lexy::dsl::recurse<ConditionalExpression>);
-			auto value = lexy::dsl::no_whitespace(LEXY_LIT("$") >> lexy::dsl::p<PlainValue>);
+			auto value = lexy::dsl::no_whitespace(LEXY_LIT("$") >> lexy::dsl::p<ConditionName>);
 
 			return paren | value | lexy::dsl::error<ExpectedConditionalOperand>;
 		}();
@@ -156,101 +271,23 @@ namespace lexy_vdf::grammar {
 
 		using operation = Or;
 
+		// Operands are already evaluated against the interned condition bits by ConditionName.
 		static constexpr auto value =
-			lexy::callback_with_state<bool>(
-				lexy::forward<bool>,
-				[](auto) { return true; },
-				[](Parser::State& state, bool val) { return val; },
-				[](Parser::State& state, std::string&& val) {
-					return state.has_condition(val);
-				},
-				[](Parser::State& state, auto&& lhs, ConditionalType&& type, auto&& rhs) {
-					using left_t = std::decay_t<decltype(lhs)>;
-					using right_t = std::decay_t<decltype(rhs)>;
-					if constexpr (std::is_same_v<left_t, bool>) {
-						if (!lhs && type == ConditionalType::And) return false;
-						if (lhs && type == ConditionalType::Or) return true;
-					}
-					if constexpr (std::is_same_v<right_t, bool>) {
-						if (!rhs && type == ConditionalType::And) return false;
-						if (rhs && type == ConditionalType::Or) return true;
-					}
-					bool result;
-					if constexpr (std::is_same_v<left_t, bool>) {
-						result = lhs;
-					} else {
-						result = state.has_condition(lhs);
-					}
-
-					if constexpr (std::is_same_v<right_t, bool>) {
-						switch (type) {
-							case ConditionalType::And: return result && rhs;
-							case ConditionalType::Or: return result || rhs;
-							default: break;
-						}
-					} else {
-						switch (type) {
-							case ConditionalType::And: return result && state.has_condition(rhs);
-							case ConditionalType::Or: return result || state.has_condition(rhs);
-							default: break;
-						}
-					}
-					return result;
-				},
-				[](auto&& lhs, ConditionalType&& type, auto&& rhs) {
-					using left_t = std::decay_t<decltype(lhs)>;
-					using right_t = std::decay_t<decltype(rhs)>;
-					if constexpr (std::is_same_v<left_t, bool>) {
-						if (!lhs && type == ConditionalType::And) return false;
-						if (lhs && type == ConditionalType::Or) return true;
-					}
-					if constexpr (std::is_same_v<right_t, bool>) {
-						if (!rhs && type == ConditionalType::And) return false;
-						if (rhs && type == ConditionalType::Or) return true;
-					}
-					bool result;
-					if constexpr (std::is_same_v<left_t, bool>) {
-						result = lhs;
-					} else {
-						result = true;
-					}
-
-					if constexpr (std::is_same_v<right_t, bool>) {
-						switch (type) {
-							case ConditionalType::And: return result && rhs;
-							case ConditionalType::Or: return result || rhs;
-							default: break;
-						}
-					} else {
-						switch (type) {
-							case ConditionalType::And: return result && true;
-							case ConditionalType::Or: return result || true;
-							default: break;
-						}
-					}
-					return result;
-				},
-				[](Parser::State& state, ConditionalType&&, auto&& rhs) {
-					using right_t = std::decay_t<decltype(rhs)>;
-					if constexpr (std::is_same_v<right_t, bool>) {
-						return !rhs;
-					} else {
-						return !state.has_condition(rhs);
-					}
+			lexy::callback<detail::Condition>(
+				lexy::forward<detail::Condition>,
+				[](ConditionalType, detail::Condition&& rhs) {
+					rhs.negate();
+					return LEXY_MOV(rhs);
 				},
-				[](ConditionalType&&, auto&& rhs) {
-					using right_t = std::decay_t<decltype(rhs)>;
-					if constexpr (std::is_same_v<right_t, bool>) {
-						return !rhs;
-					} else {
-						return false;
-					}
+				[](detail::Condition&& lhs, ConditionalType type, detail::Condition&& rhs) {
+					lhs.combine(type == ConditionalType::And ? detail::Condition::Op::And : detail::Condition::Op::Or, rhs);
+					return LEXY_MOV(lhs);
 				});
 	};
 
 	struct ConditionalAttribute {
-		static constexpr auto rule = lexy::dsl::square_bracketed(lexy::dsl::p<ConditionalExpression>);
-		static constexpr auto value = lexy::forward<bool>;
+		static constexpr auto rule = LVDF_PROFILED(ConditionalAttribute, lexy::dsl::square_bracketed(lexy::dsl::p<ConditionalExpression>));
+		static constexpr auto value = lexy::forward<detail::Condition>;
 	};
 
 	struct KeyExpression {
@@ -269,28 +306,26 @@ namespace lexy_vdf::grammar {
 	};
 
 	struct KeyValueStatement {
-		static constexpr auto rule = lexy::dsl::p<KeyExpression> >> lexy::dsl::p<ValueExpression> + lexy::dsl::opt(lexy::dsl::p<ConditionalAttribute>);
-		static constexpr auto value = lexy::callback<KeyValues::copy_pair_type>(
-			[](auto&& key, auto&& value, lexy::nullopt = {}) {
-				return KeyValues::copy_pair_type(LEXY_MOV(key), LEXY_MOV(value));
+		// The positions cost two pointers per statement and are only turned into offsets when spans are tracked.
+		static constexpr auto rule = LVDF_PROFILED(KeyValueStatement,
+			lexy::dsl::position(lexy::dsl::p<KeyExpression>) >> lexy::dsl::position + lexy::dsl::p<ValueExpression> + lexy::dsl::opt(lexy::dsl::p<ConditionalAttribute>));
+		static constexpr auto value = lexy::callback<Statement>(
+			[](auto key_position, auto&& key, auto value_position, auto&& value, lexy::nullopt = {}) {
+				return Statement { LEXY_MOV(key), LEXY_MOV(value), std::nullopt, &*key_position, &*value_position };
 			},
-			[](auto&& key, auto&& value, bool conditional) -> KeyValues::copy_pair_type {
-				if (conditional)
-					return KeyValues::copy_pair_type(LEXY_MOV(key), LEXY_MOV(value));
-				return KeyValues::copy_pair_type();
+			[](auto key_position, auto&& key, auto value_position, auto&& value, detail::Condition&& condition) {
+				return Statement { LEXY_MOV(key), LEXY_MOV(value), LEXY_MOV(condition), &*key_position, &*value_position };
 			});
 	};
 
 	struct File {
 		static constexpr auto whitespace = comment_specifier | whitespace_specifier;
-		static constexpr auto rule = lexy::dsl::terminator(lexy::dsl::eof).list(lexy::dsl::p<IncludeStatement> | lexy::dsl::p<KeyValueStatement>);
+		static constexpr auto rule = LVDF_PROFILED(File, lexy::dsl::terminator(lexy::dsl::eof).list(lexy::dsl::p<BaseStatement> | lexy::dsl::p<IncludeStatement> | lexy::dsl::p<KeyValueStatement>));
 		static constexpr auto value =
-			ListValue::value >>
+			ListValue::fold(detail::RecycledTree::Root {}) >>
 			lexy::callback<KeyValues*>(
 				[](KeyValues&& kv) {
-					KeyValues* result = new KeyValues();
-					kv.swap(*result);
-					return result;
+					return detail::RecycledTree::adopt(LEXY_MOV(kv));
 				});
 	};
 }
\ No newline at end of file
@@ -0,0 +1,667 @@
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <lexy-vdf/ConditionSet.hpp>
+#include <lexy-vdf/Json.hpp>
+#include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/Writer.hpp>
+
+#include <lexy/encoding.hpp>
+
+#include "detail/BasicBufferHandler.hpp"
+#include "detail/ConditionEvaluator.hpp"
+#include "detail/DefaultConditions.hpp"
+#include "detail/Errors.hpp"
+#include "detail/ScannedValidation.hpp"
+#include "detail/StatementScanner.hpp"
+#include "detail/Unescape.hpp"
+#include "detail/UnquotedToken.hpp"
+#include "detail/Warnings.hpp"
+
+using namespace lexy_vdf;
+using namespace lexy_vdf::detail;
+
+namespace {
+	constexpr std::size_t flush_size = Writer::default_flush_size;
+
+	std::optional<std::string> load_source(const std::filesystem::path& path, TranscodeResult& result) {
+		BasicBufferHandler<lexy::utf8_char_encoding> buffer_handler;
+		const std::string path_string = path.string();
+		if (auto error = buffer_handler.load_file(path_string.c_str()); error) {
+			result.errors.push_back(error.value());
+			return std::nullopt;
+		}
+		const auto& buffer = buffer_handler.get_buffer();
+		return std::string(buffer.data(), buffer.size());
+	}
+
+	class JsonOutput {
+	public:
+		JsonOutput(Writer::Sink sink, bool pretty) : _sink(std::move(sink)), _pretty(pretty) {
+			if (_sink) _buffer.reserve(flush_size);
+		}
+
+		~JsonOutput() {
+			flush();
+		}
+
+		void open(char c) {
+			_buffer.push_back(c);
+			_depth++;
+			_first = true;
+		}
+
+		void close(char c) {
+			_depth--;
+			if (!_first) newline();
+			_buffer.push_back(c);
+			_first = false;
+		}
+
+		/// Starts the next element of the innermost object or array.
+		void element() {
+			if (!_first) _buffer.push_back(',');
+			newline();
+			_first = false;
+		}
+
+		void key(std::string_view key) {
+			element();
+			string(key);
+			_buffer.append(_pretty ? ": " : ":");
+		}
+
+		void string(std::string_view text) {
+			static constexpr char hex[] = "0123456789abcdef";
+
+			_buffer.push_back('"');
+			const char* run = text.data();
+			const char* end = text.data() + text.size();
+			for (const char* cursor = run; cursor != end; cursor++) {
+				const unsigned char c = static_cast<unsigned char>(*cursor);
+				if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+				_buffer.append(run, cursor);
+				_buffer.push_back('\\');
+				switch (c) {
+					case '"': _buffer.push_back('"'); break;
+					case '\\': _buffer.push_back('\\'); break;
+					case '\b': _buffer.push_back('b'); break;
+					case '\f': _buffer.push_back('f'); break;
+					case '\n': _buffer.push_back('n'); break;
+					case '\r': _buffer.push_back('r'); break;
+					case '\t': _buffer.push_back('t'); break;
+					default:
+						_buffer.append("u00");
+						_buffer.push_back(hex[c >> 4]);
+						_buffer.push_back(hex[c & 0xF]);
+						break;
+				}
+				run = cursor + 1;
+			}
+			_buffer.append(run, end);
+			_buffer.push_back('"');
+		}
+
+		void integer(std::int32_t value) {
+			char digits[16];
+			const auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+			_buffer.append(digits, end);
+		}
+
+		void real(std::float_t value) {
+			char digits[64];
+			const auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+			const std::string_view text(digits, static_cast<std::size_t>(end - digits));
+			if (!std::isfinite(value)) {
+				string(text);
+				return;
+			}
+			_buffer.append(text);
+			if (text.find_first_of(".e") == std::string_view::npos) _buffer.append(".0");
+		}
+
+		void finish() {
+			if (_pretty) _buffer.push_back('\n');
+		}
+
+		void maybe_flush() {
+			if (_sink && _buffer.size() >= flush_size) flush();
+		}
+
+		void flush() {
+			if (!_sink || _buffer.empty()) return;
+			_sink(_buffer);
+			_buffer.clear();
+		}
+
+		std::string take() {
+			return std::move(_buffer);
+		}
+
+	private:
+		std::string _buffer;
+		Writer::Sink _sink;
+		bool _pretty;
+		bool _first = true;
+		std::size_t _depth = 0;
+
+		void newline() {
+			if (!_pretty) return;
+			_buffer.push_back('\n');
+			_buffer.append(_depth, '\t');
+		}
+	};
+
+	class VdfToJson {
+	public:
+		VdfToJson(JsonOutput& output, const JsonOptions& options, TranscodeResult& result) : _output(output), _result(result) {
+			if (options.use_default_conditions) {
+				for (std::string_view condition : default_conditions) {
+					_conditions.add(condition);
+				}
+			}
+			for (const std::string& condition : options.conditions) {
+				_conditions.add(condition);
+			}
+		}
+
+		bool document(std::string_view source) {
+			_output.open('{');
+			const bool success = block(source, source, 0);
+			_output.close('}');
+			_output.finish();
+			return success;
+		}
+
+	private:
+		struct Entry {
+			std::string_view key;
+			ScannedToken value;
+			std::string_view source;
+		};
+
+		/// Scratch storage of one nesting depth, reused by every block at that depth.
+		struct Level {
+			std::vector<Entry> entries;
+			std::vector<std::vector<std::size_t>> groups;
+			std::unordered_map<std::string_view, std::size_t> group_of;
+			std::deque<std::string> decoded_keys;
+			std::size_t group_count;
+		};
+
+		JsonOutput& _output;
+		TranscodeResult& _result;
+		ConditionSet _conditions;
+		std::deque<Level> _levels;
+		std::deque<std::string> _included_sources;
+		std::string _scratch;
+
+		bool block(std::string_view range, std::string_view source, std::size_t depth) {
+			if (_levels.size() == depth) _levels.emplace_back();
+			Level& level = _levels[depth];
+			level.entries.clear();
+			level.group_of.clear();
+			level.decoded_keys.clear();
+			level.group_count = 0;
+
+			if (!collect(range, source, level)) return false;
+
+			for (std::size_t group = 0; group < level.group_count; group++) {
+				const std::vector<std::size_t>& members = level.groups[group];
+				_output.key(level.entries[members.front()].key);
+				if (members.size() == 1) {
+					if (!value(level.entries[members.front()], depth)) return false;
+					continue;
+				}
+
+				_output.open('[');
+				for (std::size_t index : members) {
+					_output.element();
+					if (!value(level.entries[index], depth)) return false;
+				}
+				_output.close(']');
+			}
+			return true;
+		}
+
+		/// Gathers the statements of a block, grouped by key in order of first appearance.
+		bool collect(std::string_view range, std::string_view source, Level& level) {
+			using Status = StatementScanner::Status;
+
+			StatementScanner scanner(range);
+			StatementScanner::Statement statement;
+			Status status;
+			while ((status = scanner.next(statement)) == Status::Ok) {
+				if (statement.is_include()) {
+					if (!include(statement, source, level)) return false;
+					continue;
+				}
+				if (!is_valid_key(statement.key)) return malformed(source, statement.key.begin);
+
+				if (statement.has_condition) {
+					std::optional<bool> enabled = evaluate(statement.condition);
+					if (!enabled) return malformed(source, statement.condition.begin);
+					// The grammar parses what a condition drops all the same
+					if (!*enabled) {
+						if (!validate_value(statement.value, source)) return false;
+						continue;
+					}
+				}
+
+				std::string_view key = statement.key.text();
+				if (statement.key.kind == ScannedToken::Kind::String) {
+					key = statement.key.string_body();
+					if (key.find('\\') != std::string_view::npos) {
+						std::string& decoded = level.decoded_keys.emplace_back();
+						if (!unescape_append(key, decoded)) return malformed(source, statement.key.begin);
+						key = decoded;
+					}
+				}
+
+				auto [found, inserted] = level.group_of.try_emplace(key, level.group_count);
+				if (inserted) {
+					if (level.groups.size() == level.group_count) level.groups.emplace_back();
+					level.groups[level.group_count++].clear();
+				}
+				level.groups[found->second].push_back(level.entries.size());
+				level.entries.push_back({ key, statement.value, source });
+			}
+
+			if (status != Status::End || !scanner.at_end()) return malformed(source, scanner.position());
+			return true;
+		}
+
+		bool validate_value(const ScannedToken& value, std::string_view source) {
+			const char* malformed_at = find_malformed_value(value);
+			return !malformed_at || malformed(source, malformed_at);
+		}
+
+		std::optional<bool> evaluate(const ScannedToken& condition) const {
+			auto has_condition = [this](std::string_view name) {
+				return _conditions.contains(name);
+			};
+			return ConditionEvaluator(condition.text(), has_condition).evaluate();
+		}
+
+		/// Included statements join the block they are included into, like KeyValues::MergeWith.
+		bool include(const StatementScanner::Statement& statement, std::string_view source, Level& level) {
+			std::string file;
+			if (!is_valid_string_body(statement.value.string_body()) || !unescape_append(statement.value.string_body(), file)) {
+				return malformed(source, statement.value.begin);
+			}
+
+			TranscodeResult included;
+			std::optional<std::string> included_source = load_source(file, included);
+			if (!included_source) {
+				_result.warnings.push_back(warnings::merge_check(file, KeyValues::MergeError::FileMissing).value());
+				return true;
+			}
+
+			const std::string_view stored = _included_sources.emplace_back(std::move(*included_source));
+			const std::size_t error_count = _result.errors.size();
+			if (!collect(stored, stored, level)) {
+				while (_result.errors.size() > error_count) {
+					_result.errors.pop_back();
+				}
+				_result.warnings.push_back(warnings::merge_check(file, KeyValues::MergeError::ParseFail).value());
+			}
+			return true;
+		}
+
+		bool value(const Entry& entry, std::size_t depth) {
+			switch (entry.value.kind) {
+				case ScannedToken::Kind::OpenBrace: {
+					_output.open('{');
+					const std::string_view body(entry.value.begin + 1, static_cast<std::size_t>(entry.value.end - entry.value.begin - 2));
+					if (!block(body, entry.source, depth + 1)) return false;
+					_output.close('}');
+					break;
+				}
+				case ScannedToken::Kind::String:
+					_scratch.clear();
+					if (!is_valid_string_body(entry.value.string_body()) || !unescape_append(entry.value.string_body(), _scratch)) {
+						return malformed(entry.source, entry.value.begin);
+					}
+					_output.string(_scratch);
+					break;
+				default: {
+					// A word the grammar splits into several tokens shifts every statement after it, so it is rejected
+					const UnquotedToken token = match_unquoted(entry.value.text());
+					if (!token.covers(entry.value.text())) return malformed(entry.source, entry.value.begin);
+					switch (token.kind) {
+						case UnquotedToken::Kind::Integer: _output.integer(token.int_value); break;
+						case UnquotedToken::Kind::Float: _output.real(token.float_value); break;
+						default: _output.string(entry.value.text()); break;
+					}
+					break;
+				}
+			}
+			_output.maybe_flush();
+			return true;
+		}
+
+		bool malformed(std::string_view source, const char* position) {
+			_result.errors.push_back(errors::make_malformed_error(source, position, "VDF"));
+			return false;
+		}
+	};
+
+	class JsonToVdf {
+	public:
+		JsonToVdf(std::string_view source, Writer& writer, TranscodeResult& result)
+			: _source(source),
+			  _cursor(source.data()),
+			  _end(source.data() + source.size()),
+			  _writer(writer),
+			  _result(result) {}
+
+		bool document() {
+			skip_space();
+			if (!consume('{') || !members(0)) return malformed();
+			skip_space();
+			if (_cursor != _end) return malformed();
+			return true;
+		}
+
+	private:
+		std::string_view _source;
+		const char* _cursor;
+		const char* _end;
+		Writer& _writer;
+		TranscodeResult& _result;
+		/// Key of each nesting depth, kept while an array repeats it.
+		std::deque<std::string> _keys;
+		std::string _scratch;
+		/// Set when the document failed on a string the Writer would refuse, _cursor is left at its opening quote.
+		bool _unwritable = false;
+
+		bool members(std::size_t depth) {
+			if (_keys.size() == depth) _keys.emplace_back();
+			std::string& key = _keys[depth];
+
+			skip_space();
+			if (consume('}')) return true;
+			while (true) {
+				skip_space();
+				key.clear();
+				const char* key_begin = _cursor;
+				if (!consume('"') || !string(key)) return false;
+				if (!Writer::can_write(key)) return unwritable(key_begin);
+				skip_space();
+				if (!consume(':')) return false;
+				skip_space();
+				if (!member(key, depth, false)) return false;
+
+				skip_space();
+				if (consume('}')) return true;
+				if (!consume(',')) return false;
+			}
+		}
+
+		bool member(const std::string& key, std::size_t depth, bool in_array) {
+			if (_cursor == _end) return false;
+			switch (*_cursor) {
+				case '{':
+					_cursor++;
+					_writer.begin_block(key);
+					if (!members(depth + 1)) return false;
+					_writer.end_block();
+					return true;
+				case '[':
+					// VDF repeats the key instead, which cannot express an array inside an array.
+					if (in_array) return false;
+					_cursor++;
+					skip_space();
+					if (consume(']')) return true;
+					while (true) {
+						skip_space();
+						if (!member(key, depth, true)) return false;
+						skip_space();
+						if (consume(']')) return true;
+						if (!consume(',')) return false;
+					}
+				case '"': {
+					const char* value_begin = _cursor++;
+					ValueType value { std::move(_scratch) };
+					std::string& text = std::get<std::string>(value);
+					text.clear();
+					bool success = string(text);
+					if (success && !Writer::can_write(text)) success = unwritable(value_begin);
+					if (success) _writer.write(key, value);
+					_scratch = std::move(text);
+					return success;
+				}
+				case 't':
+					if (!literal("true")) return false;
+					_writer.write(key, std::int32_t { 1 });
+					return true;
+				case 'f':
+					if (!literal("false")) return false;
+					_writer.write(key, std::int32_t { 0 });
+					return true;
+				case 'n': return literal("null");
+				default: return number(key);
+			}
+		}
+
+		/// Integers that don't fit an int are written as floats like any other number with a fraction or exponent.
+		bool number(const std::string& key) {
+			const char* begin = _cursor;
+			if (!skip_number()) return false;
+			const std::string_view text(begin, static_cast<std::size_t>(_cursor - begin));
+
+			if (text.find_first_of(".eE") == std::string_view::npos) {
+				std::int32_t integer;
+				auto [pointer, error] = std::from_chars(begin, _cursor, integer);
+				if (error == std::errc {} && pointer == _cursor) {
+					_writer.write(key, integer);
+					return true;
+				}
+			}
+
+			double real;
+			auto [pointer, error] = std::from_chars(begin, _cursor, real);
+			if (pointer != _cursor || (error != std::errc {} && error != std::errc::result_out_of_range)) return false;
+			_writer.write(key, static_cast<std::float_t>(real));
+			return true;
+		}
+
+		/// Advances over a number in JSON's syntax, which has no leading '+' or zeros and needs digits around the point.
+		bool skip_number() {
+			auto digits = [this] {
+				const char* begin = _cursor;
+				while (_cursor != _end && *_cursor >= '0' && *_cursor <= '9') {
+					_cursor++;
+				}
+				return _cursor != begin;
+			};
+
+			consume('-');
+			if (!consume('0') && !digits()) return false;
+			if (consume('.') && !digits()) return false;
+			if (_cursor != _end && (*_cursor == 'e' || *_cursor == 'E')) {
+				_cursor++;
+				if (!consume('+')) consume('-');
+				if (!digits()) return false;
+			}
+			return true;
+		}
+
+		/// Decodes a JSON string whose opening quote was consumed.
+		bool string(std::string& out) {
+			while (_cursor != _end) {
+				const char* run = _cursor;
+				while (_cursor != _end && *_cursor != '"' && *_cursor != '\\') {
+					_cursor++;
+				}
+				out.append(run, _cursor);
+				if (_cursor == _end) return false;
+				if (*_cursor++ == '"') return true;
+				if (_cursor == _end) return false;
+
+				const char escape = *_cursor++;
+				switch (escape) {
+					case '"':
+					case '\\':
+					case '/': out.push_back(escape); break;
+					case 'b': out.push_back('\b'); break;
+					case 'f': out.push_back('\f'); break;
+					case 'n': out.push_back('\n'); break;
+					case 'r': out.push_back('\r'); break;
+					case 't': out.push_back('\t'); break;
+					case 'u': {
+						std::optional<std::uint32_t> code_point = unicode_escape();
+						if (!code_point) return false;
+						append_utf8(*code_point, out);
+						break;
+					}
+					default: return false;
+				}
+			}
+			return false;
+		}
+
+		std::optional<std::uint32_t> hex4() {
+			if (_end - _cursor < 4) return std::nullopt;
+			std::uint32_t value;
+			auto [pointer, error] = std::from_chars(_cursor, _cursor + 4, value, 16);
+			if (error != std::errc {} || pointer != _cursor + 4) return std::nullopt;
+			_cursor += 4;
+			return value;
+		}
+
+		/// Reads the digits of a \u escape, joining a surrogate pair into one code point.
+		std::optional<std::uint32_t> unicode_escape() {
+			std::optional<std::uint32_t> high = hex4();
+			if (!high || (*high >= 0xDC00 && *high <= 0xDFFF)) return std::nullopt;
+			if (*high < 0xD800 || *high > 0xDBFF) return high;
+
+			if (_end - _cursor < 2 || _cursor[0] != '\\' || _cursor[1] != 'u') return std::nullopt;
+			_cursor += 2;
+			std::optional<std::uint32_t> low = hex4();
+			if (!low || *low < 0xDC00 || *low > 0xDFFF) return std::nullopt;
+			return 0x10000 + ((*high - 0xD800) << 10) + (*low - 0xDC00);
+		}
+
+		static void append_utf8(std::uint32_t code_point, std::string& out) {
+			if (code_point < 0x80) {
+				out.push_back(static_cast<char>(code_point));
+			} else if (code_point < 0x800) {
+				out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+				out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+			} else if (code_point < 0x10000) {
+				out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+				out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+				out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+			} else {
+				out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+				out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+				out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+				out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+			}
+		}
+
+		bool literal(std::string_view text) {
+			if (std::string_view(_cursor, static_cast<std::size_t>(_end - _cursor)).substr(0, text.size()) != text) return false;
+			_cursor += text.size();
+			return true;
+		}
+
+		bool consume(char c) {
+			if (_cursor == _end || *_cursor != c) return false;
+			_cursor++;
+			return true;
+		}
+
+		void skip_space() {
+			while (_cursor != _end && (*_cursor == ' ' || *_cursor == '\t' || *_cursor == '\n' || *_cursor == '\r')) {
+				_cursor++;
+			}
+		}
+
+		/// Control characters other than the escaped ones, and malformed UTF-8, have no VDF form.
+		bool unwritable(const char* string_begin) {
+			_cursor = string_begin;
+			_unwritable = true;
+			return false;
+		}
+
+		bool malformed() {
+			if (_unwritable) {
+				_result.errors.push_back(errors::make_malformed_error(_source, _cursor, "JSON", "string can not be written as VDF"));
+			} else {
+				_result.errors.push_back(errors::make_malformed_error(_source, _cursor, "JSON"));
+			}
+			return false;
+		}
+	};
+
+	TranscodeResult transcode_to_json(std::string_view vdf, JsonOutput& output, const JsonOptions& options) {
+		TranscodeResult result;
+		VdfToJson(output, options, result).document(vdf);
+		return result;
+	}
+
+	TranscodeResult transcode_to_vdf(std::string_view json, Writer& writer) {
+		TranscodeResult result;
+		JsonToVdf(json, writer, result).document();
+		return result;
+	}
+
+	Writer::Sink stream_sink(std::ostream& stream) {
+		return [&stream](std::string_view chunk) {
+			stream.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+		};
+	}
+}
+
+TranscodeResult lexy_vdf::vdf_to_json(std::string_view p_vdf, std::string& p_out, const JsonOptions& p_options) {
+	JsonOutput output({}, p_options.pretty);
+	TranscodeResult result = transcode_to_json(p_vdf, output, p_options);
+	p_out = output.take();
+	return result;
+}
+
+TranscodeResult lexy_vdf::vdf_to_json(std::string_view p_vdf, std::ostream& p_out, const JsonOptions& p_options) {
+	JsonOutput output(stream_sink(p_out), p_options.pretty);
+	return transcode_to_json(p_vdf, output, p_options);
+}
+
+TranscodeResult lexy_vdf::vdf_file_to_json(const std::filesystem::path& p_path, std::ostream& p_out, const JsonOptions& p_options) {
+	TranscodeResult result;
+	std::optional<std::string> source = load_source(p_path, result);
+	if (!source) return result;
+	return vdf_to_json(*source, p_out, p_options);
+}
+
+TranscodeResult lexy_vdf::json_to_vdf(std::string_view p_json, std::string& p_out, Writer::Style p_style) {
+	Writer writer(p_style);
+	TranscodeResult result = transcode_to_vdf(p_json, writer);
+	p_out = writer.take();
+	return result;
+}
+
+TranscodeResult lexy_vdf::json_to_vdf(std::string_view p_json, std::ostream& p_out, Writer::Style p_style) {
+	Writer writer(stream_sink(p_out), p_style);
+	return transcode_to_vdf(p_json, writer);
+}
+
+TranscodeResult lexy_vdf::json_file_to_vdf(const std::filesystem::path& p_path, std::ostream& p_out, Writer::Style p_style) {
+	TranscodeResult result;
+	std::optional<std::string> source = load_source(p_path, result);
+	if (!source) return result;
+	return json_to_vdf(*source, p_out, p_style);
+}
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include <lexy-vdf/KeyIndex.hpp>
+#include <lexy-vdf/KeyValues.hpp>
+
+using namespace lexy_vdf;
+
+KeyIndex::KeyIndex(const KeyValues& p_root, bool p_index_string_values) : _index_string_values(p_index_string_values) {
+	rebuild(p_root);
+}
+
+void KeyIndex::rebuild(const KeyValues& p_root) {
+	_root = &p_root;
+	_reindex();
+}
+
+std::size_t KeyIndex::size() const {
+	_refresh();
+	return _entry_nodes.size();
+}
+
+std::vector<KeyIndex::Hit> KeyIndex::find_key(KeyObserverType p_key) const {
+	_refresh();
+	return _live(_keys, p_key);
+}
+
+std::vector<KeyIndex::Hit> KeyIndex::find_value(std::string_view p_value) const {
+	_refresh();
+	return _live(_values, p_value);
+}
+
+///
+/// @brief Entries under p_key holding the string p_value
+///
+/// Walks the shorter of the two posting lists and checks the other side on the entry itself.
+///
+std::vector<KeyIndex::Hit> KeyIndex::find(KeyObserverType p_key, std::string_view p_value) const {
+	_refresh();
+	PostingMap::const_iterator keys = _keys.find(p_key);
+	if (keys == _keys.end()) return {};
+
+	PostingMap::const_iterator values = _index_string_values ? _values.find(p_value) : _values.end();
+	if (_index_string_values && values == _values.end()) return {};
+
+	const bool by_value = values != _values.end() && values->second.size() < keys->second.size();
+	std::vector<Hit> hits;
+	for (NodeId id : by_value ? values->second : keys->second) {
+		const KeyValues::value_type* entry = _nodes[id].entry;
+		if (!entry || entry->first != p_key) continue;
+		const std::string* value = std::get_if<std::string>(&entry->second);
+		if (value && *value == p_value) hits.push_back({ entry, id, _generation });
+	}
+	return hits;
+}
+
+const KeyValues* KeyIndex::block_of(const Hit& p_hit) const {
+	if (!_is_live(p_hit)) return nullptr;
+	const NodeId parent = _nodes[p_hit.node].parent;
+	if (parent == no_node) return _root;
+	return std::get_if<KeyValues>(&_nodes[parent].entry->second);
+}
+
+std::vector<KeyType> KeyIndex::path_of(const Hit& p_hit) const {
+	std::vector<KeyType> path;
+	if (!_is_live(p_hit)) return path;
+	for (NodeId id = p_hit.node; id != no_node; id = _nodes[id].parent) {
+		path.push_back(_nodes[id].entry->first);
+	}
+	std::reverse(path.begin(), path.end());
+	return path;
+}
+
+///
+/// @brief Applies p_patch to p_root, dropping the entries it replaces and indexing the ones it adds
+///
+/// Removed entries leave dead ids in the posting lists which lookups skip, the index is rebuilt
+/// once they outnumber the live ones. A patch that fails part way, or a root other than the
+/// indexed one, also rebuilds the index, as does an entry replacing the whole tree.
+///
+KeyValues::PatchError KeyIndex::apply_patch(KeyValues& p_root, const Patch& p_patch) {
+	const bool replaces_root = std::any_of(p_patch.begin(), p_patch.end(), [](const PatchEntry& entry) {
+		return entry.path.empty();
+	});
+	if (&p_root != _root || replaces_root || p_root.modification_count() != _modifications) {
+		const KeyValues::PatchError result = p_root.apply_patch(p_patch);
+		rebuild(p_root);
+		return result;
+	}
+
+	NodeId parent;
+	for (const PatchEntry& entry : p_patch) {
+		if (const KeyValues::value_type* current = _locate(entry.path, parent)) _remove_entry(*current);
+	}
+
+	const KeyValues::PatchError result = p_root.apply_patch(p_patch);
+	if (result != KeyValues::PatchError::Success) {
+		rebuild(p_root);
+		return result;
+	}
+
+	for (const PatchEntry& entry : p_patch) {
+		const KeyValues::value_type* current = _locate(entry.path, parent);
+		if (!current || _entry_nodes.contains(current)) continue;
+		// The parent was itself replaced by an earlier entry of the patch and indexed with its contents
+		if (parent == no_node && entry.path.size() > 1) {
+			rebuild(p_root);
+			return result;
+		}
+		_index_entry(*current, parent);
+	}
+
+	if (_nodes.size() > 2 * _entry_nodes.size() + 64) {
+		rebuild(p_root);
+	} else {
+		_modifications = p_root.modification_count();
+	}
+	return result;
+}
+
+void KeyIndex::_refresh() const {
+	if (_root && _root->modification_count() != _modifications) _reindex();
+}
+
+///
+/// @brief Indexes _root from scratch, hits found before are stale from here on
+///
+void KeyIndex::_reindex() const {
+	_modifications = _root->modification_count();
+	_generation++;
+	_nodes.clear();
+	_entry_nodes.clear();
+	_keys.clear();
+	_values.clear();
+	_index_block(*_root, no_node);
+}
+
+void KeyIndex::_index_block(const KeyValues& block, NodeId parent) const {
+	for (const KeyValues::value_type& entry : block) {
+		_index_entry(entry, parent);
+	}
+}
+
+void KeyIndex::_index_entry(const KeyValues::value_type& entry, NodeId parent) const {
+	const NodeId id = static_cast<NodeId>(_nodes.size());
+	_nodes.push_back({ &entry, parent });
+	_entry_nodes[&entry] = id;
+	_keys[entry.first].push_back(id);
+
+	if (_index_string_values) {
+		if (const std::string* value = std::get_if<std::string>(&entry.second)) _values[*value].push_back(id);
+	}
+	if (const KeyValues* block = std::get_if<KeyValues>(&entry.second)) _index_block(*block, id);
+}
+
+void KeyIndex::_remove_entry(const KeyValues::value_type& entry) {
+	auto found = _entry_nodes.find(&entry);
+	if (found == _entry_nodes.end()) return;
+	_nodes[found->second].entry = nullptr;
+	_entry_nodes.erase(found);
+
+	if (const KeyValues* block = std::get_if<KeyValues>(&entry.second)) {
+		for (const KeyValues::value_type& child : *block) {
+			_remove_entry(child);
+		}
+	}
+}
+
+///
+/// @brief Finds the entry at path in the indexed root and the node of the block holding it
+///
+/// parent is no_node for top level entries, and for entries whose parent is not indexed.
+///
+const KeyValues::value_type* KeyIndex::_locate(const std::vector<KeyType>& path, NodeId& parent) const {
+	parent = no_node;
+	if (path.empty()) return nullptr;
+
+	const KeyValues* block = _root;
+	for (std::size_t index = 0; index < path.size(); index++) {
+		if (!block) return nullptr;
+		KeyValues::const_iterator found = block->find(path[index]);
+		if (found == block->end()) return nullptr;
+		if (index + 1 == path.size()) return &*found;
+
+		block = std::get_if<KeyValues>(&found->second);
+		auto node = _entry_nodes.find(&*found);
+		parent = node == _entry_nodes.end() ? no_node : node->second;
+	}
+	return nullptr;
+}
+
+bool KeyIndex::_is_live(const Hit& hit) const {
+	_refresh();
+	return hit.generation == _generation && hit.node < _nodes.size() && _nodes[hit.node].entry == hit.entry;
+}
+
+std::vector<KeyIndex::Hit> KeyIndex::_live(const PostingMap& postings, std::string_view key) const {
+	PostingMap::const_iterator found = postings.find(key);
+	if (found == postings.end()) return {};
+
+	std::vector<Hit> hits;
+	hits.reserve(found->second.size());
+	for (NodeId id : found->second) {
+		if (const KeyValues::value_type* entry = _nodes[id].entry) hits.push_back({ entry, id, _generation });
+	}
+	return hits;
+}
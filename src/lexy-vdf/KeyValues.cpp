@@ -1,13 +1,21 @@
+#include <cstddef>
 #include <cstdint>
+#include <filesystem>
 #include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <type_traits>
+#include <utility>
 #include <variant>
+#include <vector>
 
+#include <lexy-vdf/Diagnostics.hpp>
 #include <lexy-vdf/KeyValues.hpp>
 #include <lexy-vdf/Parser.hpp>
+#include <lexy-vdf/ParserPool.hpp>
+
+#include "detail/IncludeCache.hpp"
 
 using namespace lexy_vdf;
 
@@ -38,53 +46,170 @@ bool insenitive_trim_eq(std::string_view lhs, std::string_view rhs) {
 KeyValues::KeyValues(std::initializer_list<value_type> list) : base_type(list) {
 }
 
+KeyValues& KeyValues::operator=(KeyValues& p_other) {
+	return *this = static_cast<const KeyValues&>(p_other);
+}
+
+KeyValues& KeyValues::operator=(const KeyValues& p_other) {
+	base_type::operator=(p_other);
+	_conditionals = p_other._conditionals;
+	mark_modified();
+	return *this;
+}
+
+KeyValues& KeyValues::operator=(KeyValues&& p_other) {
+	base_type::operator=(std::move(static_cast<base_type&>(p_other)));
+	_conditionals = std::move(p_other._conditionals);
+	mark_modified();
+	return *this;
+}
+
 std::unique_ptr<KeyValues> KeyValues::from_buffer(const char* data, std::size_t size) {
-	Parser parser = Parser::from_buffer(data, size);
-	if (parser.has_error()) return nullptr;
-	return std::unique_ptr<KeyValues>(parser.release_key_values());
+	ParserPool::Lease parser = ParserPool::local().acquire();
+	if (!parser->reparse(data, size)) return nullptr;
+	return std::unique_ptr<KeyValues>(parser->release_key_values());
 }
 
 std::unique_ptr<KeyValues> KeyValues::from_buffer(const char* start, const char* end) {
-	Parser parser = Parser::from_buffer(start, end);
-	if (parser.has_error()) return nullptr;
-	return std::unique_ptr<KeyValues>(parser.release_key_values());
+	return from_buffer(start, static_cast<std::size_t>(end - start));
 }
 
 std::unique_ptr<KeyValues> KeyValues::from_string(const std::string_view string) {
-	Parser parser = Parser::from_string(string);
-	if (parser.has_error()) return nullptr;
-	return std::unique_ptr<KeyValues>(parser.release_key_values());
+	return from_buffer(string.data(), string.size());
 }
 
 std::unique_ptr<KeyValues> KeyValues::from_file(std::string_view path) {
-	Parser parser = Parser::from_file(path);
-	if (parser.has_error()) return nullptr;
-	return std::unique_ptr<KeyValues>(parser.release_key_values());
+	return from_file(std::filesystem::path(path));
 }
 
 std::unique_ptr<KeyValues> KeyValues::from_file(const std::filesystem::path& path) {
-	Parser parser = Parser::from_file(path);
-	if (parser.has_error()) return nullptr;
-	return std::unique_ptr<KeyValues>(parser.release_key_values());
+	ParserPool::Lease parser = ParserPool::local().acquire();
+	parser->load_from_file(path);
+	if (parser->has_error() || !parser->parse()) return nullptr;
+	return std::unique_ptr<KeyValues>(parser->release_key_values());
+}
+
+namespace {
+	///
+	/// @brief Parses an included file, the parse prefetched by detail::IncludeCache if there is one
+	///
+	KeyValues::MergeError load_include(const std::filesystem::path& path, std::unique_ptr<KeyValues>& out) {
+		if (detail::IncludeCache::is_active()) {
+			if (Parser* prefetched = detail::IncludeCache::find(path.string())) {
+				if (prefetched->has_error()) return KeyValues::MergeError::FileMissing;
+				prefetched->set_diagnostic_sink(DiagnosticSink::current());
+				if (!prefetched->parse()) return KeyValues::MergeError::ParseFail;
+				out.reset(prefetched->release_key_values());
+				return KeyValues::MergeError::Success;
+			}
+		}
+
+		// Inside a parse reporting to a sink, the include's diagnostics go there rather than to stderr
+		ParserPool::Lease parser = ParserPool::local().acquire();
+		parser->set_diagnostic_sink(DiagnosticSink::current());
+		parser->load_from_file(path);
+		if (parser->has_error()) return KeyValues::MergeError::FileMissing;
+		if (!parser->parse()) return KeyValues::MergeError::ParseFail;
+		out.reset(parser->release_key_values());
+		return KeyValues::MergeError::Success;
+	}
 }
 
+///
+/// @brief Parses the file at p_path and appends its top level entries this tree lacks
+///
+/// Entries already present are kept whole, so a block of the file doesn't fill in the one of
+/// this tree, see merge_base for that.
+///
 KeyValues::MergeError KeyValues::MergeWith(const std::filesystem::path& p_path) {
-	Parser parser;
-	parser.load_from_file(p_path);
-	if (parser.has_error()) return MergeError::FileMissing;
-	if (!parser.parse()) return MergeError::ParseFail;
-	AppendKeyValues(*parser.get_key_values());
+	std::unique_ptr<KeyValues> included;
+	const MergeError error = load_include(p_path, included);
+	if (error != MergeError::Success) return error;
+	AppendKeyValues(*included);
+	return MergeError::Success;
+}
+
+///
+/// @brief Parses the file at p_path and deep merges it into this tree as a base
+///
+/// The parsed tree is released from its parser and moved in, so only the keys both trees hold
+/// are merged entry by entry.
+///
+KeyValues::MergeError KeyValues::merge_base(const std::filesystem::path& p_path, MergePolicy p_policy) {
+	std::unique_ptr<KeyValues> base;
+	const MergeError error = load_include(p_path, base);
+	if (error != MergeError::Success) return error;
+	deep_merge(std::move(*base), p_policy);
 	return MergeError::Success;
 }
 
+///
+/// @brief Adds the top level entries of p_key_values whose key this tree lacks
+///
+/// Conditional entries of p_key_values are appended after this tree's own unless this tree holds
+/// a plain entry of their key, checked before the plain entries are added so that a conditional
+/// entry overriding a plain one of p_key_values still does after the append.
+///
 KeyValues& KeyValues::AppendKeyValues(const KeyValues& p_key_values) {
-	reserve(p_key_values.size());
+	if (this == &p_key_values) return *this;
+	mark_modified();
+
+	for (const ConditionalEntry& entry : p_key_values._conditionals) {
+		if (!contains(entry.key)) _conditionals.push_back(entry);
+	}
+
+	reserve(size() + p_key_values.size());
 	for (const auto& value : p_key_values) {
 		emplace(value);
 	}
 	return *this;
 }
 
+bool lexy_vdf::operator==(const KeyValues& p_lhs, const KeyValues& p_rhs) {
+	return static_cast<const KeyValues::base_type&>(p_lhs) == static_cast<const KeyValues::base_type&>(p_rhs) &&
+		   p_lhs._conditionals == p_rhs._conditionals;
+}
+
+void KeyValues::clear() {
+	base_type::clear();
+	_conditionals.clear();
+	mark_modified();
+}
+
+const std::vector<ConditionalEntry>& KeyValues::conditionals() const {
+	return _conditionals;
+}
+
+void KeyValues::add_conditional(KeyType p_key, ValueType p_value, ConditionPredicate p_predicate) {
+	mark_modified();
+	_conditionals.push_back({ std::move(p_key), std::move(p_value), std::move(p_predicate) });
+}
+
+///
+/// @brief Copies the tree, keeping the conditional entries whose predicate holds under p_conditions
+///
+/// Conditional entries are only kept while no plain entry of the same key precedes them, so an
+/// entry that holds replaces the plain one, and the first that holds wins like during parsing.
+///
+KeyValues KeyValues::resolve(const ConditionSet& p_conditions) const {
+	auto resolve_value = [&p_conditions](const ValueType& value) -> ValueType {
+		if (const KeyValues* block = std::get_if<KeyValues>(&value)) return block->resolve(p_conditions);
+		return value;
+	};
+
+	KeyValues result;
+	result.reserve(size() + _conditionals.size());
+	for (const ConditionalEntry& entry : _conditionals) {
+		if (!entry.predicate.evaluate(p_conditions)) continue;
+		result.emplace(entry.key, resolve_value(entry.value));
+	}
+	for (const auto& [key, value] : *this) {
+		if (result.contains(key)) continue;
+		result.emplace(key, resolve_value(value));
+	}
+	return result;
+}
+
 std::int32_t KeyValues::GetInt(KeyObserverType p_key, std::int32_t p_default_value) const {
 	const_iterator value = find(p_key);
 	const std::int32_t* result = std::get_if<std::int32_t>(&(value->second));
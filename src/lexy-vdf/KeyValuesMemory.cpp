@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <variant>
+
+#include <lexy-vdf/ConditionSet.hpp>
+#include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/MemoryUsage.hpp>
+
+#include "detail/MemoryEstimate.hpp"
+
+using namespace lexy_vdf;
+
+namespace {
+	std::atomic<std::size_t> allocations { 0 };
+	std::atomic<std::size_t> deallocations { 0 };
+	std::atomic<std::size_t> bytes_allocated { 0 };
+	std::atomic<std::size_t> bytes_in_use { 0 };
+	std::atomic<std::size_t> peak_bytes_in_use { 0 };
+
+	void count_string(const std::string& string, std::size_t& bytes, MemoryUsage& usage) {
+		const std::size_t heap = detail::string_heap_bytes(string);
+		bytes += heap;
+		usage.allocations += heap != 0;
+	}
+
+	void count_value(const ValueType& value, MemoryUsage& usage, std::size_t& string_bytes) {
+		if (const std::string* string = std::get_if<std::string>(&value)) {
+			count_string(*string, string_bytes, usage);
+		} else if (const KeyValues* block = std::get_if<KeyValues>(&value)) {
+			usage += block->memory_usage();
+		}
+	}
+}
+
+///
+/// @brief Estimates the heap memory held by this tree
+///
+/// The standard containers do not expose their allocations, so node and bucket sizes follow the
+/// common node based layout and strings are counted by capacity. The KeyValues object itself is
+/// not included as it usually lives inside its parent's node. For exact numbers route allocations
+/// through AllocationCounter.
+///
+MemoryUsage KeyValues::memory_usage() const {
+	MemoryUsage usage;
+	usage.maps = 1;
+	usage.nodes = size();
+	usage.node_bytes = size() * detail::unordered_node_bytes<base_type>();
+	usage.bucket_bytes = detail::unordered_bucket_bytes(*this);
+	usage.allocations = size() + (usage.bucket_bytes != 0);
+
+	for (const auto& [key, value] : *this) {
+		count_string(key, usage.key_bytes, usage);
+		count_value(value, usage, usage.string_value_bytes);
+	}
+
+	if (_conditionals.capacity() != 0) {
+		usage.conditional_bytes += _conditionals.capacity() * sizeof(ConditionalEntry);
+		usage.allocations++;
+	}
+	for (const ConditionalEntry& entry : _conditionals) {
+		count_string(entry.key, usage.key_bytes, usage);
+		count_value(entry.value, usage, usage.string_value_bytes);
+
+		const ConditionPredicate& predicate = entry.predicate;
+		usage.conditional_bytes += predicate.program().size() * sizeof(ConditionPredicate::Instruction);
+		usage.conditional_bytes += predicate.names().size() * sizeof(std::string);
+		usage.allocations += !predicate.program().empty() + !predicate.names().empty();
+		for (const std::string& name : predicate.names()) {
+			count_string(name, usage.conditional_bytes, usage);
+		}
+	}
+	return usage;
+}
+
+void AllocationCounter::record_allocation(std::size_t p_bytes) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	bytes_allocated.fetch_add(p_bytes, std::memory_order_relaxed);
+	const std::size_t in_use = bytes_in_use.fetch_add(p_bytes, std::memory_order_relaxed) + p_bytes;
+	std::size_t peak = peak_bytes_in_use.load(std::memory_order_relaxed);
+	while (in_use > peak && !peak_bytes_in_use.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {}
+}
+
+void AllocationCounter::record_deallocation(std::size_t p_bytes) {
+	deallocations.fetch_add(1, std::memory_order_relaxed);
+	bytes_in_use.fetch_sub(p_bytes, std::memory_order_relaxed);
+}
+
+AllocationCounter::Stats AllocationCounter::get_stats() {
+	return {
+		allocations.load(std::memory_order_relaxed),
+		deallocations.load(std::memory_order_relaxed),
+		bytes_allocated.load(std::memory_order_relaxed),
+		bytes_in_use.load(std::memory_order_relaxed),
+		peak_bytes_in_use.load(std::memory_order_relaxed),
+	};
+}
+
+///
+/// @brief Zeroes every counter, bytes still in use from before the reset are no longer tracked
+///
+void AllocationCounter::reset() {
+	allocations.store(0, std::memory_order_relaxed);
+	deallocations.store(0, std::memory_order_relaxed);
+	bytes_allocated.store(0, std::memory_order_relaxed);
+	bytes_in_use.store(0, std::memory_order_relaxed);
+	peak_bytes_in_use.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,77 @@
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include <lexy-vdf/KeyValues.hpp>
+
+using namespace lexy_vdf;
+
+namespace {
+	using MergePolicy = KeyValues::MergePolicy;
+
+	/// Resolves a key both trees hold, Value is a const lvalue reference when copying from the base.
+	template<typename Value>
+	void merge_value(ValueType& overlay, Value&& base, MergePolicy policy) {
+		if (KeyValues* block = std::get_if<KeyValues>(&overlay)) {
+			if (auto* base_block = std::get_if<KeyValues>(&base)) {
+				if constexpr (std::is_const_v<std::remove_reference_t<Value>>) {
+					block->deep_merge(*base_block, policy);
+				} else {
+					block->deep_merge(std::move(*base_block), policy);
+				}
+				return;
+			}
+		}
+
+		if (policy == MergePolicy::BaseWins) overlay = std::forward<Value>(base);
+	}
+}
+
+///
+/// @brief Copies the entries of p_base missing from this tree and resolves the ones both hold by p_policy
+///
+/// The table is sized for both trees once, so filling in a large base doesn't rehash repeatedly.
+/// A conditional entry of the base is only kept if this tree had no plain entry of its key before the merge.
+///
+KeyValues& KeyValues::deep_merge(const KeyValues& p_base, MergePolicy p_policy) {
+	if (this == &p_base) return *this;
+	mark_modified();
+
+	for (const ConditionalEntry& entry : p_base._conditionals) {
+		if (!contains(entry.key)) _conditionals.push_back(entry);
+	}
+
+	reserve(size() + p_base.size());
+	for (const value_type& entry : p_base) {
+		auto [found, inserted] = try_emplace(entry.first, entry.second);
+		if (!inserted) merge_value(found->second, entry.second, p_policy);
+	}
+	return *this;
+}
+
+///
+/// @brief Moves the entries of p_base missing from this tree and resolves the ones both hold by p_policy
+///
+/// Entries without a counterpart are spliced over as nodes, neither reallocated nor copied, only
+/// the keys both trees hold are merged value by value.
+///
+KeyValues& KeyValues::deep_merge(KeyValues&& p_base, MergePolicy p_policy) {
+	if (this == &p_base) return *this;
+	mark_modified();
+
+	if (empty() && _conditionals.empty()) {
+		*this = std::move(p_base);
+		return *this;
+	}
+
+	for (ConditionalEntry& entry : p_base._conditionals) {
+		if (!contains(entry.key)) _conditionals.push_back(std::move(entry));
+	}
+
+	reserve(size() + p_base.size());
+	base_type::merge(static_cast<base_type&>(p_base));
+	for (value_type& entry : p_base) {
+		merge_value(find(entry.first)->second, std::move(entry.second), p_policy);
+	}
+	return *this;
+}
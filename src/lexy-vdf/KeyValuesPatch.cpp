@@ -0,0 +1,130 @@
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <lexy-vdf/KeyValues.hpp>
+
+#include "detail/KeyValuesHash.hpp"
+
+using namespace lexy_vdf;
+
+namespace {
+	struct Differ {
+		std::vector<KeyType> path;
+		Patch patch;
+
+		void emit(const KeyType& key, ValueType old_value, ValueType new_value) {
+			std::vector<KeyType> entry_path;
+			entry_path.reserve(path.size() + 1);
+			entry_path.assign(path.begin(), path.end());
+			entry_path.push_back(key);
+			patch.push_back(PatchEntry { std::move(entry_path), std::move(old_value), std::move(new_value) });
+		}
+
+		void diff(const KeyValues& old_values, const KeyValues& new_values) {
+			for (const auto& [key, old_value] : old_values) {
+				auto found = new_values.find(key);
+				if (found == new_values.end()) {
+					emit(key, old_value, std::monostate {});
+					continue;
+				}
+
+				const ValueType& new_value = found->second;
+				const KeyValues* old_block = std::get_if<KeyValues>(&old_value);
+				const KeyValues* new_block = std::get_if<KeyValues>(&new_value);
+				if (old_block && new_block) {
+					if (*old_block == *new_block) continue;
+					// Conditional entries have no key path of their own, the block is replaced whole
+					if (old_block->conditionals() != new_block->conditionals()) {
+						emit(key, old_value, new_value);
+						continue;
+					}
+					path.push_back(key);
+					diff(*old_block, *new_block);
+					path.pop_back();
+				} else if (old_value != new_value) {
+					emit(key, old_value, new_value);
+				}
+			}
+
+			for (const auto& [key, new_value] : new_values) {
+				if (!old_values.contains(key)) {
+					emit(key, std::monostate {}, new_value);
+				}
+			}
+		}
+	};
+}
+
+///
+/// @brief Computes the changes needed to turn this tree into p_other
+///
+/// Nested blocks are compared first and skipped when equal, the comparison stops at the first
+/// difference so a changed block costs little more than walking it. Every difference is
+/// reported at the deepest differing key, except that a block whose conditional entries differ
+/// is replaced whole, and if the trees' own conditional entries differ the patch is a single
+/// entry with an empty path replacing the whole tree.
+///
+Patch KeyValues::diff(const KeyValues& p_other) const {
+	if (_conditionals != p_other._conditionals) {
+		Patch patch;
+		patch.push_back(PatchEntry { {}, *this, p_other });
+		return patch;
+	}
+
+	Differ differ;
+	differ.diff(*this, p_other);
+	return std::move(differ.patch);
+}
+
+///
+/// @brief Applies a patch produced by diff
+///
+/// Each entry is checked against its recorded old value before it is applied, entries
+/// preceding a failing one stay applied. An entry with an empty path replaces the whole tree.
+///
+KeyValues::PatchError KeyValues::apply_patch(const Patch& p_patch) {
+	mark_modified();
+	for (const PatchEntry& entry : p_patch) {
+		if (entry.path.empty()) {
+			const KeyValues* old_tree = std::get_if<KeyValues>(&entry.old_value);
+			const KeyValues* new_tree = std::get_if<KeyValues>(&entry.new_value);
+			if (!old_tree || !new_tree) return PatchError::PathMissing;
+			if (*this != *old_tree) return PatchError::ValueMismatch;
+			*this = *new_tree;
+			continue;
+		}
+
+		KeyValues* parent = this;
+		for (std::size_t index = 0; index + 1 < entry.path.size(); index++) {
+			auto found = parent->find(entry.path[index]);
+			if (found == parent->end()) return PatchError::PathMissing;
+			parent = std::get_if<KeyValues>(&found->second);
+			if (!parent) return PatchError::PathMissing;
+		}
+
+		const KeyType& key = entry.path.back();
+		auto found = parent->find(key);
+		const bool has_old_value = entry.old_value.index() != 0;
+		if (found == parent->end()) {
+			if (has_old_value) return PatchError::ValueMismatch;
+		} else if (!has_old_value || found->second != entry.old_value) {
+			return PatchError::ValueMismatch;
+		}
+
+		if (entry.new_value.index() == 0) {
+			if (found != parent->end()) parent->erase(found);
+		} else if (found != parent->end()) {
+			found->second = entry.new_value;
+		} else {
+			parent->emplace(key, entry.new_value);
+		}
+	}
+	return PatchError::Success;
+}
+
+std::size_t KeyValues::hash() const {
+	return detail::hash_key_values(*this, nullptr);
+}
@@ -0,0 +1,140 @@
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/LayeredKeyValues.hpp>
+
+using namespace lexy_vdf;
+
+LayeredKeyValues::LayeredKeyValues(layer_list_type p_layers) : _layers(std::move(p_layers)) {}
+
+LayeredKeyValues& LayeredKeyValues::push_top(const KeyValues& p_layer) {
+	_layers.insert(_layers.begin(), &p_layer);
+	return *this;
+}
+
+LayeredKeyValues& LayeredKeyValues::push_bottom(const KeyValues& p_layer) {
+	_layers.push_back(&p_layer);
+	return *this;
+}
+
+const LayeredKeyValues::layer_list_type& LayeredKeyValues::layers() const {
+	return _layers;
+}
+
+const ValueType* LayeredKeyValues::find(KeyObserverType p_key) const {
+	for (const KeyValues* layer : _layers) {
+		if (auto found = layer->find(p_key); found != layer->end()) return &found->second;
+	}
+	return nullptr;
+}
+
+bool LayeredKeyValues::contains(KeyObserverType p_key) const {
+	return find(p_key) != nullptr;
+}
+
+///
+/// @brief Returns a view merging the blocks stored under p_key, empty if p_key is missing or not a block
+///
+LayeredKeyValues LayeredKeyValues::get_block(KeyObserverType p_key) const {
+	LayeredKeyValues result;
+	for (const KeyValues* layer : _layers) {
+		auto found = layer->find(p_key);
+		if (found == layer->end()) continue;
+		const KeyValues* block = std::get_if<KeyValues>(&found->second);
+		if (!block) break;
+		result._layers.push_back(block);
+	}
+	return result;
+}
+
+bool LayeredKeyValues::_shadowed(KeyObserverType key, std::size_t layer_index) const {
+	for (std::size_t index = 0; index < layer_index; index++) {
+		if (_layers[index]->contains(key)) return true;
+	}
+	return false;
+}
+
+///
+/// @brief Visits every visible key once with its highest priority value
+///
+void LayeredKeyValues::for_each(const visitor_type& p_visitor) const {
+	for (std::size_t index = 0; index < _layers.size(); index++) {
+		for (const auto& [key, value] : *_layers[index]) {
+			if (!_shadowed(key, index)) p_visitor(key, value);
+		}
+	}
+}
+
+std::size_t LayeredKeyValues::size() const {
+	std::size_t result = 0;
+	for (std::size_t index = 0; index < _layers.size(); index++) {
+		for (const auto& node : *_layers[index]) {
+			if (!_shadowed(node.first, index)) result++;
+		}
+	}
+	return result;
+}
+
+bool LayeredKeyValues::empty() const {
+	for (const KeyValues* layer : _layers) {
+		if (!layer->empty()) return false;
+	}
+	return true;
+}
+
+///
+/// @brief Materializes the view into a single document, merging nested blocks recursively
+///
+KeyValues LayeredKeyValues::flatten() const {
+	if (_layers.size() == 1) return *_layers.front();
+
+	KeyValues result;
+	std::size_t capacity = 0;
+	for (const KeyValues* layer : _layers) {
+		capacity += layer->size();
+	}
+	result.reserve(capacity);
+
+	for_each([&](const KeyType& key, const ValueType& value) {
+		if (std::holds_alternative<KeyValues>(value)) {
+			result.emplace(key, get_block(key).flatten());
+		} else {
+			result.emplace(key, value);
+		}
+	});
+	return result;
+}
+
+std::int32_t LayeredKeyValues::GetInt(KeyObserverType p_key, std::int32_t p_default_value) const {
+	const ValueType* value = find(p_key);
+	if (!value) return p_default_value;
+	const std::int32_t* result = std::get_if<std::int32_t>(value);
+	if (!result) return p_default_value;
+	return *result;
+}
+
+std::float_t LayeredKeyValues::GetFloat(KeyObserverType p_key, std::float_t p_default_value) const {
+	const ValueType* value = find(p_key);
+	if (!value) return p_default_value;
+	const std::float_t* result = std::get_if<std::float_t>(value);
+	if (!result) return p_default_value;
+	return *result;
+}
+
+std::string_view LayeredKeyValues::GetString(KeyObserverType p_key, std::string_view p_default_value) const {
+	const ValueType* value = find(p_key);
+	if (!value) return p_default_value;
+	const std::string* result = std::get_if<std::string>(value);
+	if (!result) return p_default_value;
+	return *result;
+}
+
+bool LayeredKeyValues::GetBool(KeyObserverType p_key, bool p_default_value) const {
+	for (const KeyValues* layer : _layers) {
+		if (layer->contains(p_key)) return layer->GetBool(p_key, p_default_value);
+	}
+	return p_default_value;
+}
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+
+#include <lexy-vdf/Lexer.hpp>
+
+#include "detail/StatementScanner.hpp"
+#include "detail/UnquotedToken.hpp"
+
+using namespace lexy_vdf;
+
+namespace {
+	using Scanner = detail::StatementScanner;
+	using Unquoted = detail::UnquotedToken;
+
+	constexpr bool is_digit(char c) {
+		return c >= '0' && c <= '9';
+	}
+
+	constexpr bool is_ascii_identifier_char(char c) {
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || is_digit(c) || c == '_';
+	}
+
+	///
+	/// @brief Reads the unquoted token the grammar reads at the start of word
+	///
+	/// Most words are ASCII identifiers or decimal integers in range, which the grammar reads as
+	/// a whole, everything else goes through the grammar's own productions.
+	///
+	Unquoted read_unquoted(std::string_view word) {
+		const char* begin = word.data();
+		const char* end = begin + word.size();
+		if (std::all_of(begin, end, is_digit)) {
+			std::int32_t value;
+			auto [pointer, error] = std::from_chars(begin, end, value);
+			if (error == std::errc {} && pointer == end) return Unquoted { Unquoted::Kind::Integer, end, value, 0 };
+		} else if (!is_digit(word.front()) && std::all_of(begin, end, is_ascii_identifier_char)) {
+			return Unquoted { Unquoted::Kind::Plain, end, 0, 0 };
+		}
+		return detail::match_unquoted(word);
+	}
+
+	Token::Kind value_kind(Unquoted::Kind kind) {
+		switch (kind) {
+			case Unquoted::Kind::Integer: return Token::Kind::Integer;
+			case Unquoted::Kind::Float: return Token::Kind::Float;
+			case Unquoted::Kind::Plain: return Token::Kind::Word;
+			case Unquoted::Kind::Invalid: return Token::Kind::Invalid;
+		}
+		return Token::Kind::Invalid;
+	}
+}
+
+Lexer::Lexer(std::string_view p_source) : _source(p_source), _cursor(p_source.data()) {}
+
+///
+/// @brief Reads one token, tracking whether a key, a value or an include path comes next
+///
+/// Strings and comments end where detail::StatementScanner ends them, so the lexer and the
+/// scanner used by projections and parallel parsing agree on every boundary. Unquoted words are
+/// read by the grammar's own productions, which may end a token inside a scanner word.
+///
+Token Lexer::next() {
+	const char* const end = _source.data() + _source.size();
+	while (_cursor != end && Scanner::is_space(*_cursor)) {
+		_cursor++;
+	}
+
+	const char* const begin = _cursor;
+	auto make = [&](Token::Kind kind) {
+		return Token { kind, std::string_view(begin, static_cast<std::size_t>(_cursor - begin)) };
+	};
+
+	if (_cursor == end) return make(Token::Kind::Eof);
+
+	switch (*_cursor) {
+		case '/':
+			if (_cursor + 1 != end && _cursor[1] == '/') {
+				_cursor = Scanner::find_char(_cursor, end, '\n');
+				const char* comment_end = _cursor[-1] == '\r' ? _cursor - 1 : _cursor;
+				return Token { Token::Kind::Comment, std::string_view(begin, static_cast<std::size_t>(comment_end - begin)) };
+			}
+			break;
+		case '{':
+			_cursor++;
+			_expect = Expect::Key;
+			return make(Token::Kind::OpenBrace);
+		case '}':
+			_cursor++;
+			_expect = Expect::Key;
+			return make(Token::Kind::CloseBrace);
+		case '[': {
+			const char* close = Scanner::find_char(_cursor + 1, end, ']');
+			if (close == end) {
+				_cursor = end;
+				return make(Token::Kind::Invalid);
+			}
+			_cursor = close + 1;
+			_expect = Expect::Key;
+			return make(Token::Kind::Conditional);
+		}
+		case ']':
+			_cursor++;
+			return make(Token::Kind::Invalid);
+		case '"': {
+			const char* close = Scanner::find_string_end(_cursor + 1, end);
+			if (close == end) {
+				_cursor = end;
+				return make(Token::Kind::Invalid);
+			}
+			_cursor = close + 1;
+			const Expect expected = _expect;
+			_expect = expected == Expect::Key ? Expect::Value : Expect::Key;
+			return make(expected == Expect::Key ? Token::Kind::Key : Token::Kind::String);
+		}
+		default: break;
+	}
+
+	while (_cursor != end && !Scanner::is_word_break(*_cursor)) {
+		if (*_cursor == '/' && _cursor + 1 != end && _cursor[1] == '/') break;
+		_cursor++;
+	}
+	if (_cursor == begin) {
+		_cursor++;
+		return make(Token::Kind::Invalid);
+	}
+
+	const std::string_view word(begin, static_cast<std::size_t>(_cursor - begin));
+	if (_expect == Expect::IncludePath) {
+		// Include paths have to be quoted
+		_expect = Expect::Key;
+		return make(Token::Kind::Invalid);
+	}
+	if (_expect == Expect::Key && (word == "#include" || word == "#base")) {
+		_expect = Expect::IncludePath;
+		return make(Token::Kind::Include);
+	}
+
+	const Unquoted token = read_unquoted(word);
+	const bool key = _expect == Expect::Key;
+	_expect = key ? Expect::Value : Expect::Key;
+	if (token.kind == Unquoted::Kind::Invalid || (key && token.kind != Unquoted::Kind::Plain)) return make(Token::Kind::Invalid);
+
+	// The grammar needs no whitespace between tokens, the rest of the word is the next token
+	_cursor = token.end;
+	return make(key ? Token::Kind::Key : value_kind(token.kind));
+}
+
+///
+/// @brief Counts lines from the last resolved offset, or from the start when going backwards
+///
+Lexer::Location Lexer::location(std::size_t p_offset) const {
+	p_offset = std::min(p_offset, _source.size());
+	if (p_offset < _line_offset) {
+		_line_offset = 0;
+		_line_start = 0;
+		_line = 1;
+	}
+
+	const char* cursor = _source.data() + _line_offset;
+	const char* const target = _source.data() + p_offset;
+	while (true) {
+		cursor = Scanner::find_char(cursor, target, '\n');
+		if (cursor == target) break;
+		_line++;
+		_line_start = static_cast<std::size_t>(++cursor - _source.data());
+	}
+	_line_offset = p_offset;
+	return Location { _line, p_offset - _line_start + 1 };
+}
@@ -1,5 +1,7 @@
 #include <functional>
+#include <string>
 #include <string_view>
+#include <utility>
 
 #include <lexy-vdf/Parser.hpp>
 
@@ -9,29 +11,17 @@
 #include "lexy-vdf/KeyValues.hpp"
 
 #include "Grammar.hpp"
-#include "detail/BasicBufferHandler.hpp"
+#include "ParserBufferHandler.hpp"
+#include "detail/DefaultConditions.hpp"
 #include "detail/LexyReportError.hpp"
 #include "detail/OStreamOutputIterator.hpp"
+#include "detail/Warnings.hpp"
 
-using namespace lexy_vdf;
-
-class Parser::BufferHandler final : public detail::BasicBufferHandler<lexy::utf8_char_encoding> {
-public:
-	template<typename Node, typename ParseState, typename ErrorCallback>
-	std::optional<std::vector<ParseError>> parse(ParseState& state, const ErrorCallback& callback) {
-		auto result = lexy::parse<Node>(this->_buffer, state, callback);
-		if (!result) {
-			return result.errors();
-		}
-		_key_values = std::move(result.value());
-		return std::nullopt;
-	}
-
-	KeyValues* get_key_values() { return _key_values; }
+#ifdef LVDF_PROFILING
+#include "detail/Profiler.hpp"
+#endif
 
-private:
-	KeyValues* _key_values;
-};
+using namespace lexy_vdf;
 
 /// BufferHandler ///
 
@@ -42,8 +32,34 @@ Parser::Parser()
 	_parser_state.parse_warnings = &_warnings;
 }
 
-Parser::Parser(Parser&&) = default;
-Parser& Parser::operator=(Parser&&) = default;
+// The parse state points at the warnings of the parser that owns it.
+Parser::Parser(Parser&& other)
+	: detail::BasicParser(std::move(other)),
+	  _buffer_handler(std::move(other._buffer_handler)),
+	  _key_values(std::move(other._key_values)),
+	  _recycled(std::move(other._recycled)),
+	  _parser_state(std::move(other._parser_state)),
+	  _projection(std::move(other._projection)),
+	  _profile(std::move(other._profile)),
+	  _spans(std::move(other._spans)),
+	  _track_spans(other._track_spans) {
+	_parser_state.parse_warnings = &_warnings;
+}
+
+Parser& Parser::operator=(Parser&& other) {
+	detail::BasicParser::operator=(std::move(other));
+	_buffer_handler = std::move(other._buffer_handler);
+	_key_values = std::move(other._key_values);
+	_recycled = std::move(other._recycled);
+	_parser_state = std::move(other._parser_state);
+	_projection = std::move(other._projection);
+	_profile = std::move(other._profile);
+	_spans = std::move(other._spans);
+	_track_spans = other._track_spans;
+	_parser_state.parse_warnings = &_warnings;
+	return *this;
+}
+
 Parser::~Parser() = default;
 
 Parser Parser::from_buffer(const char* data, std::size_t size) {
@@ -88,10 +104,11 @@ constexpr void Parser::_run_load_func(detail::LoadCallback<BufferHandler, Args..
 	_warnings.clear();
 	_errors.clear();
 	_has_fatal_error = false;
+	_buffer_handler->release();
 	if (auto error = func(_buffer_handler.get(), std::forward<Args>(args)...); error) {
 		_has_fatal_error = error.value().type == ParseError::Type::Fatal;
 		_errors.push_back(error.value());
-		_error_stream.get() << "Error: " << _errors.back().message << '\n';
+		_report_load_error();
 	}
 }
 
@@ -118,7 +135,7 @@ constexpr Parser& Parser::load_from_file(const char* path) {
 Parser& Parser::load_from_file(const char* path, const Parser& root) {
 	_file_path = path;
 	_run_load_func(std::mem_fn(&BufferHandler::load_file), path);
-	_parser_state.conditionals = root._parser_state.conditionals;
+	_parser_state.conditions = root._parser_state.conditions;
 	return *this;
 }
 
@@ -131,8 +148,27 @@ bool Parser::parse() {
 		return false;
 	}
 
+#ifdef LVDF_PROFILING
+	detail::Profiler profiler(_profile);
+#endif
+
+	DiagnosticScope diagnostics(*this);
+	recycle_key_values(std::move(_key_values));
+	_spans.clear();
+	_parser_state.bases.clear();
+	if (!_projection.empty()) {
+		return _parse_projected();
+	}
+
+	const std::string_view source = _buffer_handler->get_source();
+	if (_track_spans) {
+		_parser_state.spans = &_spans;
+		_parser_state.source_begin = source.data();
+	}
+
 	std::optional<std::vector<ParseError>> errors;
-	errors = _buffer_handler->template parse<lexy_vdf::grammar::File>(_parser_state, lexy_vdf::detail::ReportError.path(_file_path).to(detail::OStreamOutputIterator { _error_stream }));
+	errors = _buffer_handler->template parse<lexy_vdf::grammar::File>(_parser_state, lexy_vdf::detail::ReportError.path(_file_path).to(detail::OStreamOutputIterator { _error_stream }).visualize(_visualizes_errors()), &_recycled);
+	_parser_state.spans = nullptr;
 	if (errors) {
 		_errors.reserve(errors->size());
 		for (auto& err : errors.value()) {
@@ -142,9 +178,59 @@ bool Parser::parse() {
 		return false;
 	}
 	_key_values.reset(_buffer_handler->get_key_values());
+	_merge_bases(*_key_values);
+	if (_track_spans) _spans.index_lines(source);
 	return true;
 }
 
+///
+/// @brief Deep merges the top level #base files of the last parse under values
+///
+/// Bases only fill in what the file lacks, an earlier #base wins over a later one.
+///
+void Parser::_merge_bases(KeyValues& values) {
+	std::vector<std::string> bases = std::move(_parser_state.bases);
+	_parser_state.bases.clear();
+	for (const std::string& file : bases) {
+		if (auto warning = warnings::merge_check(file, grammar::ListValue::merge_base(values, file)); warning) {
+			_warnings.push_back(warning.value());
+		}
+	}
+}
+
+///
+/// @brief Drops the loaded buffer and the results of the last parse
+///
+/// Conditions, projection and error log are kept, as is the capacity of the error and warning
+/// lists and the table of the parsed tree, so one parser can serve many documents.
+///
+Parser& Parser::reset() {
+	_errors.clear();
+	_warnings.clear();
+	_has_fatal_error = false;
+	_file_path = nullptr;
+	recycle_key_values(std::move(_key_values));
+	_profile.clear();
+	_spans.clear();
+	_buffer_handler->release();
+	return *this;
+}
+
+///
+/// @brief Resets the parser and parses source in place
+///
+/// Unlike load_from_buffer the source is not copied, it only has to outlive this call.
+///
+bool Parser::reparse(std::string_view source) {
+	reset();
+	_buffer_handler->borrow(source.data(), source.data() + source.size());
+	return parse();
+}
+
+bool Parser::reparse(const char* data, std::size_t size) {
+	return reparse(std::string_view(data, size));
+}
+
 const KeyValues* Parser::get_key_values() {
 	return _key_values.get();
 }
@@ -153,45 +239,100 @@ KeyValues* Parser::release_key_values() {
 	return _key_values.release();
 }
 
-const Parser::State Parser::get_parse_state() const {
+///
+/// @brief Keeps p_key_values, emptied, for the next parse to build its root in
+///
+/// The entries are freed here, only the bucket array and the capacity of the conditional entries
+/// are kept. A null tree leaves a tree recycled earlier in place.
+///
+Parser& Parser::recycle_key_values(std::unique_ptr<KeyValues> p_key_values) {
+	if (!p_key_values) return *this;
+	p_key_values->clear();
+	_recycled = std::move(p_key_values);
+	return *this;
+}
+
+const Parser::State& Parser::get_parse_state() const {
 	return _parser_state;
 }
 
+std::string_view Parser::get_source() const {
+	return _buffer_handler->get_source();
+}
+
+///
+/// @brief Statistics of the last parse, empty unless the library was built with LVDF_PROFILING
+///
+const ParseProfile& Parser::get_profile() const {
+	return _profile;
+}
+
 void Parser::set_default_conditions() {
-	// Sourced from https://github.com/ValveSoftware/source-sdk-2013/blob/0d8dceea4310fde5706b3ce1c70609d72a38efdf/sp/src/tier1/KeyValues.cpp
-	// Platform conditions sourced from https://github.com/ValveSoftware/source-sdk-2013/blob/0d8dceea4310fde5706b3ce1c70609d72a38efdf/sp/src/public/tier0/platform.h#L85
-#if defined(_X360)
-	add_condition("X360");
-#elif defined(WIN32)
-	add_condition("WIN32");
-	add_condition("WINDOWS");
-#elif defined(__APPLE__)
-	add_condition("WIN32");
-	add_condition("POSIX");
-	add_condition("OSX");
-#elif defined(__linux__)
-	add_condition("WIN32");
-	add_condition("POSIX");
-	add_condition("LINUX");
-#else
-	// Any other default conditions
-#endif
+	for (std::string_view condition : detail::default_conditions) {
+		add_condition(condition);
+	}
 }
 
 void Parser::clear_conditions() {
-	_parser_state.conditionals.clear();
+	_parser_state.conditions.clear();
 }
 
 void Parser::add_condition(std::string_view conditional) {
-	_parser_state.conditionals.insert(conditional.data());
+	_parser_state.conditions.add(conditional);
 }
 
 bool Parser::remove_condition(std::string_view conditional) {
-	auto found = _parser_state.conditionals.find(conditional);
-	if (found == _parser_state.conditionals.end()) return false;
-	return _parser_state.conditionals.erase(*found) == 1;
+	return _parser_state.conditions.remove(conditional);
 }
 
 bool Parser::has_condition(std::string_view conditional) const {
 	return _parser_state.has_condition(conditional);
+}
+
+const ConditionSet& Parser::get_conditions() const {
+	return _parser_state.conditions;
+}
+
+void Parser::set_conditions(ConditionSet conditions) {
+	_parser_state.conditions = std::move(conditions);
+}
+
+///
+/// @brief Keeps conditional entries of either outcome instead of dropping the disabled ones
+///
+/// Kept entries are stored with their compiled predicate, use KeyValues::resolve to evaluate the
+/// parsed tree under any ConditionSet without parsing it again.
+///
+Parser& Parser::set_keep_conditionals(bool keep) {
+	_parser_state.keep_conditionals = keep;
+	return *this;
+}
+
+bool Parser::get_keep_conditionals() const {
+	return _parser_state.keep_conditionals;
+}
+
+///
+/// @brief Records the byte offset of every parsed key and value, see SourceSpans
+///
+/// Projected parses record nothing, parse_parallel parses sequentially while spans are tracked.
+///
+Parser& Parser::set_track_spans(bool track) {
+	_track_spans = track;
+	return *this;
+}
+
+bool Parser::get_track_spans() const {
+	return _track_spans;
+}
+
+const SourceSpans& Parser::get_source_spans() const {
+	return _spans;
+}
+
+/// Hands the spans of the last parse over, together with release_key_values.
+SourceSpans Parser::release_source_spans() {
+	SourceSpans spans = std::move(_spans);
+	_spans.clear();
+	return spans;
 }
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/ParseError.hpp>
+#include <lexy-vdf/Parser.hpp>
+
+#include <lexy/action/parse.hpp>
+#include <lexy/encoding.hpp>
+#include <lexy/input/string_input.hpp>
+
+#include "detail/BasicBufferHandler.hpp"
+#include "detail/Errors.hpp"
+#include "detail/RecycledTree.hpp"
+#include "detail/Utf16.hpp"
+
+namespace lexy_vdf {
+	/// Loads into storage that release() empties but keeps allocated, so a reused parser loads
+	/// without allocating once its storage fits the largest source so far.
+	class Parser::BufferHandler final : public detail::BasicBufferHandler<lexy::utf8_char_encoding> {
+	public:
+		std::optional<ParseError> load_buffer_size(const char* data, std::size_t size) {
+			_storage.assign(data, size);
+			_loaded = true;
+			return std::nullopt;
+		}
+
+		std::optional<ParseError> load_buffer(const char* start, const char* end) {
+			return load_buffer_size(start, static_cast<std::size_t>(end - start));
+		}
+
+		/// Reads the file like lexy::read_file with a byte order mark, UTF-16 files are transcoded to UTF-8.
+		std::optional<ParseError> load_file(const char* path) {
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			const std::streamoff size = file ? static_cast<std::streamoff>(file.tellg()) : -1;
+			if (size < 0) {
+				return errors::make_no_file_error(path);
+			}
+
+			_storage.resize(static_cast<std::size_t>(size));
+			file.seekg(0);
+			if (!file.read(_storage.data(), static_cast<std::streamsize>(_storage.size()))) {
+				_storage.clear();
+				return errors::make_no_file_error(path);
+			}
+
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>(_storage.data());
+			if (auto endian = detail::detect_utf16_bom(bytes, _storage.size())) {
+				const std::string encoded(_storage.data() + 2, _storage.size() - 2);
+				const detail::Utf16Transcoder transcoder(reinterpret_cast<const unsigned char*>(encoded.data()), encoded.size(), *endian);
+				_storage.resize(transcoder.measure());
+				transcoder.convert(_storage.data());
+			} else if (std::string_view(_storage).starts_with("\xEF\xBB\xBF")) {
+				_storage.erase(0, 3);
+			}
+			_loaded = true;
+			return std::nullopt;
+		}
+
+		/// A grammar::File parse builds its root in recycled if that holds a tree, see detail::RecycledTree.
+		template<typename Node, typename ParseState, typename ErrorCallback>
+		std::optional<std::vector<ParseError>> parse(ParseState& state, const ErrorCallback& callback, std::unique_ptr<KeyValues>* recycled = nullptr) {
+			const std::string_view source = get_source();
+			return parse_range<Node>(source.data(), source.data() + source.size(), state, callback, recycled);
+		}
+
+		/// Parses a slice of the loaded buffer, error locations are relative to begin.
+		template<typename Node, typename ParseState, typename ErrorCallback>
+		std::optional<std::vector<ParseError>> parse_range(const char* begin, const char* end, ParseState& state, const ErrorCallback& callback, std::unique_ptr<KeyValues>* recycled = nullptr) {
+			return parse_slice<Node>(begin, end, state, callback, _key_values, recycled);
+		}
+
+		/// Parses begin to end without touching any handler, so slices of one buffer can be parsed concurrently.
+		template<typename Node, typename ParseState, typename ErrorCallback>
+		static std::optional<std::vector<ParseError>> parse_slice(const char* begin, const char* end, ParseState& state, const ErrorCallback& callback, KeyValues*& key_values, std::unique_ptr<KeyValues>* recycled = nullptr) {
+			const detail::RecycledTree recycle(recycled);
+			state.source_end = end;
+			auto result = lexy::parse<Node>(lexy::string_input<encoding_type>(begin, end), state, callback);
+			if (!result) {
+				return result.errors();
+			}
+			key_values = std::move(result.value());
+			return std::nullopt;
+		}
+
+		/// Parses straight from caller owned memory instead of copying it into the buffer.
+		void borrow(const char* begin, const char* end) {
+			release();
+			_borrowed = true;
+			_borrowed_begin = begin;
+			_borrowed_end = end;
+		}
+
+		void release() {
+			_storage.clear();
+			_loaded = false;
+			_borrowed = false;
+			_borrowed_begin = nullptr;
+			_borrowed_end = nullptr;
+			_key_values = nullptr;
+		}
+
+		bool is_valid() const {
+			return _borrowed || _loaded;
+		}
+
+		std::string_view get_source() const {
+			if (_borrowed) {
+				return std::string_view(_borrowed_begin, static_cast<std::size_t>(_borrowed_end - _borrowed_begin));
+			}
+			return _storage;
+		}
+
+		KeyValues* get_key_values() { return _key_values; }
+
+	private:
+		KeyValues* _key_values = nullptr;
+		std::string _storage;
+		bool _loaded = false;
+		bool _borrowed = false;
+		const char* _borrowed_begin = nullptr;
+		const char* _borrowed_end = nullptr;
+	};
+}
@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <lexy-vdf/Diagnostics.hpp>
+#include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/ParseProfile.hpp>
+#include <lexy-vdf/ParseWarning.hpp>
+#include <lexy-vdf/Parser.hpp>
+
+#include "Grammar.hpp"
+#include "ParserBufferHandler.hpp"
+#include "detail/LexyReportError.hpp"
+#include "detail/NullBuff.hpp"
+#include "detail/OStreamOutputIterator.hpp"
+#include "detail/StatementScanner.hpp"
+
+#ifdef LVDF_PROFILING
+#include "detail/Profiler.hpp"
+#endif
+
+using namespace lexy_vdf;
+
+struct Parser::ParallelParse {
+	/// Below this many bytes per chunk threading costs more than it saves.
+	static constexpr std::size_t min_chunk_size = 1024 * 1024;
+	/// Chunks per thread, so that a thread finishing early can take more work.
+	static constexpr std::size_t chunks_per_thread = 4;
+
+	/// Holds what include files merged by a chunk report until the parallel result is kept.
+	///
+	/// A chunk is parsed by a single thread, so reports need no lock.
+	struct ChunkSink final : DiagnosticSink {
+		std::vector<Diagnostic> diagnostics;
+		bool discard = false;
+
+		void report(Diagnostic&& p_diagnostic) override {
+			diagnostics.push_back(std::move(p_diagnostic));
+		}
+
+		bool discards() const override {
+			return discard;
+		}
+	};
+
+	struct Chunk {
+		std::string_view source;
+		State state;
+		std::vector<ParseWarning> warnings;
+		ChunkSink diagnostics;
+		/// Collected on the thread parsing the chunk.
+		ParseProfile profile;
+		std::unique_ptr<KeyValues> key_values;
+		bool failed = false;
+	};
+
+	Parser& parser;
+
+	///
+	/// @brief Splits source into runs of whole top level statements of roughly chunk_size bytes
+	///
+	/// Returns nothing if the scanner cannot make sense of the top level, the grammar then
+	/// reports the problem through a sequential parse.
+	///
+	static std::optional<std::vector<std::string_view>> split(std::string_view source, std::size_t chunk_size) {
+		std::vector<std::string_view> chunks;
+		detail::StatementScanner scanner(source);
+		detail::StatementScanner::Statement statement;
+		const char* chunk_begin = source.data();
+
+		while (true) {
+			const detail::StatementScanner::Status status = scanner.next(statement);
+			if (status == detail::StatementScanner::Status::Malformed) return std::nullopt;
+			if (status == detail::StatementScanner::Status::End) break;
+
+			if (static_cast<std::size_t>(statement.begin - chunk_begin) >= chunk_size) {
+				chunks.emplace_back(chunk_begin, static_cast<std::size_t>(statement.begin - chunk_begin));
+				chunk_begin = statement.begin;
+			}
+		}
+		if (!scanner.at_end()) return std::nullopt;
+
+		chunks.emplace_back(chunk_begin, static_cast<std::size_t>(source.data() + source.size() - chunk_begin));
+		return chunks;
+	}
+
+	void parse_chunk(Chunk& chunk) {
+#ifdef LVDF_PROFILING
+		detail::Profiler profiler(chunk.profile);
+#endif
+		detail::onullstream discard;
+		chunk.state.parse_warnings = &chunk.warnings;
+		KeyValues* key_values = nullptr;
+		const char* begin = chunk.source.data();
+		chunk.failed = BufferHandler::parse_slice<grammar::File>(begin, begin + chunk.source.size(), chunk.state, detail::ReportError.to(detail::OStreamOutputIterator { discard }).visualize(false), key_values).has_value();
+		chunk.key_values.reset(key_values);
+	}
+
+	///
+	/// @brief Appends a later chunk as if its statements had followed in the same file
+	///
+	/// Plain entries keep the first occurrence of a key, a kept conditional entry only exists
+	/// if no plain entry of its key came before it, both of which are decided chunk by chunk.
+	///
+	static void append(KeyValues& result, KeyValues&& next) {
+		for (const ConditionalEntry& entry : next.conditionals()) {
+			if (!result.contains(entry.key)) {
+				result.add_conditional(entry.key, entry.value, entry.predicate);
+			}
+		}
+		result.reserve(result.size() + next.size());
+		for (auto& [key, value] : next) {
+			result.try_emplace(key, std::move(value));
+		}
+	}
+
+	///
+	/// @brief Sums the profiles of the chunks into the parser's, once the result is kept
+	///
+	/// Production, insert and include times add up the time of every thread, so together they
+	/// can exceed total_time, which is the wall time of the whole parallel parse.
+	///
+	void collect_profile(std::vector<Chunk>& chunks, std::chrono::steady_clock::time_point start) {
+		parser._profile = std::move(chunks.front().profile);
+		for (std::size_t index = 1; index < chunks.size(); index++) {
+			parser._profile.merge(chunks[index].profile);
+		}
+		parser._profile.total_time = std::chrono::steady_clock::now() - start;
+	}
+
+	///
+	/// @brief Hands what the chunks' include files reported on in source order, once the result is kept
+	///
+	/// Without a sink they go to the error log, formatted like the parser's own errors.
+	///
+	void report_includes(std::vector<Chunk>& chunks) {
+		std::string text;
+		for (Chunk& chunk : chunks) {
+			for (Diagnostic& diagnostic : chunk.diagnostics.diagnostics) {
+				if (parser._diagnostic_sink) {
+					parser._diagnostic_sink->report(std::move(diagnostic));
+				} else {
+					write_diagnostic(text, diagnostic);
+				}
+			}
+		}
+		if (!text.empty()) parser._error_stream.get() << text;
+	}
+
+	bool run(std::size_t threads) {
+#ifdef LVDF_PROFILING
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#endif
+		const std::string_view source = parser._buffer_handler->get_source();
+		const std::size_t chunk_size = std::max(min_chunk_size, source.size() / (threads * chunks_per_thread) + 1);
+		std::optional<std::vector<std::string_view>> sources = split(source, chunk_size);
+		if (!sources || sources->size() < 2) return parser.parse();
+
+		parser._parser_state.bases.clear();
+		std::vector<Chunk> chunks(sources->size());
+		const bool discards = parser._diagnostic_sink ? parser._diagnostic_sink->discards() : &parser._error_stream.get() == &detail::cnull;
+		for (std::size_t index = 0; index < chunks.size(); index++) {
+			chunks[index].source = (*sources)[index];
+			chunks[index].state = parser._parser_state;
+			chunks[index].diagnostics.discard = discards;
+		}
+
+		std::atomic<std::size_t> next_chunk { 0 };
+		auto work = [&] {
+			for (std::size_t index = next_chunk++; index < chunks.size(); index = next_chunk++) {
+				// Include files merged by the chunk report to it, a sequential fallback reports them again itself
+				DiagnosticSink::Scope diagnostics(&chunks[index].diagnostics);
+				parse_chunk(chunks[index]);
+			}
+		};
+
+		std::vector<std::thread> workers;
+		workers.reserve(std::min(threads, chunks.size()) - 1);
+		for (std::size_t worker = 1; worker < std::min(threads, chunks.size()); worker++) {
+			workers.emplace_back(work);
+		}
+		work();
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+
+		// Error locations are relative to their chunk, let the sequential parse report them properly
+		for (const Chunk& chunk : chunks) {
+			if (chunk.failed || !chunk.key_values) return parser.parse();
+		}
+
+		std::unique_ptr<KeyValues> result = std::move(chunks.front().key_values);
+		for (std::size_t index = 1; index < chunks.size(); index++) {
+			append(*result, std::move(*chunks[index].key_values));
+		}
+
+		const std::size_t warning_count = parser._warnings.size();
+		for (Chunk& chunk : chunks) {
+			for (ParseWarning& warning : chunk.warnings) {
+				parser._warnings.push_back(std::move(warning));
+			}
+			for (std::string& base : chunk.state.bases) {
+				parser._parser_state.bases.push_back(std::move(base));
+			}
+			// Names interned by a chunk while keeping conditionals stay known to the parser
+			for (std::size_t index = 0; index < chunk.state.conditions.interned_count(); index++) {
+				parser._parser_state.conditions.intern(chunk.state.conditions.name(static_cast<ConditionSet::Index>(index)));
+			}
+		}
+
+#ifdef LVDF_PROFILING
+		collect_profile(chunks, start);
+#endif
+		report_includes(chunks);
+		parser._merge_bases(*result);
+		parser._report_diagnostics(parser._errors.size(), warning_count);
+		parser._key_values = std::move(result);
+		return true;
+	}
+};
+
+///
+/// @brief Parses the loaded buffer on up to threads threads, 0 uses one per hardware thread
+///
+/// The buffer is split at top level statements and the chunks are merged in source order, so
+/// the result, warnings and duplicate key handling match parse(). The profile sums what every
+/// thread collected, see ParallelParse::collect_profile. Small buffers, projections,
+/// tracked spans and buffers with errors are handled by parse().
+///
+bool Parser::parse_parallel(std::size_t threads) {
+	if (!_buffer_handler->is_valid()) {
+		return false;
+	}
+
+	if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+	if (threads == 1 || !_projection.empty() || _track_spans) {
+		return parse();
+	}
+
+	ParallelParse parallel { *this };
+	return parallel.run(threads);
+}
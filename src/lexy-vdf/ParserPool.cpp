@@ -0,0 +1,84 @@
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include <lexy-vdf/Parser.hpp>
+#include <lexy-vdf/ParserPool.hpp>
+
+using namespace lexy_vdf;
+
+ParserPool::Lease::Lease(ParserPool& pool, std::unique_ptr<Parser> parser)
+	: _pool(&pool),
+	  _parser(std::move(parser)) {}
+
+ParserPool::Lease::Lease(Lease&& other) noexcept
+	: _pool(other._pool),
+	  _parser(std::move(other._parser)) {}
+
+ParserPool::Lease& ParserPool::Lease::operator=(Lease&& other) noexcept {
+	if (this == &other) return *this;
+	if (_parser) _pool->_release(std::move(_parser));
+	_pool = other._pool;
+	_parser = std::move(other._parser);
+	return *this;
+}
+
+ParserPool::Lease::~Lease() {
+	if (_parser) _pool->_release(std::move(_parser));
+}
+
+ParserPool::ParserPool(std::size_t p_max_idle) : _max_idle(p_max_idle) {
+	_idle.reserve(p_max_idle);
+}
+
+///
+/// @brief Pool of the calling thread, KeyValues::from_*, MergeWith and merge_base draw their parsers from it
+///
+ParserPool& ParserPool::local() {
+	thread_local ParserPool pool;
+	return pool;
+}
+
+///
+/// @brief Takes an idle parser, or constructs one when none is left
+///
+/// The parser is configured like a newly constructed one, with the default conditions and
+/// errors logged to stderr.
+///
+ParserPool::Lease ParserPool::acquire() {
+	if (_idle.empty()) return Lease(*this, std::make_unique<Parser>());
+
+	std::unique_ptr<Parser> parser = std::move(_idle.back());
+	_idle.pop_back();
+	return Lease(*this, std::move(parser));
+}
+
+void ParserPool::set_max_idle(std::size_t p_max_idle) {
+	_max_idle = p_max_idle;
+	while (_idle.size() > _max_idle) {
+		_idle.pop_back();
+	}
+}
+
+void ParserPool::clear() {
+	_idle.clear();
+}
+
+///
+/// @brief Resets a returned parser and restores the configuration a new parser starts with
+///
+/// Interned condition names, reserved capacity and the source storage survive, which is what makes reuse cheap.
+///
+void ParserPool::_release(std::unique_ptr<Parser> parser) {
+	if (_idle.size() >= _max_idle) return;
+
+	parser->reset();
+	parser->clear_conditions();
+	parser->set_default_conditions();
+	parser->clear_projection();
+	parser->set_keep_conditionals(false);
+	parser->set_track_spans(false);
+	parser->set_error_log_to_stderr();
+	parser->set_diagnostic_sink(nullptr);
+	_idle.push_back(std::move(parser));
+}
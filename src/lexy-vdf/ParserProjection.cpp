@@ -0,0 +1,341 @@
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <lexy-vdf/CompiledPath.hpp>
+#include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/Parser.hpp>
+
+#include "Grammar.hpp"
+#include "ParserBufferHandler.hpp"
+#include "detail/ConditionEvaluator.hpp"
+#include "detail/LexyReportError.hpp"
+#include "detail/OStreamOutputIterator.hpp"
+#include "detail/StatementScanner.hpp"
+#include "detail/Unescape.hpp"
+#include "detail/Warnings.hpp"
+
+using namespace lexy_vdf;
+
+struct Parser::Projector {
+	struct Cursor {
+		const CompiledPath* path;
+		std::size_t depth;
+
+		const CompiledPath::Segment& segment() const {
+			return path->segments()[depth];
+		}
+
+		bool is_last() const {
+			return depth + 1 == path->segments().size();
+		}
+	};
+	using CursorList = std::vector<Cursor>;
+
+	Parser& parser;
+
+	///
+	/// @brief Copies the parts of an already materialized tree selected by cursors
+	///
+	void copy(const KeyValues& source, const CursorList& cursors, KeyValues& out) {
+		for (const auto& [key, value] : source) {
+			if (out.contains(key)) continue;
+
+			CursorList next;
+			bool take_whole = false;
+			for (const Cursor& cursor : cursors) {
+				const CompiledPath::Segment& segment = cursor.segment();
+				if (!segment.matches_key(key) || !segment.matches_value(value)) continue;
+				if (cursor.is_last()) {
+					take_whole = true;
+					break;
+				}
+				next.push_back({ cursor.path, cursor.depth + 1 });
+			}
+
+			if (take_whole) {
+				out.emplace(key, value);
+				continue;
+			}
+
+			const KeyValues* block = std::get_if<KeyValues>(&value);
+			if (!block || next.empty()) continue;
+
+			KeyValues child;
+			copy(*block, next, child);
+			if (!child.empty()) out.emplace(key, std::move(child));
+		}
+	}
+
+	/// Keys of a block a full parse inserts, whether or not the projection selected them, so that
+	/// later duplicates are skipped as KeyValues keeps the first value.
+	struct SeenKeys {
+		/// Whether the first value of the key was a block.
+		std::unordered_map<std::string_view, bool> blocks;
+		/// Storage of keys that don't point into the buffer.
+		std::deque<std::string> owned;
+
+		bool contains(std::string_view key) const {
+			return blocks.contains(key);
+		}
+
+		void add(std::string_view key, bool block) {
+			blocks.try_emplace(key, block);
+		}
+
+		void add_owned(std::string_view key, bool block) {
+			if (!contains(key)) blocks.try_emplace(owned.emplace_back(key), block);
+		}
+
+		void add_all(const KeyValues& values) {
+			for (const auto& [key, value] : values) {
+				add_owned(key, std::holds_alternative<KeyValues>(value));
+			}
+		}
+	};
+
+	///
+	/// @brief Materializes the statements of range selected by cursors, skipping every other block unparsed
+	///
+	/// Statements that a selector ends on, that carry predicates or a conditional attribute are
+	/// handed to the grammar whole, blocks only passed through are scanned recursively. At the
+	/// top level, range is the whole file and its #base files are merged once the scan is done,
+	/// like Parser::_merge_bases does after a full parse.
+	///
+	bool scan(std::string_view range, const CursorList& cursors, KeyValues& out, bool top_level = false) {
+		using Status = detail::StatementScanner::Status;
+
+		detail::StatementScanner scanner(range);
+		detail::StatementScanner::Statement statement;
+		Status status;
+		SeenKeys seen;
+		std::vector<std::string> bases;
+		while ((status = scanner.next(statement)) == Status::Ok) {
+			if (statement.is_include()) {
+				std::string file;
+				if (!detail::unescape_append(statement.value.string_body(), file)) return false;
+				if (statement.key.text() != "#base") {
+					include(file, cursors, out, seen);
+				} else if (top_level) {
+					bases.push_back(std::move(file));
+				} else {
+					merge_base(file, cursors, out, seen);
+				}
+				continue;
+			}
+
+			std::string_view key = statement.key.text();
+			if (statement.key.kind == detail::ScannedToken::Kind::String) {
+				key = statement.key.string_body();
+				if (key.find('\') != std::string_view::npos) {
+					std::string& decoded = seen.owned.emplace_back();
+					if (!detail::unescape_append(key, decoded)) return false;
+					key = decoded;
+				}
+			}
+			if (seen.contains(key)) continue;
+
+			// A statement its condition drops, or that is kept as a conditional entry, doesn't hide later duplicates
+			if (!statement.has_condition) {
+				seen.add(key, statement.is_block());
+			} else if (!parser._parser_state.keep_conditionals) {
+				auto has_condition = [this](std::string_view name) {
+					return parser._parser_state.has_condition(name);
+				};
+				const std::optional<bool> enabled = detail::ConditionEvaluator(statement.condition.text(), has_condition).evaluate();
+				if (!enabled) return false;
+				if (*enabled) seen.add(key, statement.is_block());
+			}
+
+			CursorList next;
+			bool materialize = statement.has_condition;
+			bool ends_here = false;
+			for (const Cursor& cursor : cursors) {
+				const CompiledPath::Segment& segment = cursor.segment();
+				if (!segment.matches_key(key)) continue;
+				if (cursor.is_last()) {
+					ends_here = true;
+				} else {
+					next.push_back({ cursor.path, cursor.depth + 1 });
+				}
+				materialize |= !segment.predicates.empty();
+			}
+			if (!ends_here && (next.empty() || !statement.is_block())) continue;
+
+			if (materialize || ends_here) {
+				KeyValues fragment;
+				if (!parse_fragment(statement.begin, statement.end, fragment)) return false;
+				copy(fragment, cursors, out);
+				continue;
+			}
+
+			KeyValues child;
+			if (!scan(statement.body(), next, child)) return false;
+			if (!child.empty()) out.emplace(std::string(key), std::move(child));
+		}
+		if (status != Status::End || !scanner.at_end()) return false;
+
+		for (const std::string& file : bases) {
+			merge_base(file, cursors, out, seen);
+		}
+		return true;
+	}
+
+	///
+	/// @brief Copies the parts of an #include file selected by cursors whose keys the block lacks
+	///
+	void include(const std::string& file, const CursorList& cursors, KeyValues& out, SeenKeys& seen) {
+		KeyValues included;
+		if (auto warning = warnings::merge_check(file, included.MergeWith(file)); warning) {
+			parser._warnings.push_back(warning.value());
+		}
+		for (auto it = included.begin(); it != included.end();) {
+			it = seen.contains(it->first) ? included.erase(it) : std::next(it);
+		}
+		seen.add_all(included);
+		copy(included, cursors, out);
+	}
+
+	///
+	/// @brief Deep merges the parts of a #base file selected by cursors under out
+	///
+	/// The base is projected on its own first, so blocks out already holds are filled in rather
+	/// than skipped like copy skips them. Keys the block holds with a value other than a block
+	/// keep that value, selected or not.
+	///
+	void merge_base(const std::string& file, const CursorList& cursors, KeyValues& out, SeenKeys& seen) {
+		KeyValues base;
+		if (auto warning = warnings::merge_check(file, base.merge_base(file)); warning) {
+			parser._warnings.push_back(warning.value());
+		}
+		for (auto it = base.begin(); it != base.end();) {
+			auto found = seen.blocks.find(it->first);
+			const bool hidden = found != seen.blocks.end() && (!found->second || !std::holds_alternative<KeyValues>(it->second));
+			it = hidden ? base.erase(it) : std::next(it);
+		}
+		seen.add_all(base);
+
+		KeyValues projected;
+		copy(base, cursors, projected);
+		out.deep_merge(std::move(projected));
+	}
+
+	///
+	/// @brief Parses one statement of the buffer with the grammar
+	///
+	/// lexy only sees the fragment, so its visualization would show fragment relative positions.
+	/// It is skipped and the errors are logged once moved back into buffer coordinates.
+	///
+	bool parse_fragment(const char* begin, const char* end, KeyValues& out) {
+		auto errors = parser._buffer_handler->template parse_range<grammar::File>(begin, end, parser._parser_state,
+			detail::ReportError.path(parser._file_path).to(detail::OStreamOutputIterator { parser._error_stream }).visualize(false));
+		if (errors) {
+			const std::size_t error_count = parser._errors.size();
+			record_errors(errors.value(), begin);
+			parser._log_errors(error_count);
+			return false;
+		}
+
+		std::unique_ptr<KeyValues> fragment(parser._buffer_handler->get_key_values());
+		parser._merge_bases(*fragment);
+		out = std::move(*fragment);
+		return true;
+	}
+
+	/// Moves fragment relative error locations back into buffer coordinates.
+	void record_errors(const std::vector<ParseError>& errors, const char* fragment_begin) {
+		const char* buffer_begin = parser._buffer_handler->get_source().data();
+		const unsigned int line_offset = static_cast<unsigned int>(std::count(buffer_begin, fragment_begin, '\n'));
+		const char* line_begin = fragment_begin;
+		while (line_begin != buffer_begin && line_begin[-1] != '\n') {
+			line_begin--;
+		}
+		const unsigned int column_offset = static_cast<unsigned int>(fragment_begin - line_begin);
+
+		auto line = [&](unsigned int value) { return value + line_offset; };
+		auto column = [&](unsigned int line_value, unsigned int value) { return line_value == 1 ? value + column_offset : value; };
+
+		parser._errors.reserve(parser._errors.size() + errors.size());
+		for (const ParseError& error : errors) {
+			parser._has_fatal_error |= error.type == ParseError::Type::Fatal;
+			parser._errors.push_back(ParseError {
+				error.type,
+				error.message,
+				error.error_value,
+				ParseData {
+					error.parse_data.production_name,
+					line(error.parse_data.context_start_line),
+					column(error.parse_data.context_start_line, error.parse_data.context_start_column),
+				},
+				line(error.start_line),
+				column(error.start_line, error.start_column),
+			});
+		}
+	}
+};
+
+Parser& Parser::set_projection(std::vector<CompiledPath> paths) {
+	_projection = std::move(paths);
+	return *this;
+}
+
+Parser& Parser::add_projection(CompiledPath path) {
+	_projection.push_back(std::move(path));
+	return *this;
+}
+
+void Parser::clear_projection() {
+	_projection.clear();
+}
+
+const std::vector<CompiledPath>& Parser::get_projection() const {
+	return _projection;
+}
+
+///
+/// @brief Parses only the subtrees selected by the projection
+///
+/// Input the scanner cannot split falls back to a full parse so that the grammar reports
+/// the error, or projects the complete tree if it turns out to be valid.
+///
+bool Parser::_parse_projected() {
+	Projector projector { *this };
+	Projector::CursorList cursors;
+	cursors.reserve(_projection.size());
+	for (const CompiledPath& path : _projection) {
+		cursors.push_back({ &path, 0 });
+	}
+
+	const std::string_view source = _buffer_handler->get_source();
+	const std::size_t warning_count = _warnings.size();
+	auto result = std::make_unique<KeyValues>();
+	if (projector.scan(source, cursors, *result, true)) {
+		_key_values = std::move(result);
+		return true;
+	}
+	if (has_error()) return false;
+
+	while (_warnings.size() > warning_count) {
+		_warnings.pop_back();
+	}
+	auto errors = _buffer_handler->template parse<grammar::File>(_parser_state, detail::ReportError.path(_file_path).to(detail::OStreamOutputIterator { _error_stream }).visualize(_visualizes_errors()));
+	if (errors) {
+		projector.record_errors(errors.value(), source.data());
+		return false;
+	}
+
+	std::unique_ptr<KeyValues> full(_buffer_handler->get_key_values());
+	_merge_bases(*full);
+	result->clear();
+	projector.copy(*full, cursors, *result);
+	_key_values = std::move(result);
+	return true;
+}
@@ -0,0 +1,103 @@
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/Parser.hpp>
+#include <lexy-vdf/RecordStream.hpp>
+
+#include "detail/StatementScanner.hpp"
+
+using namespace lexy_vdf;
+
+RecordStream::RecordStream() = default;
+
+RecordStream& RecordStream::load_from_string(std::string_view p_source, std::size_t p_offset, bool p_final) {
+	_load(p_source, p_offset, p_final);
+	return *this;
+}
+
+///
+/// @brief Reads the file from p_offset into the reused storage of the stream
+///
+/// The file is expected to be UTF-8, a byte order mark at the start of the file is skipped.
+///
+bool RecordStream::load_from_file(const std::filesystem::path& p_path, std::size_t p_offset) {
+	std::ifstream file(p_path, std::ios::binary | std::ios::ate);
+	const std::streamoff size = file ? static_cast<std::streamoff>(file.tellg()) : -1;
+	if (size < 0 || static_cast<std::size_t>(size) < p_offset) {
+		_load({}, p_offset, true);
+		return false;
+	}
+
+	_storage.resize(static_cast<std::size_t>(size) - p_offset);
+	file.seekg(static_cast<std::streamoff>(p_offset));
+	if (!file.read(_storage.data(), static_cast<std::streamsize>(_storage.size()))) {
+		_load({}, p_offset, true);
+		return false;
+	}
+
+	std::string_view source = _storage;
+	if (p_offset == 0 && source.starts_with("\xEF\xBB\xBF")) {
+		source.remove_prefix(3);
+		p_offset = 3;
+	}
+	_load(source, p_offset, false);
+	return true;
+}
+
+void RecordStream::_load(std::string_view source, std::size_t offset, bool final) {
+	_source = source;
+	_base_offset = offset;
+	_cursor = 0;
+	_offset = offset;
+	_final = final;
+	_status = Status::Ok;
+	_record = {};
+	_parser.recycle_key_values(std::move(_key_values));
+}
+
+///
+/// @brief Splits off the next top level statement and parses it as a document of its own
+///
+/// Unless the source is final a statement reaching its very end is held back, a value word or a
+/// conditional attribute could still be continued by the writer.
+///
+RecordStream::Status RecordStream::next() {
+	using Scanner = detail::StatementScanner;
+
+	if (_status != Status::Ok) return _status;
+	_record = {};
+	// The previous record's tree is emptied and the next one is parsed into it
+	_parser.recycle_key_values(std::move(_key_values));
+
+	const char* const begin = _source.data();
+	const char* const end = begin + _source.size();
+	Scanner scanner(begin + _cursor, end);
+	Scanner::Statement statement;
+	switch (scanner.next(statement)) {
+		case Scanner::Status::End:
+			return _status = scanner.at_end() ? Status::End : Status::Malformed;
+		case Scanner::Status::Malformed:
+			return _status = scanner.position() == end ? Status::Incomplete : Status::Malformed;
+		case Scanner::Status::Ok: break;
+	}
+	if (!_final && statement.end == end) return _status = Status::Incomplete;
+
+	const std::string_view source(statement.begin, static_cast<std::size_t>(statement.end - statement.begin));
+	if (_parser.reparse(source)) _key_values.reset(_parser.release_key_values());
+
+	_cursor = static_cast<std::size_t>(statement.end - begin);
+	_offset = _base_offset + _cursor;
+	_record = Record {
+		_base_offset + static_cast<std::size_t>(statement.begin - begin),
+		source,
+		_key_values.get(),
+		&_parser.get_errors(),
+		&_parser.get_warnings(),
+	};
+	return _status;
+}
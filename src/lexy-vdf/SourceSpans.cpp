@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/SourceSpans.hpp>
+
+using namespace lexy_vdf;
+
+namespace {
+	void collect_entries(const KeyValues& block, std::vector<const KeyValues::value_type*>& out) {
+		for (const KeyValues::value_type& entry : block) {
+			out.push_back(&entry);
+			if (const KeyValues* child = std::get_if<KeyValues>(&entry.second)) collect_entries(*child, out);
+		}
+	}
+}
+
+std::optional<SourceSpans::Span> SourceSpans::find(const KeyValues::value_type& p_entry) const {
+	if (!_sorted) _sort();
+	auto found = std::lower_bound(_records.begin(), _records.end(), &p_entry, [](const Record& record, const KeyValues::value_type* entry) {
+		return std::less<const KeyValues::value_type*> {}(record.entry, entry);
+	});
+	if (found == _records.end() || found->entry != &p_entry) return std::nullopt;
+	return found->span;
+}
+
+std::optional<SourceSpans::Location> SourceSpans::key_location(const KeyValues::value_type& p_entry) const {
+	std::optional<Span> span = find(p_entry);
+	if (!span) return std::nullopt;
+	return location(span->key);
+}
+
+std::optional<SourceSpans::Location> SourceSpans::value_location(const KeyValues::value_type& p_entry) const {
+	std::optional<Span> span = find(p_entry);
+	if (!span) return std::nullopt;
+	return location(span->value);
+}
+
+SourceSpans::Location SourceSpans::location(std::uint32_t p_offset) const {
+	auto next_line = std::upper_bound(_line_starts.begin(), _line_starts.end(), p_offset);
+	if (next_line == _line_starts.begin()) return Location { 1, static_cast<std::size_t>(p_offset) + 1 };
+	const std::size_t line = static_cast<std::size_t>(next_line - _line_starts.begin());
+	return Location { line, static_cast<std::size_t>(p_offset - *(next_line - 1)) + 1 };
+}
+
+void SourceSpans::clear() {
+	_records.clear();
+	_sorted = true;
+	_line_starts.clear();
+}
+
+void SourceSpans::record(const KeyValues::value_type& p_entry, std::uint32_t p_key, std::uint32_t p_value) {
+	_records.push_back({ &p_entry, { p_key, p_value } });
+	_sorted = false;
+}
+
+///
+/// @brief Drops the records of every entry inside p_value
+///
+/// Statements are reduced depth first, so the entries of a just dropped block were the last
+/// ones recorded and only that many records at the end of the table are searched.
+///
+void SourceSpans::discard(const ValueType& p_value) {
+	const KeyValues* block = std::get_if<KeyValues>(&p_value);
+	if (!block || block->empty()) return;
+
+	std::vector<const KeyValues::value_type*> entries;
+	collect_entries(*block, entries);
+	std::sort(entries.begin(), entries.end(), std::less<const KeyValues::value_type*> {});
+
+	const std::size_t window = std::min(entries.size(), _records.size());
+	auto tail = _records.end() - static_cast<std::ptrdiff_t>(window);
+	_records.erase(std::remove_if(tail, _records.end(), [&entries](const Record& record) {
+		return std::binary_search(entries.begin(), entries.end(), record.entry, std::less<const KeyValues::value_type*> {});
+	}),
+		_records.end());
+}
+
+///
+/// @brief Records where every line of p_source starts, for location
+///
+void SourceSpans::index_lines(std::string_view p_source) {
+	_line_starts.clear();
+	_line_starts.push_back(0);
+	const char* const begin = p_source.data();
+	const char* const end = begin + p_source.size();
+	for (const char* cursor = begin; cursor != end;) {
+		const void* found = std::memchr(cursor, '\n', static_cast<std::size_t>(end - cursor));
+		if (!found) break;
+		cursor = static_cast<const char*>(found) + 1;
+		_line_starts.push_back(static_cast<std::uint32_t>(cursor - begin));
+	}
+}
+
+///
+/// @brief Sorts the records by entry address
+///
+/// Parsing only appends, so records are sorted once on the first lookup. Should an address
+/// still appear twice, the later record belongs to the entry that is alive.
+///
+void SourceSpans::_sort() const {
+	std::stable_sort(_records.begin(), _records.end(), [](const Record& lhs, const Record& rhs) {
+		return std::less<const KeyValues::value_type*> {}(lhs.entry, rhs.entry);
+	});
+
+	auto out = _records.begin();
+	for (auto it = _records.begin(); it != _records.end(); it++) {
+		if (std::next(it) != _records.end() && std::next(it)->entry == it->entry) continue;
+		*out++ = *it;
+	}
+	_records.erase(out, _records.end());
+	_sorted = true;
+}
@@ -0,0 +1,291 @@
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/Writer.hpp>
+
+#include "detail/Unescape.hpp"
+
+using namespace lexy_vdf;
+
+namespace {
+	/// Inverse of detail::unescape_symbol, '\'' and '/' need no escape inside quotes.
+	constexpr char escape_symbol(char c) {
+		switch (c) {
+			case '"': return '"';
+			case '\\': return '\\';
+			case '\b': return 'b';
+			case '\f': return 'f';
+			case '\n': return 'n';
+			case '\r': return 'r';
+			case '\t': return 't';
+			default: return 0;
+		}
+	}
+
+	/// End of the run from cursor that is written as is, stops at a byte to escape or one the grammar rejects.
+	const char* plain_run_end(const char* cursor, const char* end) {
+		while (cursor != end) {
+			const unsigned char c = static_cast<unsigned char>(*cursor);
+			if (c < 0x80) {
+				if (c < 0x20 || c == 0x7F || c == '"' || c == '\\') return cursor;
+				cursor++;
+				continue;
+			}
+
+			detail::ByteCursor bytes { cursor, end };
+			if (!detail::match_string_code_point(bytes)) return cursor;
+			cursor = bytes.cursor;
+		}
+		return end;
+	}
+}
+
+Writer::Writer(Style p_style) : _flush_size(0), _style(p_style) {}
+
+Writer::Writer(Sink p_sink, Style p_style, std::size_t p_flush_size)
+	: _sink(std::move(p_sink)),
+	  _flush_size(p_flush_size),
+	  _style(p_style) {
+	_buffer.reserve(p_flush_size);
+}
+
+Writer::Writer(std::ostream& p_stream, Style p_style, std::size_t p_flush_size)
+	: Writer(
+		  [&p_stream](std::string_view chunk) {
+			  p_stream.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+		  },
+		  p_style, p_flush_size) {}
+
+Writer::~Writer() {
+	flush();
+}
+
+Writer& Writer::write(const KeyValues& p_key_values) {
+	_write_block(p_key_values);
+	return *this;
+}
+
+Writer& Writer::write(KeyObserverType p_key, const ValueType& p_value) {
+	_write_entry(p_key, p_value, nullptr);
+	return *this;
+}
+
+///
+/// @brief Opens a block entry, for streaming a tree that is never built as KeyValues
+///
+Writer& Writer::begin_block(KeyObserverType p_key) {
+	if (_refused_depth != 0 || !_open_block(p_key)) _refused_depth++;
+	return *this;
+}
+
+Writer& Writer::end_block() {
+	if (_refused_depth != 0) {
+		_refused_depth--;
+	} else {
+		_close_block(nullptr);
+	}
+	return *this;
+}
+
+///
+/// @brief Hands the buffered text to the sink, without a sink the text stays in the buffer
+///
+void Writer::flush() {
+	if (!_sink || _buffer.empty()) return;
+	_sink(_buffer);
+	_buffer.clear();
+}
+
+void Writer::clear() {
+	_buffer.clear();
+	_depth = 0;
+	_refused_depth = 0;
+	_separate_next = false;
+	_error = Error::None;
+}
+
+std::string Writer::take() {
+	std::string result = std::move(_buffer);
+	clear();
+	return result;
+}
+
+bool Writer::can_write(std::string_view p_string) {
+	const char* cursor = p_string.data();
+	const char* end = cursor + p_string.size();
+	while ((cursor = plain_run_end(cursor, end)) != end) {
+		if (!escape_symbol(*cursor)) return false;
+		cursor++;
+	}
+	return true;
+}
+
+std::string Writer::to_string(const KeyValues& p_key_values, Style p_style) {
+	Writer writer(p_style);
+	writer.write(p_key_values);
+	return writer.take();
+}
+
+///
+/// @brief Writes the entries of a block, kept conditional entries first as they win over plain entries of the same key
+///
+void Writer::_write_block(const KeyValues& key_values) {
+	for (const ConditionalEntry& entry : key_values.conditionals()) {
+		_write_entry(entry.key, entry.value, &entry.predicate);
+	}
+	for (const auto& [key, value] : key_values) {
+		_write_entry(key, value, nullptr);
+	}
+}
+
+///
+/// @brief Writes one entry, an entry with a string that can't be written is refused as a whole
+///
+/// Nothing is flushed before an entry ends, so a refused entry is taken back off the buffer.
+///
+void Writer::_write_entry(KeyObserverType key, const ValueType& value, const ConditionPredicate* predicate) {
+	if (value.index() == 0 || _refused_depth != 0) return;
+
+	if (const KeyValues* block = std::get_if<KeyValues>(&value)) {
+		if (!_open_block(key)) return;
+		_write_block(*block);
+		_close_block(predicate);
+		return;
+	}
+
+	const std::size_t entry_begin = _buffer.size();
+	if (!_write_key(key)) return _refuse(entry_begin);
+	_buffer.push_back(_style == Style::Pretty ? '\t' : ' ');
+	const bool written = std::visit(
+		[this](const auto& scalar) {
+			using T = std::decay_t<decltype(scalar)>;
+			if constexpr (std::is_same_v<T, std::string>) {
+				return _write_string(scalar);
+			} else if constexpr (std::is_same_v<T, std::int32_t>) {
+				_write_int(scalar);
+			} else if constexpr (std::is_same_v<T, std::float_t>) {
+				_write_float(scalar);
+			}
+			return true;
+		},
+		value);
+	if (!written) return _refuse(entry_begin);
+	_end_entry(predicate);
+}
+
+bool Writer::_write_key(KeyObserverType key) {
+	if (_style == Style::Pretty) {
+		_buffer.append(_depth, '\t');
+	} else if (_separate_next) {
+		_buffer.push_back(' ');
+	}
+	return _write_string(key);
+}
+
+bool Writer::_open_block(KeyObserverType key) {
+	const std::size_t entry_begin = _buffer.size();
+	if (!_write_key(key)) {
+		_refuse(entry_begin);
+		return false;
+	}
+	if (_style == Style::Pretty) {
+		_buffer.push_back('\n');
+		_buffer.append(_depth, '\t');
+		_buffer.append("{\n");
+	} else {
+		_buffer.append(" {");
+		_separate_next = false;
+	}
+	_depth++;
+	return true;
+}
+
+void Writer::_close_block(const ConditionPredicate* predicate) {
+	_depth--;
+	if (_style == Style::Pretty) _buffer.append(_depth, '\t');
+	_buffer.push_back('}');
+	_end_entry(predicate);
+}
+
+void Writer::_end_entry(const ConditionPredicate* predicate) {
+	if (predicate) {
+		_buffer.push_back(' ');
+		_buffer.append(predicate->to_string());
+	}
+	if (_style == Style::Pretty) _buffer.push_back('\n');
+	_separate_next = true;
+	_maybe_flush();
+}
+
+void Writer::_refuse(std::size_t entry_begin) {
+	_buffer.resize(entry_begin);
+	_error = Error::UnwritableString;
+}
+
+///
+/// @brief Writes string quoted and escaped, returns false part way if it holds a byte the grammar rejects
+///
+bool Writer::_write_string(std::string_view string) {
+	_buffer.push_back('"');
+	const char* cursor = string.data();
+	const char* end = cursor + string.size();
+	while (true) {
+		const char* run_end = plain_run_end(cursor, end);
+		_buffer.append(cursor, run_end);
+		if (run_end == end) break;
+
+		const char symbol = escape_symbol(*run_end);
+		if (!symbol) return false;
+		_buffer.push_back('\\');
+		_buffer.push_back(symbol);
+		cursor = run_end + 1;
+	}
+	_buffer.push_back('"');
+	return true;
+}
+
+///
+/// @brief Writes value bare, negative values are quoted as grammar::IntegerValue takes no sign
+///
+void Writer::_write_int(std::int32_t value) {
+	char digits[16];
+	const auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+	if (value < 0) {
+		_write_string(std::string_view(digits, static_cast<std::size_t>(end - digits)));
+	} else {
+		_buffer.append(digits, end);
+	}
+}
+
+///
+/// @brief Writes the shortest text that reads back as the same value
+///
+/// A fraction is appended where needed so that the value reads back as grammar::FloatValue
+/// instead of an integer, non-finite values have no bare form and are quoted.
+///
+void Writer::_write_float(std::float_t value) {
+	char digits[64];
+	const auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+	const std::string_view text(digits, static_cast<std::size_t>(end - digits));
+	if (!std::isfinite(value)) {
+		_write_string(text);
+		return;
+	}
+
+	_buffer.append(text);
+	if (text.find_first_of(".e") == std::string_view::npos) {
+		_buffer.append(".0");
+	}
+}
+
+void Writer::_maybe_flush() {
+	if (_sink && _buffer.size() >= _flush_size) flush();
+}
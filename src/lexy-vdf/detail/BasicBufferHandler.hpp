@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstddef>
 #include <optional>
+#include <utility>
 
 #include <lexy-vdf/ParseError.hpp>
 #include <lexy-vdf/detail/OptionalConstexpr.hpp>
@@ -10,6 +12,7 @@
 #include <lexy/input/file.hpp>
 
 #include "detail/Errors.hpp"
+#include "detail/Utf16.hpp"
 
 namespace lexy_vdf::detail {
 	template<typename Encoding = lexy::default_encoding, typename MemoryResource = void>
@@ -37,7 +40,13 @@ namespace lexy_vdf::detail {
 				return lexy_vdf::errors::make_no_file_error(path);
 			}
 
-			_buffer = file.buffer();
+			_buffer = std::move(file).buffer();
+			if constexpr (sizeof(typename Encoding::char_type) == 1) {
+				const unsigned char* bytes = reinterpret_cast<const unsigned char*>(_buffer.data());
+				if (auto endian = detect_utf16_bom(bytes, _buffer.size())) {
+					_buffer = _transcode_utf16(bytes + 2, _buffer.size() - 2, *endian);
+				}
+			}
 			return std::nullopt;
 		}
 
@@ -47,5 +56,13 @@ namespace lexy_vdf::detail {
 
 	protected:
 		lexy::buffer<Encoding, MemoryResource> _buffer;
+
+		/// The grammar only reads UTF-8, so UTF-16 files are transcoded once into an exactly sized buffer.
+		static lexy::buffer<Encoding, MemoryResource> _transcode_utf16(const unsigned char* data, std::size_t size, Utf16Endian endian) {
+			const Utf16Transcoder transcoder(data, size, endian);
+			typename lexy::buffer<Encoding, MemoryResource>::builder builder(transcoder.measure());
+			transcoder.convert(reinterpret_cast<char*>(builder.data()));
+			return std::move(builder).finish();
+		}
 	};
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
+#include <cstddef>
 #include <iostream>
 #include <ostream>
+#include <string>
 
 #include <lexy-vdf/detail/BasicParser.hpp>
 
@@ -26,6 +28,14 @@ void BasicParser::set_error_log_to(std::basic_ostream<char>& stream) {
 	_error_stream = stream;
 }
 
+void BasicParser::set_diagnostic_sink(DiagnosticSink* sink) {
+	_diagnostic_sink = sink;
+}
+
+DiagnosticSink* BasicParser::get_diagnostic_sink() const {
+	return _diagnostic_sink;
+}
+
 bool BasicParser::has_error() const {
 	return !_errors.empty();
 }
@@ -44,4 +54,90 @@ const std::vector<lexy_vdf::ParseError>& BasicParser::get_errors() const {
 
 const std::vector<lexy_vdf::ParseWarning>& BasicParser::get_warnings() const {
 	return _warnings;
+}
+BasicParser::DiagnosticScope::DiagnosticScope(BasicParser& parser)
+	: _parser(parser), _error_count(parser._errors.size()), _warning_count(parser._warnings.size()), _current(parser._diagnostic_sink) {}
+
+BasicParser::DiagnosticScope::~DiagnosticScope() {
+	_parser._report_diagnostics(_error_count, _warning_count);
+}
+
+///
+/// @brief Whether parse errors have to be formatted with their source visualization
+///
+/// A sink only receives the located message, and the null error log would discard the text, so
+/// in both cases lexy is told to skip visualizing the source.
+///
+bool BasicParser::_visualizes_errors() const {
+	return !_diagnostic_sink && &_error_stream.get() != &detail::cnull;
+}
+
+void BasicParser::_report_load_error() {
+	const ParseError& error = _errors.back();
+	if (!_diagnostic_sink) {
+		_error_stream.get() << "Error: " << error.message << '\n';
+		return;
+	}
+	if (_diagnostic_sink->discards()) return;
+
+	_diagnostic_sink->report(Diagnostic {
+		error.type == ParseError::Type::Fatal ? Diagnostic::Severity::Fatal : Diagnostic::Severity::Error,
+		_file_path ? std::string(_file_path) : std::string(),
+		0,
+		0,
+		error.message,
+		error.error_value,
+	});
+}
+
+void BasicParser::_log_errors(std::size_t first_error) {
+	if (!_visualizes_errors()) return;
+
+	const std::string file = _file_path ? std::string(_file_path) : std::string();
+	std::string text;
+	for (std::size_t index = first_error; index < _errors.size(); index++) {
+		const ParseError& error = _errors[index];
+		write_diagnostic(text, Diagnostic {
+			error.type == ParseError::Type::Fatal ? Diagnostic::Severity::Fatal : Diagnostic::Severity::Error,
+			file,
+			error.start_line,
+			error.start_column,
+			error.message,
+			error.error_value,
+		});
+	}
+	_error_stream.get() << text;
+}
+
+///
+/// @brief Hands the errors and warnings from the given indices on to the sink
+///
+/// Warnings carry no position, they are reported against the parsed file.
+///
+void BasicParser::_report_diagnostics(std::size_t first_error, std::size_t first_warning) {
+	if (!_diagnostic_sink || _diagnostic_sink->discards()) return;
+
+	const std::string file = _file_path ? std::string(_file_path) : std::string();
+	for (std::size_t index = first_error; index < _errors.size(); index++) {
+		const ParseError& error = _errors[index];
+		_diagnostic_sink->report(Diagnostic {
+			error.type == ParseError::Type::Fatal ? Diagnostic::Severity::Fatal : Diagnostic::Severity::Error,
+			file,
+			error.start_line,
+			error.start_column,
+			error.message,
+			error.error_value,
+		});
+	}
+	for (std::size_t index = first_warning; index < _warnings.size(); index++) {
+		const ParseWarning& warning = _warnings[index];
+		_diagnostic_sink->report(Diagnostic {
+			Diagnostic::Severity::Warning,
+			file,
+			0,
+			0,
+			warning.message,
+			warning.warning_value,
+		});
+	}
 }
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <lexy-vdf/ConditionSet.hpp>
+
+namespace lexy_vdf::detail {
+	/// Value of a conditional expression while it is parsed.
+	///
+	/// The result is computed eagerly from the interned bits, the postfix program is only
+	/// recorded for Parser::set_keep_conditionals and lives in fixed storage so that
+	/// evaluating an attribute never allocates.
+	struct Condition {
+		using Op = ConditionPredicate::Op;
+		using Instruction = ConditionPredicate::Instruction;
+
+		static constexpr std::size_t capacity = 30;
+
+		bool value;
+		bool overflow;
+		std::uint8_t size;
+		std::array<Instruction, capacity> program;
+
+		static constexpr Condition operand(ConditionSet::Index index, bool value) {
+			Condition result { value, false, 1, {} };
+			result.program[0] = { Op::Test, index };
+			return result;
+		}
+
+		constexpr void negate() {
+			value = !value;
+			push({ Op::Not, 0 });
+		}
+
+		constexpr void combine(Op op, const Condition& rhs) {
+			value = op == Op::And ? value && rhs.value : value || rhs.value;
+			overflow |= rhs.overflow;
+			for (std::uint8_t index = 0; index < rhs.size; index++) {
+				push(rhs.program[index]);
+			}
+			push({ op, 0 });
+		}
+
+		/// Operands refer to indices of conditions, the predicate refers to them by name instead.
+		ConditionPredicate compile(const ConditionSet& conditions) const {
+			std::vector<Instruction> instructions(program.begin(), program.begin() + size);
+			std::vector<ConditionSet::Index> indices;
+			std::vector<std::string> names;
+			for (Instruction& instruction : instructions) {
+				if (instruction.op != Op::Test) continue;
+
+				std::size_t operand = 0;
+				while (operand < indices.size() && indices[operand] != instruction.operand) {
+					operand++;
+				}
+				if (operand == indices.size()) {
+					indices.push_back(instruction.operand);
+					names.emplace_back(instruction.operand == ConditionSet::unknown ? std::string_view {} : conditions.name(instruction.operand));
+				}
+				instruction.operand = static_cast<std::uint8_t>(operand);
+			}
+			return ConditionPredicate { std::move(instructions), std::move(names) };
+		}
+
+	private:
+		constexpr void push(Instruction instruction) {
+			if (size == capacity) {
+				overflow = true;
+				return;
+			}
+			program[size++] = instruction;
+		}
+	};
+}
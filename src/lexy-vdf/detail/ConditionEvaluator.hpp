@@ -0,0 +1,112 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+#include "detail/UnquotedToken.hpp"
+
+namespace lexy_vdf::detail {
+	/// Evaluates the text of a conditional attribute such as "[$WIN32 && !$X360]".
+	///
+	/// Mirrors grammar::ConditionalExpression for callers that scan instead of running the grammar,
+	/// has_condition is invoked with each operand name without its '$'. Like the grammar, '!' only
+	/// applies to an operand or a parenthesized expression and names are identifiers.
+	template<typename HasCondition>
+	class ConditionEvaluator {
+	public:
+		ConditionEvaluator(std::string_view expression, const HasCondition& has_condition)
+			: _source(expression),
+			  _has_condition(has_condition) {}
+
+		std::optional<bool> evaluate() {
+			skip_space();
+			if (!consume('[')) return std::nullopt;
+			std::optional<bool> result = parse_or();
+			skip_space();
+			if (!result || !consume(']')) return std::nullopt;
+			skip_space();
+			if (_position != _source.size()) return std::nullopt;
+			return result;
+		}
+
+	private:
+		std::string_view _source;
+		const HasCondition& _has_condition;
+		std::size_t _position = 0;
+
+		constexpr void skip_space() {
+			while (_position < _source.size() && (_source[_position] == ' ' || _source[_position] == '\t' || _source[_position] == '\r' || _source[_position] == '\n')) {
+				_position++;
+			}
+		}
+
+		constexpr bool consume(char c) {
+			if (_position < _source.size() && _source[_position] == c) {
+				_position++;
+				return true;
+			}
+			return false;
+		}
+
+		constexpr bool consume(std::string_view text) {
+			if (_source.substr(_position, text.size()) == text) {
+				_position += text.size();
+				return true;
+			}
+			return false;
+		}
+
+		std::optional<bool> parse_or() {
+			std::optional<bool> result = parse_and();
+			while (result) {
+				skip_space();
+				if (!consume("||")) break;
+				std::optional<bool> rhs = parse_and();
+				if (!rhs) return std::nullopt;
+				result = *result || *rhs;
+			}
+			return result;
+		}
+
+		std::optional<bool> parse_and() {
+			std::optional<bool> result = parse_not();
+			while (result) {
+				skip_space();
+				if (!consume("&&")) break;
+				std::optional<bool> rhs = parse_not();
+				if (!rhs) return std::nullopt;
+				result = *result && *rhs;
+			}
+			return result;
+		}
+
+		std::optional<bool> parse_not() {
+			skip_space();
+			if (consume('!')) {
+				std::optional<bool> operand = parse_atom();
+				if (!operand) return std::nullopt;
+				return !*operand;
+			}
+			return parse_atom();
+		}
+
+		std::optional<bool> parse_atom() {
+			skip_space();
+			if (consume('(')) {
+				std::optional<bool> result = parse_or();
+				skip_space();
+				if (!consume(')')) return std::nullopt;
+				return result;
+			}
+			if (!consume('$')) return std::nullopt;
+
+			// grammar::ConditionName is the identifier rule of grammar::PlainValue
+			const std::string_view rest = _source.substr(_position);
+			const UnquotedToken name = match_unquoted(rest);
+			if (name.kind != UnquotedToken::Kind::Plain) return std::nullopt;
+			const std::size_t length = static_cast<std::size_t>(name.end - rest.data());
+			_position += length;
+			return static_cast<bool>(_has_condition(rest.substr(0, length)));
+		}
+	};
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+
+namespace lexy_vdf::detail {
+	// Sourced from https://github.com/ValveSoftware/source-sdk-2013/blob/0d8dceea4310fde5706b3ce1c70609d72a38efdf/sp/src/tier1/KeyValues.cpp
+	// Platform conditions sourced from https://github.com/ValveSoftware/source-sdk-2013/blob/0d8dceea4310fde5706b3ce1c70609d72a38efdf/sp/src/public/tier0/platform.h#L85
+#if defined(_X360)
+	inline constexpr std::array<std::string_view, 1> default_conditions { "X360" };
+#elif defined(WIN32)
+	inline constexpr std::array<std::string_view, 2> default_conditions { "WIN32", "WINDOWS" };
+#elif defined(__APPLE__)
+	inline constexpr std::array<std::string_view, 3> default_conditions { "WIN32", "POSIX", "OSX" };
+#elif defined(__linux__)
+	inline constexpr std::array<std::string_view, 3> default_conditions { "WIN32", "POSIX", "LINUX" };
+#else
+	// Any other default conditions
+	inline constexpr std::array<std::string_view, 0> default_conditions {};
+#endif
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <string>
+#include <string_view>
+
 #include <lexy-vdf/ParseError.hpp>
 
 namespace lexy_vdf::errors {
@@ -13,4 +16,26 @@ namespace lexy_vdf::errors {
 
 		return ParseError { ParseError::Type::Fatal, message, 1 };
 	}
+
+	/// Error at position for the scanning readers that work without the grammar.
+	inline const ParseError make_malformed_error(std::string_view source, const char* position, std::string_view production_name,
+		std::string_view message = "malformed statement") {
+		const char* line_begin = source.data();
+		unsigned int line = 1;
+		for (const char* cursor = source.data(); cursor != position; cursor++) {
+			if (*cursor == '\n') {
+				line++;
+				line_begin = cursor + 1;
+			}
+		}
+		const unsigned int column = static_cast<unsigned int>(position - line_begin) + 1;
+		return ParseError {
+			ParseError::Type::Fatal,
+			std::string(message),
+			0,
+			ParseData { std::string(production_name), line, column },
+			line,
+			column,
+		};
+	}
 }
\ No newline at end of file
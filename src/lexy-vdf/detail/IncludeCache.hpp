@@ -0,0 +1,45 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <lexy-vdf/Parser.hpp>
+#include <lexy-vdf/StringHash.hpp>
+
+namespace lexy_vdf::detail {
+	/// Include files loaded ahead of a parse, KeyValues::MergeWith and merge_base parse these instead of reading the file.
+	///
+	/// A cache is active on the constructing thread until destroyed, keyed by the path as written
+	/// in the include statement.
+	class IncludeCache {
+	public:
+		using Files = std::unordered_map<std::string, Parser, string_hash, std::equal_to<>>;
+
+		explicit IncludeCache(Files& files) : _previous(_active) {
+			_active = &files;
+		}
+
+		~IncludeCache() {
+			_active = _previous;
+		}
+
+		IncludeCache(const IncludeCache&) = delete;
+		IncludeCache& operator=(const IncludeCache&) = delete;
+
+		static bool is_active() {
+			return _active != nullptr;
+		}
+
+		static Parser* find(std::string_view path) {
+			if (!_active) return nullptr;
+			Files::iterator it = _active->find(path);
+			return it == _active->end() ? nullptr : &it->second;
+		}
+
+	private:
+		static inline thread_local Files* _active = nullptr;
+		Files* _previous;
+	};
+}
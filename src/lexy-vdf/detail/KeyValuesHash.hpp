@@ -0,0 +1,116 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include <lexy-vdf/KeyValues.hpp>
+#include <lexy-vdf/detail/PointerHash.hpp>
+
+namespace lexy_vdf::detail {
+	using SubtreeHashCache = std::unordered_map<const KeyValues*, std::size_t, PointerHash<KeyValues>>;
+
+	constexpr std::size_t mix_hash(std::size_t value) {
+		// splitmix64 finalizer, truncated on 32 bit targets
+		std::uint64_t x = value;
+		x ^= x >> 30;
+		x *= 0xbf58476d1ce4e5b9ULL;
+		x ^= x >> 27;
+		x *= 0x94d049bb133111ebULL;
+		x ^= x >> 31;
+		return static_cast<std::size_t>(x);
+	}
+
+	inline std::size_t hash_key_values(const KeyValues& key_values, SubtreeHashCache* cache);
+
+	constexpr std::size_t hash_seed(std::size_t variant_index) {
+		return mix_hash(variant_index + 1);
+	}
+
+	inline std::size_t hash_string(std::string_view value) {
+		return hash_seed(1) ^ std::hash<std::string_view> {}(value);
+	}
+
+	inline std::size_t hash_int(std::int32_t value) {
+		return hash_seed(2) ^ mix_hash(static_cast<std::uint32_t>(value));
+	}
+
+	inline std::size_t hash_float(std::float_t value) {
+		// -0.0 and 0.0 compare equal, so they must hash equal
+		if (value == 0) return hash_seed(3);
+		return hash_seed(3) ^ mix_hash(static_cast<std::size_t>(std::bit_cast<std::uint64_t>(static_cast<double>(value))));
+	}
+
+	inline std::size_t hash_block(std::size_t block_hash) {
+		return hash_seed(4) ^ block_hash;
+	}
+
+	constexpr std::size_t hash_block_seed(std::size_t size) {
+		return mix_hash(size);
+	}
+
+	inline std::size_t hash_entry(std::string_view key, std::size_t value_hash) {
+		return mix_hash(std::hash<std::string_view> {}(key) ^ mix_hash(value_hash));
+	}
+
+	inline std::size_t hash_value(const ValueType& value, SubtreeHashCache* cache) {
+		return std::visit([&](auto&& arg) -> std::size_t {
+			using T = std::decay_t<decltype(arg)>;
+			if constexpr (std::is_same_v<T, std::monostate>) {
+				return hash_seed(0);
+			} else if constexpr (std::is_same_v<T, std::string>) {
+				return hash_string(arg);
+			} else if constexpr (std::is_same_v<T, std::int32_t>) {
+				return hash_int(arg);
+			} else if constexpr (std::is_same_v<T, std::float_t>) {
+				return hash_float(arg);
+			} else if constexpr (std::is_same_v<T, KeyValues>) {
+				return hash_block(hash_key_values(arg, cache));
+			}
+		},
+			value);
+	}
+
+	inline std::size_t hash_predicate(const ConditionPredicate& predicate) {
+		std::size_t result = mix_hash(predicate.program().size());
+		for (const ConditionPredicate::Instruction& instruction : predicate.program()) {
+			result = mix_hash(result ^ (static_cast<std::size_t>(instruction.op) << 8 | instruction.operand));
+		}
+		for (const std::string& name : predicate.names()) {
+			result = mix_hash(result ^ std::hash<std::string_view> {}(name));
+		}
+		return result;
+	}
+
+	/// Conditional entries resolve first wins, so unlike the entries of a block their order is hashed.
+	inline std::size_t hash_conditionals(const std::vector<ConditionalEntry>& conditionals, SubtreeHashCache* cache) {
+		std::size_t result = hash_seed(5);
+		for (const ConditionalEntry& entry : conditionals) {
+			result = mix_hash(result ^ hash_entry(entry.key, hash_value(entry.value, cache) ^ hash_predicate(entry.predicate)));
+		}
+		return result;
+	}
+
+	/// Order independent hash of a block, memoized per subtree when a cache is supplied.
+	inline std::size_t hash_key_values(const KeyValues& key_values, SubtreeHashCache* cache) {
+		if (cache) {
+			if (auto found = cache->find(&key_values); found != cache->end()) return found->second;
+		}
+
+		std::size_t result = hash_block_seed(key_values.size());
+		for (const auto& [key, value] : key_values) {
+			result += hash_entry(key, hash_value(value, cache));
+		}
+		if (!key_values.conditionals().empty()) result += hash_conditionals(key_values.conditionals(), cache);
+
+		if (cache) cache->emplace(&key_values, result);
+		return result;
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <type_traits>
+
+#include <lexy/dsl/base.hpp>
+
+#include "detail/Profiler.hpp"
+
+namespace lexy_vdf::detail::lexydsl {
+	/// Wraps Rule so that the active Profiler sees it enter and leave, keeps Rule a branch if it is one.
+	template<ProfileId Id, typename Rule>
+	struct Profile : std::conditional_t<lexy::is_branch_rule<Rule>, lexy::dsl::branch_base, lexy::dsl::rule_base> {
+		template<typename Reader>
+		static constexpr const char* position_of(const Reader& reader) {
+			if constexpr (std::is_same_v<typename Reader::iterator, const char*>) {
+				return reader.position();
+			} else {
+				return nullptr;
+			}
+		}
+
+		template<typename NextParser>
+		struct leave {
+			template<typename Context, typename Reader, typename... Args>
+			LEXY_PARSER_FUNC static bool parse(Context& context, Reader& reader, Args&&... args) {
+				Profiler::active()->leave(Id, position_of(reader));
+				return NextParser::parse(context, reader, LEXY_FWD(args)...);
+			}
+		};
+
+		template<typename NextParser>
+		struct p {
+			template<typename Context, typename Reader, typename... Args>
+			LEXY_PARSER_FUNC static bool parse(Context& context, Reader& reader, Args&&... args) {
+				Profiler* profiler = Profiler::active();
+				if (!profiler) return lexy::parser_for<Rule, NextParser>::parse(context, reader, LEXY_FWD(args)...);
+
+				const std::size_t depth = profiler->enter(position_of(reader));
+				const bool result = lexy::parser_for<Rule, leave<NextParser>>::parse(context, reader, LEXY_FWD(args)...);
+				profiler->unwind(depth);
+				return result;
+			}
+		};
+
+		template<typename Reader>
+		struct bp {
+			lexy::branch_parser_for<Rule, Reader> rule;
+			const char* begin;
+
+			template<typename ControlBlock>
+			constexpr bool try_parse(const ControlBlock* control_block, const Reader& reader) {
+				begin = position_of(reader);
+				return rule.try_parse(control_block, reader);
+			}
+
+			template<typename Context>
+			constexpr void cancel(Context& context) {
+				rule.cancel(context);
+			}
+
+			template<typename NextParser, typename Context, typename... Args>
+			LEXY_PARSER_FUNC bool finish(Context& context, Reader& reader, Args&&... args) {
+				Profiler* profiler = Profiler::active();
+				if (!profiler) return rule.template finish<NextParser>(context, reader, LEXY_FWD(args)...);
+
+				const std::size_t depth = profiler->enter(begin);
+				const bool result = rule.template finish<leave<NextParser>>(context, reader, LEXY_FWD(args)...);
+				profiler->unwind(depth);
+				return result;
+			}
+		};
+	};
+
+	template<ProfileId Id, typename Rule>
+	constexpr auto profile(Rule) {
+		return Profile<Id, Rule> {};
+	}
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <lexy/dsl/base.hpp>
+#include <lexy/dsl/whitespace.hpp>
+#include <lexy/error.hpp>
+
+#include "detail/Unescape.hpp"
+
+namespace lexy_vdf::detail::lexydsl {
+	/// Byte level replacement for lexy::dsl::quoted(-lexy::dsl::unicode::control, backslash_escape) with a string sink.
+	///
+	/// The string is validated in a single pass, runs of plain ASCII are skipped in bulk by
+	/// plain_string_run when the parse state records where the input ends and a byte at a time
+	/// otherwise, only bytes from 0x80 up are decoded as code points. The body is then decoded
+	/// by unescape_append which copies the runs between escapes in bulk. Errors are reported like
+	/// lexy::dsl::quoted does: invalid code points and escapes are recovered from, a missing
+	/// closing quote fails the rule.
+	struct QuotedString : lexy::dsl::branch_base {
+		template<typename NextParser>
+		struct p {
+			template<typename Reader>
+			static constexpr bool is_quote(const Reader& reader) {
+				return reader.peek() == Reader::encoding::to_int_type('"');
+			}
+
+			/// End of the input if the parse state has a source_end, bulk scans must not read past it.
+			template<typename Context>
+			static constexpr const char* input_end(const Context& context) {
+				if constexpr (requires { context.control_block->parse_state->source_end; }) {
+					return context.control_block->parse_state ? context.control_block->parse_state->source_end : nullptr;
+				} else {
+					return nullptr;
+				}
+			}
+
+			/// Consumes one code point, returns false if it is malformed or a control character.
+			template<typename Reader>
+			static constexpr bool match_code_point(Reader& reader) {
+				struct Bytes {
+					Reader& reader;
+
+					constexpr int peek() const {
+						const auto c = reader.peek();
+						return c == Reader::encoding::eof() ? -1 : static_cast<unsigned char>(c);
+					}
+					constexpr void bump() { reader.bump(); }
+				} bytes { reader };
+				return match_string_code_point(bytes);
+			}
+
+			template<typename Context, typename Reader, typename... Args>
+			LEXY_PARSER_FUNC static bool parse(Context& context, Reader& reader, Args&&... args) {
+				static_assert(std::is_pointer_v<typename Reader::iterator>, "QuotedString needs contiguous input");
+
+				const auto open = reader.position();
+				if (!is_quote(reader)) {
+					auto err = lexy::error<Reader, lexy::expected_char_class>(open, "quoted string");
+					context.on(lexy::_ev::error {}, err);
+					return false;
+				}
+				reader.bump();
+
+				const auto body_begin = reader.position();
+				const char* const end = input_end(context);
+				bool valid = true;
+				while (true) {
+					if (end) {
+						for (std::size_t run = plain_string_run(reader.position(), end); run != 0; run--) {
+							reader.bump();
+						}
+					}
+
+					const auto position = reader.position();
+					const auto c = reader.peek();
+					if (c == Reader::encoding::eof()) {
+						auto err = lexy::error<Reader, lexy::missing_delimiter>(open, position);
+						context.on(lexy::_ev::error {}, err);
+						return false;
+					}
+
+					if (c == Reader::encoding::to_int_type('"')) break;
+					if (is_plain_string_byte(static_cast<unsigned char>(c))) {
+						reader.bump();
+					} else if (c == Reader::encoding::to_int_type('\\')) {
+						reader.bump();
+						const auto symbol = reader.peek();
+						if (symbol != Reader::encoding::eof() && unescape_symbol(static_cast<char>(symbol))) {
+							reader.bump();
+						} else {
+							auto err = lexy::error<Reader, lexy::invalid_escape_sequence>(position, reader.position());
+							context.on(lexy::_ev::error {}, err);
+							valid = false;
+						}
+					} else if (!match_code_point(reader)) {
+						auto err = lexy::error<Reader, lexy::expected_char_class>(position, "code-point");
+						context.on(lexy::_ev::error {}, err);
+						valid = false;
+					}
+				}
+				const std::string_view body(body_begin, static_cast<std::size_t>(reader.position() - body_begin));
+				reader.bump();
+
+				std::string value;
+				if (valid) unescape_append(body, value);
+				return lexy::whitespace_parser<Context, NextParser>::parse(context, reader, LEXY_FWD(args)..., LEXY_MOV(value));
+			}
+		};
+
+		template<typename Reader>
+		struct bp {
+			constexpr bool try_parse(const void*, const Reader& reader) {
+				return p<void>::is_quote(reader);
+			}
+
+			template<typename Context>
+			constexpr void cancel(Context&) {}
+
+			template<typename NextParser, typename Context, typename... Args>
+			LEXY_PARSER_FUNC bool finish(Context& context, Reader& reader, Args&&... args) {
+				return p<NextParser>::parse(context, reader, LEXY_FWD(args)...);
+			}
+		};
+	};
+
+	constexpr auto quoted_string = QuotedString {};
+}
@@ -20,11 +20,13 @@ namespace lexy_vdf::detail {
 		OutputIterator _iter;
 		lexy::visualization_options _opts;
 		const char* _path;
+		bool _visualize = true;
 
 		struct _sink {
 			OutputIterator _iter;
 			lexy::visualization_options _opts;
 			const char* _path;
+			bool _visualize;
 			std::size_t _count;
 			std::vector<ParseError> _errors;
 
@@ -32,7 +34,7 @@ namespace lexy_vdf::detail {
 
 			template<typename Input, typename Reader, typename Tag>
 			void operator()(const lexy::error_context<Input>& context, const lexy::error<Reader, Tag>& error) {
-				_iter = lexy_ext::_detail::write_error(_iter, context, error, _opts, _path);
+				if (_visualize) _iter = lexy_ext::_detail::write_error(_iter, context, error, _opts, _path);
 				++_count;
 
 				// Convert the context location and error location into line/column information.
@@ -72,29 +74,34 @@ namespace lexy_vdf::detail {
 			}
 
 			return_type finish() && {
-				if (_count != 0)
+				if (_visualize && _count != 0)
 					*_iter++ = '\n';
 				return _errors;
 			}
 		};
 		constexpr auto sink() const {
-			return _sink { _iter, _opts, _path, 0 };
+			return _sink { _iter, _opts, _path, _visualize, 0 };
 		}
 
 		/// Specifies a path that will be printed alongside the diagnostic.
 		constexpr _ReportError path(const char* path) const {
-			return { _iter, _opts, path };
+			return { _iter, _opts, path, _visualize };
 		}
 
 		/// Specifies an output iterator where the errors are written to.
 		template<typename OI>
 		constexpr _ReportError<OI> to(OI out) const {
-			return { out, _opts, _path };
+			return { out, _opts, _path, _visualize };
 		}
 
 		/// Overrides visualization options.
 		constexpr _ReportError opts(lexy::visualization_options opts) const {
-			return { _iter, opts, _path };
+			return { _iter, opts, _path, _visualize };
+		}
+
+		/// Skips writing the source visualization, the returned errors are still collected.
+		constexpr _ReportError visualize(bool visualize) const {
+			return { _iter, _opts, _path, visualize };
 		}
 	};
 
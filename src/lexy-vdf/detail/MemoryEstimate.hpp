@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace lexy_vdf::detail {
+	/// Approximate allocation overhead of std::make_shared, the reference counts share the object's allocation.
+	constexpr std::size_t shared_overhead = 2 * sizeof(long);
+
+	/// Heap bytes held by a string of length characters, 0 while it fits the small string buffer.
+	inline std::size_t string_heap_bytes(std::size_t length) {
+		static const std::size_t small_capacity = std::string().capacity();
+		return length > small_capacity ? length + 1 : 0;
+	}
+
+	inline std::size_t string_heap_bytes(const std::string& string) {
+		const char* data = string.data();
+		const char* object = reinterpret_cast<const char*>(&string);
+		if (data >= object && data < object + sizeof(std::string)) return 0;
+		return string.capacity() + 1;
+	}
+
+	/// Node layout of the node based standard unordered containers: chain link, element and cached hash.
+	template<typename Map>
+	constexpr std::size_t unordered_node_bytes() {
+		return sizeof(void*) + sizeof(typename Map::value_type) + sizeof(std::size_t);
+	}
+
+	/// A single bucket lives inside the container, larger bucket arrays are allocated.
+	template<typename Map>
+	std::size_t unordered_bucket_bytes(const Map& map) {
+		return map.bucket_count() > 1 ? map.bucket_count() * sizeof(void*) : 0;
+	}
+}
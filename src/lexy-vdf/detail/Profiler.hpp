@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <lexy-vdf/ParseProfile.hpp>
+
+namespace lexy_vdf::detail {
+	enum class ProfileId : unsigned char {
+		File,
+		KeyValueStatement,
+		ListValue,
+		IncludeStatement,
+		BaseStatement,
+		ConditionalAttribute,
+		StringValue,
+		PlainValue,
+		FloatValue,
+		IntegerValue,
+		Count
+	};
+
+	inline constexpr std::array<std::string_view, static_cast<std::size_t>(ProfileId::Count)> profile_names {
+		"File",
+		"KeyValueStatement",
+		"ListValue",
+		"IncludeStatement",
+		"BaseStatement",
+		"ConditionalAttribute",
+		"StringValue",
+		"PlainValue",
+		"FloatValue",
+		"IntegerValue",
+	};
+
+	/// Collects a ParseProfile for the parse running on this thread.
+	///
+	/// Productions enter with their start position and leave from the continuation of their rule,
+	/// a production that fails never leaves and is dropped by unwind.
+	class Profiler {
+	public:
+		using clock = std::chrono::steady_clock;
+
+		explicit Profiler(ParseProfile& profile) : _profile(profile), _previous(_active), _start(clock::now()) {
+			_active = this;
+			_profile.clear();
+			_profile.productions.resize(profile_names.size());
+			for (std::size_t index = 0; index < profile_names.size(); index++) {
+				_profile.productions[index].name = profile_names[index];
+			}
+		}
+
+		~Profiler() {
+			_profile.total_time = clock::now() - _start;
+			_profile.collected = true;
+			_active = _previous;
+		}
+
+		Profiler(const Profiler&) = delete;
+		Profiler& operator=(const Profiler&) = delete;
+
+		static Profiler* active() {
+			return _active;
+		}
+
+		std::size_t enter(const char* position) {
+			_frames.push_back({ position, clock::now() });
+			return _frames.size() - 1;
+		}
+
+		void leave(ProfileId id, const char* position) {
+			if (_frames.empty()) return;
+			const Frame frame = _frames.back();
+			_frames.pop_back();
+			ParseProfile::Production& production = _profile.productions[static_cast<std::size_t>(id)];
+			production.count++;
+			production.bytes += static_cast<std::size_t>(position - frame.position);
+			production.time += clock::now() - frame.start;
+		}
+
+		void unwind(std::size_t depth) {
+			if (_frames.size() > depth) _frames.resize(depth);
+		}
+
+		void add_include(std::string_view path, clock::duration time) {
+			_profile.includes.push_back({ std::string(path), std::chrono::duration_cast<std::chrono::nanoseconds>(time) });
+		}
+
+		void add_insert(clock::duration time) {
+			_profile.inserts++;
+			_profile.insert_time += time;
+		}
+
+	private:
+		struct Frame {
+			const char* position;
+			clock::time_point start;
+		};
+
+		ParseProfile& _profile;
+		Profiler* _previous;
+		clock::time_point _start;
+		std::vector<Frame> _frames;
+
+		static inline thread_local Profiler* _active = nullptr;
+	};
+
+	/// Times a scope into the active profiler, costs a branch when no profiler is active.
+	template<typename Record>
+	class ProfileTimer {
+	public:
+		explicit ProfileTimer(Record record) : _profiler(Profiler::active()), _record(record) {
+			if (_profiler) _start = Profiler::clock::now();
+		}
+
+		~ProfileTimer() {
+			if (_profiler) _record(*_profiler, Profiler::clock::now() - _start);
+		}
+
+		ProfileTimer(const ProfileTimer&) = delete;
+		ProfileTimer& operator=(const ProfileTimer&) = delete;
+
+	private:
+		Profiler* _profiler;
+		Record _record;
+		Profiler::clock::time_point _start;
+	};
+}
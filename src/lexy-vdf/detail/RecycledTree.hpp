@@ -0,0 +1,52 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include <lexy-vdf/KeyValues.hpp>
+
+namespace lexy_vdf::detail {
+	/// Tree of an earlier parse that the root of the next grammar::File parse on this thread is built in.
+	///
+	/// The root takes over the tree's bucket array instead of growing its own. A scope is active on
+	/// the constructing thread until destroyed, a scope without a tree keeps a parse nested in an
+	/// outer one, like that of an include, from taking the outer tree.
+	class RecycledTree {
+	public:
+		/// Initial value of the root's fold, converts to the recycled tree emptied.
+		struct Root {
+			operator KeyValues() const {
+				return take();
+			}
+		};
+
+		explicit RecycledTree(std::unique_ptr<KeyValues>* tree) : _previous(_active) {
+			_active = tree;
+		}
+
+		~RecycledTree() {
+			_active = _previous;
+		}
+
+		RecycledTree(const RecycledTree&) = delete;
+		RecycledTree& operator=(const RecycledTree&) = delete;
+
+		static KeyValues take() {
+			if (!_active || !*_active) return KeyValues();
+			KeyValues tree = std::move(**_active);
+			if (!tree.empty() || !tree.conditionals().empty()) tree.clear();
+			return tree;
+		}
+
+		/// Moves the parsed root back into the recycled tree and hands it out, a new tree without one.
+		static KeyValues* adopt(KeyValues&& values) {
+			if (!_active || !*_active) return new KeyValues(std::move(values));
+			**_active = std::move(values);
+			return _active->release();
+		}
+
+	private:
+		static inline thread_local std::unique_ptr<KeyValues>* _active = nullptr;
+		std::unique_ptr<KeyValues>* _previous;
+	};
+}
@@ -0,0 +1,51 @@
+#include <string_view>
+
+#include "detail/ConditionEvaluator.hpp"
+#include "detail/ScannedValidation.hpp"
+#include "detail/StatementScanner.hpp"
+#include "detail/Unescape.hpp"
+#include "detail/UnquotedToken.hpp"
+
+using namespace lexy_vdf;
+using namespace lexy_vdf::detail;
+
+bool detail::is_valid_key(const ScannedToken& key) {
+	if (key.kind == ScannedToken::Kind::String) return is_valid_string_body(key.string_body());
+	const UnquotedToken token = match_unquoted(key.text());
+	return token.kind == UnquotedToken::Kind::Plain && token.covers(key.text());
+}
+
+bool detail::is_valid_condition(std::string_view condition) {
+	auto has_condition = [](std::string_view) {
+		return false;
+	};
+	return ConditionEvaluator(condition, has_condition).evaluate().has_value();
+}
+
+const char* detail::find_malformed_value(const ScannedToken& value) {
+	switch (value.kind) {
+		case ScannedToken::Kind::OpenBrace: return find_malformed(std::string_view(value.begin + 1, static_cast<std::size_t>(value.end - value.begin - 2)));
+		case ScannedToken::Kind::String: return is_valid_string_body(value.string_body()) ? nullptr : value.begin;
+		default: return match_unquoted(value.text()).covers(value.text()) ? nullptr : value.begin;
+	}
+}
+
+const char* detail::find_malformed(std::string_view range) {
+	using Status = StatementScanner::Status;
+
+	StatementScanner scanner(range);
+	StatementScanner::Statement statement;
+	Status status;
+	while ((status = scanner.next(statement)) == Status::Ok) {
+		if (statement.is_include()) {
+			if (!is_valid_string_body(statement.value.string_body())) return statement.value.begin;
+			continue;
+		}
+		if (!is_valid_key(statement.key)) return statement.key.begin;
+		if (statement.has_condition && !is_valid_condition(statement.condition.text())) return statement.condition.begin;
+		if (const char* malformed = find_malformed_value(statement.value)) return malformed;
+	}
+
+	if (status != Status::End || !scanner.at_end()) return scanner.position();
+	return nullptr;
+}
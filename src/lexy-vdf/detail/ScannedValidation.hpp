@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string_view>
+
+#include "detail/StatementScanner.hpp"
+
+namespace lexy_vdf::detail {
+	/// Unquoted keys are identifiers and quoted ones valid strings, see grammar::KeyExpression.
+	bool is_valid_key(const ScannedToken& key);
+
+	/// Whether a conditional attribute such as "[$WIN32 && !$X360]" is one grammar::ConditionalAttribute reads.
+	bool is_valid_condition(std::string_view condition);
+
+	/// Where the grammar rejects a value read by StatementScanner, nullptr if it reads it.
+	///
+	/// A word the grammar would read as several tokens is rejected, it shifts every statement after it.
+	const char* find_malformed_value(const ScannedToken& value);
+
+	/// Where the grammar rejects the statements of range, nullptr if it reads them all.
+	///
+	/// Conditions are checked but not evaluated, the grammar reads what a condition drops all the same.
+	const char* find_malformed(std::string_view range);
+}
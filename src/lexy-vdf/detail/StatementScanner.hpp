@@ -0,0 +1,239 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace lexy_vdf::detail {
+	struct ScannedToken {
+		enum class Kind : unsigned char {
+			Eof,
+			Word,
+			String,
+			OpenBrace,
+			CloseBrace,
+			Condition,
+			Invalid
+		} kind;
+		const char* begin;
+		const char* end;
+
+		constexpr std::string_view text() const {
+			return std::string_view(begin, static_cast<std::size_t>(end - begin));
+		}
+
+		/// Contents of a String token without the quotes, still escaped.
+		constexpr std::string_view string_body() const {
+			return std::string_view(begin + 1, static_cast<std::size_t>(end - begin - 2));
+		}
+	};
+
+	/// Splits VDF source into statements without evaluating them.
+	///
+	/// Only quotes, comments and brace depth are tracked so that whole blocks can be skipped
+	/// at memory speed, the contents of skipped blocks are not validated.
+	class StatementScanner {
+	public:
+		struct Statement {
+			const char* begin;
+			const char* end;
+			ScannedToken key;
+			ScannedToken value;
+			ScannedToken condition;
+			bool has_condition;
+
+			constexpr bool is_block() const {
+				return value.kind == ScannedToken::Kind::OpenBrace;
+			}
+
+			constexpr bool is_include() const {
+				return key.kind == ScannedToken::Kind::Word && (key.text() == "#include" || key.text() == "#base");
+			}
+
+			/// Range between the braces of a block value.
+			constexpr std::string_view body() const {
+				return std::string_view(value.begin + 1, static_cast<std::size_t>(value.end - value.begin - 2));
+			}
+		};
+
+		enum class Status : unsigned char {
+			Ok,
+			End,
+			Malformed
+		};
+
+		constexpr StatementScanner(const char* begin, const char* end) : _cursor(begin), _end(end) {}
+		constexpr StatementScanner(std::string_view range) : StatementScanner(range.data(), range.data() + range.size()) {}
+
+		constexpr const char* position() const {
+			return _cursor;
+		}
+
+		constexpr bool at_end() {
+			skip_trivia();
+			return _cursor == _end;
+		}
+
+		/// Reads the next statement, returns End at the end of the range or at a closing brace.
+		constexpr Status next(Statement& statement) {
+			skip_trivia();
+			if (_cursor == _end || *_cursor == '}') return Status::End;
+
+			statement.begin = _cursor;
+			statement.key = read_token();
+			if (statement.key.kind != ScannedToken::Kind::Word && statement.key.kind != ScannedToken::Kind::String) {
+				return Status::Malformed;
+			}
+
+			skip_trivia();
+			statement.value = read_token();
+			statement.has_condition = false;
+			if (statement.is_include()) {
+				if (statement.value.kind != ScannedToken::Kind::String) return Status::Malformed;
+				statement.end = _cursor;
+				return Status::Ok;
+			}
+
+			switch (statement.value.kind) {
+				case ScannedToken::Kind::Word:
+				case ScannedToken::Kind::String:
+				case ScannedToken::Kind::OpenBrace: break;
+				default: return Status::Malformed;
+			}
+			statement.end = _cursor;
+
+			skip_trivia();
+			if (_cursor != _end && *_cursor == '[') {
+				statement.condition = read_token();
+				if (statement.condition.kind != ScannedToken::Kind::Condition) return Status::Malformed;
+				statement.has_condition = true;
+				statement.end = _cursor;
+			}
+			return Status::Ok;
+		}
+
+		constexpr void skip_trivia() {
+			while (_cursor != _end) {
+				const char c = *_cursor;
+				if (is_space(c)) {
+					_cursor++;
+				} else if (c == '/' && _cursor + 1 != _end && _cursor[1] == '/') {
+					_cursor = find_char(_cursor, _end, '\n');
+				} else {
+					break;
+				}
+			}
+		}
+
+		/// Reads one token, a block is returned whole as an OpenBrace token.
+		constexpr ScannedToken read_token() {
+			const char* begin = _cursor;
+			if (_cursor == _end) return { ScannedToken::Kind::Eof, begin, begin };
+
+			switch (*_cursor) {
+				case '"': {
+					const char* close = find_string_end(_cursor + 1, _end);
+					if (close == _end) return { ScannedToken::Kind::Invalid, begin, _cursor = _end };
+					_cursor = close + 1;
+					return { ScannedToken::Kind::String, begin, _cursor };
+				}
+				case '{': {
+					const char* close = skip_block(_cursor + 1, _end);
+					if (close == _end) return { ScannedToken::Kind::Invalid, begin, _cursor = _end };
+					_cursor = close + 1;
+					return { ScannedToken::Kind::OpenBrace, begin, _cursor };
+				}
+				case '}':
+					_cursor++;
+					return { ScannedToken::Kind::CloseBrace, begin, _cursor };
+				case '[': {
+					const char* close = find_char(_cursor + 1, _end, ']');
+					if (close == _end) return { ScannedToken::Kind::Invalid, begin, _cursor = _end };
+					_cursor = close + 1;
+					return { ScannedToken::Kind::Condition, begin, _cursor };
+				}
+				default: break;
+			}
+
+			while (_cursor != _end && !is_word_break(*_cursor)) {
+				if (*_cursor == '/' && _cursor + 1 != _end && _cursor[1] == '/') break;
+				_cursor++;
+			}
+			if (_cursor == begin) return { ScannedToken::Kind::Invalid, begin, ++_cursor };
+			return { ScannedToken::Kind::Word, begin, _cursor };
+		}
+
+		/// Returns the closing quote of a string whose body starts at begin, or end.
+		static constexpr const char* find_string_end(const char* begin, const char* end) {
+			for (const char* cursor = begin; cursor != end; cursor++) {
+				if (*cursor == '\\') {
+					if (++cursor == end) break;
+				} else if (*cursor == '"') {
+					return cursor;
+				}
+			}
+			return end;
+		}
+
+		/// Returns the brace closing a block whose body starts at begin, or end.
+		static constexpr const char* skip_block(const char* begin, const char* end) {
+			std::size_t depth = 1;
+			const char* cursor = begin;
+			while (cursor != end) {
+				while (cursor != end && !is_block_special(*cursor)) {
+					cursor++;
+				}
+				if (cursor == end) break;
+
+				switch (*cursor) {
+					case '"':
+						cursor = find_string_end(cursor + 1, end);
+						if (cursor == end) return end;
+						break;
+					case '/':
+						if (cursor + 1 != end && cursor[1] == '/') {
+							cursor = find_char(cursor, end, '\n');
+							continue;
+						}
+						break;
+					case '{': depth++; break;
+					case '}':
+						if (--depth == 0) return cursor;
+						break;
+					default: break;
+				}
+				cursor++;
+			}
+			return end;
+		}
+
+		static constexpr bool is_space(char c) {
+			return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+		}
+
+		static constexpr bool is_word_break(char c) {
+			return is_space(c) || c == '"' || c == '{' || c == '}' || c == '[' || c == ']';
+		}
+
+		static constexpr bool is_block_special(char c) {
+			return c == '"' || c == '{' || c == '}' || c == '/';
+		}
+
+		static constexpr const char* find_char(const char* begin, const char* end, char c) {
+			if (std::is_constant_evaluated()) {
+				while (begin != end && *begin != c) {
+					begin++;
+				}
+				return begin;
+			} else {
+				const void* found = std::memchr(begin, c, static_cast<std::size_t>(end - begin));
+				return found ? static_cast<const char*>(found) : end;
+			}
+		}
+
+	private:
+		const char* _cursor;
+		const char* _end;
+	};
+}
\ No newline at end of file
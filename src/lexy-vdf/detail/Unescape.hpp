@@ -0,0 +1,152 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LVDF_UNESCAPE_SSE2 1
+#endif
+
+namespace lexy_vdf::detail {
+	/// Whether a quoted string takes the byte as is: ASCII other than a quote, a backslash or a control character.
+	constexpr bool is_plain_string_byte(unsigned char c) {
+		return c >= 0x20 && c < 0x7F && c != '"' && c != '\\';
+	}
+
+	/// Length of the run of plain string bytes at begin, sixteen bytes at a time with SSE2 where available.
+	inline std::size_t plain_string_run(const char* begin, const char* end) {
+		const char* cursor = begin;
+#ifdef LVDF_UNESCAPE_SSE2
+		const __m128i space = _mm_set1_epi8(0x20);
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i backslash = _mm_set1_epi8('\\');
+		const __m128i del = _mm_set1_epi8(0x7F);
+		while (end - cursor >= 16) {
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+			// Compared as signed, bytes of multibyte code points are below the space along with control characters
+			__m128i stop = _mm_cmplt_epi8(bytes, space);
+			stop = _mm_or_si128(stop, _mm_cmpeq_epi8(bytes, quote));
+			stop = _mm_or_si128(stop, _mm_cmpeq_epi8(bytes, backslash));
+			stop = _mm_or_si128(stop, _mm_cmpeq_epi8(bytes, del));
+			const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(stop));
+			if (mask != 0) return static_cast<std::size_t>(cursor - begin) + static_cast<std::size_t>(std::countr_zero(mask));
+			cursor += 16;
+		}
+#endif
+		while (cursor != end && is_plain_string_byte(static_cast<unsigned char>(*cursor))) {
+			cursor++;
+		}
+		return static_cast<std::size_t>(cursor - begin);
+	}
+
+	/// Consumes one unescaped code point of a quoted string, returns false if it is malformed or a
+	/// control character. Bytes has peek(), returning the next byte or -1 at the end, and bump().
+	template<typename Bytes>
+	constexpr bool match_string_code_point(Bytes& bytes) {
+		const int lead = bytes.peek();
+		if (lead < 0) return false;
+		const std::uint32_t first = static_cast<std::uint32_t>(lead);
+		bytes.bump();
+		if (first < 0x80) return first >= 0x20 && first != 0x7F;
+
+		std::size_t trailing;
+		std::uint32_t code_point;
+		std::uint32_t minimum;
+		if (first >= 0xC2 && first <= 0xDF) {
+			trailing = 1, code_point = first & 0x1F, minimum = 0x80;
+		} else if (first >= 0xE0 && first <= 0xEF) {
+			trailing = 2, code_point = first & 0x0F, minimum = 0x800;
+		} else if (first >= 0xF0 && first <= 0xF4) {
+			trailing = 3, code_point = first & 0x07, minimum = 0x10000;
+		} else {
+			return false;
+		}
+
+		for (; trailing != 0; trailing--) {
+			const int next = bytes.peek();
+			if (next < 0) return false;
+			const std::uint32_t unit = static_cast<std::uint32_t>(next);
+			if ((unit & 0xC0) != 0x80) return false;
+			bytes.bump();
+			code_point = (code_point << 6) | (unit & 0x3F);
+		}
+
+		if (code_point < minimum || code_point > 0x10FFFF) return false;
+		if (code_point >= 0xD800 && code_point <= 0xDFFF) return false;
+		return code_point > 0x9F;
+	}
+
+	/// Maps the character following a backslash, the escapes accepted by grammar::StringValue.
+	constexpr std::optional<char> unescape_symbol(char c) {
+		switch (c) {
+			case '"': return '"';
+			case '\'': return '\'';
+			case '\\': return '\\';
+			case '/': return '/';
+			case 'b': return '\b';
+			case 'f': return '\f';
+			case 'n': return '\n';
+			case 'r': return '\r';
+			case 't': return '\t';
+			default: return std::nullopt;
+		}
+	}
+
+	/// Bytes of a range for match_string_code_point.
+	struct ByteCursor {
+		const char* cursor;
+		const char* end;
+
+		constexpr int peek() const { return cursor == end ? -1 : static_cast<unsigned char>(*cursor); }
+		constexpr void bump() { cursor++; }
+	};
+
+	/// Whether the body of a quoted string is one grammar::StringValue accepts, escapes included.
+	inline bool is_valid_string_body(std::string_view body) {
+		ByteCursor bytes { body.data(), body.data() + body.size() };
+
+		while (bytes.cursor != bytes.end) {
+			bytes.cursor += plain_string_run(bytes.cursor, bytes.end);
+			if (bytes.cursor == bytes.end) break;
+			if (*bytes.cursor == '\\') {
+				if (bytes.cursor + 1 == bytes.end || !unescape_symbol(bytes.cursor[1])) return false;
+				bytes.cursor += 2;
+			} else if (!match_string_code_point(bytes)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// Appends the decoded body of a quoted string to result, copying runs between escapes in bulk.
+	inline bool unescape_append(std::string_view body, std::string& result) {
+		const char* cursor = body.data();
+		const char* const end = cursor + body.size();
+		result.reserve(result.size() + body.size());
+		while (cursor != end) {
+			const void* found = std::memchr(cursor, '\\', static_cast<std::size_t>(end - cursor));
+			const char* escape = found ? static_cast<const char*>(found) : end;
+			result.append(cursor, escape);
+			if (escape == end) break;
+
+			if (escape + 1 == end) return false;
+			std::optional<char> symbol = unescape_symbol(escape[1]);
+			if (!symbol) return false;
+			result.push_back(*symbol);
+			cursor = escape + 2;
+		}
+		return true;
+	}
+
+	inline std::optional<std::string> unescape(std::string_view body) {
+		std::string result;
+		if (!unescape_append(body, result)) return std::nullopt;
+		return result;
+	}
+}
@@ -0,0 +1,49 @@
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <lexy-vdf/Parser.hpp>
+
+#include <lexy/action/parse.hpp>
+#include <lexy/callback.hpp>
+#include <lexy/dsl.hpp>
+#include <lexy/encoding.hpp>
+#include <lexy/input/string_input.hpp>
+
+#include "Grammar.hpp"
+#include "detail/UnquotedToken.hpp"
+
+using namespace lexy_vdf;
+using namespace lexy_vdf::detail;
+
+namespace {
+	/// The unquoted alternatives of grammar::ValueExpression, followed by where the matched token ends.
+	struct UnquotedValue {
+		static constexpr auto rule =
+			(lexy::dsl::p<grammar::FloatValue> | lexy::dsl::p<grammar::IntegerValue> | lexy::dsl::p<grammar::PlainValue>) + lexy::dsl::position;
+		static constexpr auto value = lexy::callback<UnquotedToken>(
+			[](std::float_t value, const char* end) {
+				return UnquotedToken { UnquotedToken::Kind::Float, end, 0, value };
+			},
+			[](std::int32_t value, const char* end) {
+				return UnquotedToken { UnquotedToken::Kind::Integer, end, value, 0 };
+			},
+			[](std::string&&, const char* end) {
+				return UnquotedToken { UnquotedToken::Kind::Plain, end, 0, 0 };
+			});
+	};
+}
+
+///
+/// @brief Matches the token the grammar reads at the start of word
+///
+/// The productions are run as they are, so a sign, an integer overflow or a character an
+/// identifier can't hold make the word Invalid exactly where Parser::parse fails on it.
+///
+UnquotedToken detail::match_unquoted(std::string_view word) {
+	Parser::State state {};
+	auto result = lexy::parse<UnquotedValue>(lexy::string_input<lexy::utf8_char_encoding>(word.data(), word.data() + word.size()), state, lexy::noop);
+	if (!result) return UnquotedToken { UnquotedToken::Kind::Invalid, word.data(), 0, 0 };
+	return result.value();
+}
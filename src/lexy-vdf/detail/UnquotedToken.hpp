@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+
+namespace lexy_vdf::detail {
+	/// Unquoted token the grammar reads at the start of a word.
+	struct UnquotedToken {
+		enum class Kind : unsigned char {
+			Integer,
+			Float,
+			/// An identifier, the only unquoted form a key can take.
+			Plain,
+			/// No token matches, or the one that does fails like a signed or overflowing integer.
+			Invalid
+		} kind;
+		/// End of the token within the word, the grammar reads the rest of the word as the next token.
+		const char* end;
+		std::int32_t int_value;
+		std::float_t float_value;
+
+		bool covers(std::string_view word) const {
+			return kind != Kind::Invalid && end == word.data() + word.size();
+		}
+	};
+
+	/// Runs grammar::FloatValue, IntegerValue and PlainValue in the order grammar::ValueExpression tries them.
+	UnquotedToken match_unquoted(std::string_view word);
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LVDF_UTF16_SSE2 1
+#endif
+
+namespace lexy_vdf::detail {
+	enum class Utf16Endian : unsigned char {
+		Little,
+		Big
+	};
+
+	inline std::optional<Utf16Endian> detect_utf16_bom(const unsigned char* data, std::size_t size) {
+		if (size < 2) return std::nullopt;
+		if (data[0] == 0xFF && data[1] == 0xFE) return Utf16Endian::Little;
+		if (data[0] == 0xFE && data[1] == 0xFF) return Utf16Endian::Big;
+		return std::nullopt;
+	}
+
+	/// Transcodes UTF-16 code units to UTF-8, unpaired surrogates and a dangling odd byte become U+FFFD.
+	///
+	/// measure() and convert() walk the input identically, runs of ASCII are handled sixteen
+	/// code units at a time with SSE2 where available.
+	class Utf16Transcoder {
+	public:
+		constexpr Utf16Transcoder(const unsigned char* data, std::size_t size, Utf16Endian endian)
+			: _data(data),
+			  _units(size / 2),
+			  _odd(size % 2 != 0),
+			  _big(endian == Utf16Endian::Big) {}
+
+		std::size_t measure() const {
+			std::size_t length = 0;
+			std::size_t index = 0;
+			while (index < _units) {
+				const std::size_t ascii = ascii_run(index);
+				if (ascii != 0) {
+					length += ascii;
+					index += ascii;
+					continue;
+				}
+
+				const std::uint32_t code_point = decode(index);
+				length += code_point < 0x80 ? 1 : code_point < 0x800 ? 2 : code_point < 0x10000 ? 3 : 4;
+			}
+			return length + (_odd ? 3 : 0);
+		}
+
+		/// Writes exactly measure() bytes to out.
+		char* convert(char* out) const {
+			std::size_t index = 0;
+			while (index < _units) {
+				const std::size_t ascii = copy_ascii(index, out);
+				if (ascii != 0) {
+					index += ascii;
+					out += ascii;
+					continue;
+				}
+				out = encode(decode(index), out);
+			}
+			if (_odd) out = encode(replacement, out);
+			return out;
+		}
+
+	private:
+		static constexpr std::uint32_t replacement = 0xFFFD;
+		static constexpr std::size_t block_units = 16;
+
+		const unsigned char* _data;
+		std::size_t _units;
+		bool _odd;
+		bool _big;
+
+		std::uint16_t unit(std::size_t index) const {
+			const unsigned char* bytes = _data + index * 2;
+			return _big ? static_cast<std::uint16_t>((bytes[0] << 8) | bytes[1]) : static_cast<std::uint16_t>(bytes[0] | (bytes[1] << 8));
+		}
+
+		/// Decodes one code point starting at index and advances past it.
+		std::uint32_t decode(std::size_t& index) const {
+			const std::uint16_t first = unit(index++);
+			if (first < 0xD800 || first > 0xDFFF) return first;
+			if (first > 0xDBFF || index == _units) return replacement;
+
+			const std::uint16_t second = unit(index);
+			if (second < 0xDC00 || second > 0xDFFF) return replacement;
+			index++;
+			return 0x10000 + ((static_cast<std::uint32_t>(first) - 0xD800) << 10) + (second - 0xDC00);
+		}
+
+		static char* encode(std::uint32_t code_point, char* out) {
+			if (code_point < 0x80) {
+				*out++ = static_cast<char>(code_point);
+			} else if (code_point < 0x800) {
+				*out++ = static_cast<char>(0xC0 | (code_point >> 6));
+				*out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+			} else if (code_point < 0x10000) {
+				*out++ = static_cast<char>(0xE0 | (code_point >> 12));
+				*out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+				*out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+			} else {
+				*out++ = static_cast<char>(0xF0 | (code_point >> 18));
+				*out++ = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+				*out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+				*out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+			}
+			return out;
+		}
+
+#ifdef LVDF_UTF16_SSE2
+		/// Loads eight code units in native little endian order.
+		__m128i load(std::size_t index) const {
+			__m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_data + index * 2));
+			if (_big) units = _mm_or_si128(_mm_slli_epi16(units, 8), _mm_srli_epi16(units, 8));
+			return units;
+		}
+
+		static bool is_ascii(__m128i units) {
+			return _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xFF80))), _mm_setzero_si128())) == 0xFFFF;
+		}
+#endif
+
+		/// Length of the all ASCII block at index, 0 if the block is short or holds other code points.
+		std::size_t ascii_run(std::size_t index) const {
+#ifdef LVDF_UTF16_SSE2
+			if (_units - index < block_units) return 0;
+			return is_ascii(_mm_or_si128(load(index), load(index + 8))) ? block_units : 0;
+#else
+			if (_units - index < block_units) return 0;
+			for (std::size_t offset = 0; offset < block_units; offset++) {
+				if (unit(index + offset) >= 0x80) return 0;
+			}
+			return block_units;
+#endif
+		}
+
+		std::size_t copy_ascii(std::size_t index, char* out) const {
+#ifdef LVDF_UTF16_SSE2
+			if (_units - index < block_units) return 0;
+			const __m128i low = load(index);
+			const __m128i high = load(index + 8);
+			if (!is_ascii(_mm_or_si128(low, high))) return 0;
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(low, high));
+			return block_units;
+#else
+			const std::size_t length = ascii_run(index);
+			for (std::size_t offset = 0; offset < length; offset++) {
+				out[offset] = static_cast<char>(unit(index + offset));
+			}
+			return length;
+#endif
+		}
+	};
+}
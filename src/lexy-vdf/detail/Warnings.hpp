@@ -17,4 +17,16 @@ namespace lexy_vdf::warnings {
 				return std::nullopt;
 		}
 	}
+
+	inline ParseWarning unknown_key(std::string_view path) {
+		return ParseWarning { "Unknown key '" + std::string(path) + "'.", 3 };
+	}
+
+	inline ParseWarning type_mismatch(std::string_view path) {
+		return ParseWarning { "Value of '" + std::string(path) + "' does not match the bound type.", 4 };
+	}
+
+	inline ParseWarning condition_too_complex(std::string_view key) {
+		return ParseWarning { "Condition of '" + std::string(key) + "' is too complex to keep, it was evaluated instead.", 5 };
+	}
 }
\ No newline at end of file
@@ -0,0 +1,46 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include <lexy-vdf/MemoryUsage.hpp>
+
+#include "CountingNew.hpp"
+
+namespace {
+	std::atomic<bool> counting { false };
+
+	/// Every block carries its size in a header so that deallocations can be counted too.
+	struct AllocationHeader {
+		std::size_t size;
+		bool counted;
+	};
+
+	constexpr std::size_t allocation_header = alignof(std::max_align_t);
+	static_assert(sizeof(AllocationHeader) <= allocation_header);
+}
+
+void lexy_vdf::tools::set_allocation_counting(bool enabled) {
+	counting.store(enabled, std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t size) {
+	void* block = std::malloc(size + allocation_header);
+	if (!block) throw std::bad_alloc {};
+	const bool counted = counting.load(std::memory_order_relaxed);
+	::new (block) AllocationHeader { size, counted };
+	if (counted) lexy_vdf::AllocationCounter::record_allocation(size);
+	return static_cast<char*>(block) + allocation_header;
+}
+
+void operator delete(void* pointer) noexcept {
+	if (!pointer) return;
+	void* block = static_cast<char*>(pointer) - allocation_header;
+	const AllocationHeader* header = static_cast<const AllocationHeader*>(block);
+	if (header->counted) lexy_vdf::AllocationCounter::record_deallocation(header->size);
+	std::free(block);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+	operator delete(pointer);
+}
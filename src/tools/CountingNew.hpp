@@ -0,0 +1,9 @@
+#pragma once
+
+namespace lexy_vdf::tools {
+	/// Starts or stops reporting the global operator new and delete to AllocationCounter, off at startup.
+	///
+	/// Only blocks allocated while counting are reported when freed, so bytes_in_use stays exact
+	/// across a switch.
+	void set_allocation_counting(bool enabled);
+}